@@ -0,0 +1,238 @@
+#include <cstring>
+#include <elf.h>
+
+#include "tools/error.hpp"
+#include "tools/stats.hpp"
+#include "xcomp/litteral_pool.hpp"
+
+#include "elf.hpp"
+
+static constexpr const char *section_names[] = {".text", ".rodata", ".data", ".bss"};
+
+void Section::align_to(uint64_t a, char fill) {
+    if (a > align) {
+        align = a;
+    }
+    bytes.append((a - bytes.size() % a) % a, fill);
+}
+
+void ObjectFile::reserve(SectionId id, size_t bytes, size_t relocations) {
+    section(id).bytes.reserve(bytes);
+    section(id).relocations.reserve(relocations);
+}
+
+SymbolId ObjectFile::declare(std::string name, Binding binding, SymbolKind kind) {
+    m_symbols.push_back(Symbol{std::move(name), binding, kind});
+    return static_cast<SymbolId>(m_symbols.size() - 1);
+}
+
+void ObjectFile::define(SymbolId id, SectionId section, uint64_t offset, uint64_t size) {
+    Symbol &s = m_symbols[id];
+    if (s.defined) {
+        fatal("redefinition of symbol '", s.name, "'");
+    }
+    s.defined = true;
+    s.section = section;
+    s.value = offset;
+    s.size = size;
+}
+
+void ObjectFile::relocate(SectionId section, uint64_t offset, SymbolId symbol, Relocation type, int64_t addend) {
+    m_sections[static_cast<size_t>(section)].relocations.push_back(RelocationEntry{offset, symbol, type, addend});
+}
+
+template <typename T> static void append_struct(std::string &out, const T &v) { out.append(reinterpret_cast<const char *>(&v), sizeof(T)); }
+
+static void pad(std::string &out, size_t base, uint64_t align) { out.append((align - (out.size() - base) % align) % align, '\0'); }
+
+/**
+ * Offset of `name` in a string table being built
+ */
+static uint32_t add_string(std::string &table, std::string_view name) {
+    uint32_t offset = static_cast<uint32_t>(table.size());
+    table.append(name);
+    table.push_back('\0');
+    return offset;
+}
+
+static unsigned char symbol_info(ObjectFile::Binding b, ObjectFile::SymbolKind k) noexcept {
+    unsigned char bind = b == ObjectFile::Binding::Local ? STB_LOCAL : b == ObjectFile::Binding::Weak ? STB_WEAK : STB_GLOBAL;
+    unsigned char type = k == ObjectFile::SymbolKind::Function ? STT_FUNC : k == ObjectFile::SymbolKind::Object ? STT_OBJECT : STT_NOTYPE;
+    return static_cast<unsigned char>(ELF64_ST_INFO(bind, type));
+}
+
+void ObjectFile::write(std::string &out) const {
+    STATS_TIMER(Phase::Emit);
+    // Section header indices: null, the sections, their .rela, then the tables
+    constexpr uint16_t first_section = 1;
+    std::vector<size_t> relocated; // SectionId of the sections with relocations
+    for (size_t i = 0; i < section_count; ++i) {
+        if (!m_sections[i].relocations.empty()) {
+            relocated.push_back(i);
+        }
+    }
+    const uint16_t note_index = static_cast<uint16_t>(first_section + section_count);
+    const uint16_t symtab_index = static_cast<uint16_t>(note_index + 1 + relocated.size());
+    const uint16_t strtab_index = static_cast<uint16_t>(symtab_index + 1);
+    const uint16_t shstrtab_index = static_cast<uint16_t>(strtab_index + 1);
+    const uint16_t sections = static_cast<uint16_t>(shstrtab_index + 1);
+
+    // Locals come first in .symtab, sh_info is the index of the first global
+    std::vector<uint32_t> index(m_symbols.size());
+    std::vector<SymbolId> order;
+    order.reserve(m_symbols.size());
+    for (bool local : {true, false}) {
+        for (SymbolId id = 0; id < m_symbols.size(); ++id) {
+            if ((m_symbols[id].binding == Binding::Local) == local) {
+                index[id] = static_cast<uint32_t>(order.size() + 1);
+                order.push_back(id);
+            }
+        }
+    }
+    uint32_t first_global = 1;
+    for (SymbolId id : order) {
+        if (m_symbols[id].binding == Binding::Local) {
+            ++first_global;
+        }
+    }
+
+    std::string strtab(1, '\0');
+    std::string symtab;
+    symtab.reserve((order.size() + 1) * sizeof(Elf64_Sym));
+    append_struct(symtab, Elf64_Sym{});
+    for (SymbolId id : order) {
+        const Symbol &s = m_symbols[id];
+        if (!s.defined && s.binding == Binding::Local) {
+            fatal("undefined local symbol '", s.name, "'");
+        }
+        Elf64_Sym e{};
+        e.st_name = add_string(strtab, s.name);
+        e.st_info = symbol_info(s.binding, s.kind);
+        e.st_other = STV_DEFAULT;
+        e.st_shndx = s.defined ? static_cast<uint16_t>(first_section + static_cast<size_t>(s.section)) : SHN_UNDEF;
+        e.st_value = s.value;
+        e.st_size = s.size;
+        append_struct(symtab, e);
+    }
+
+    std::string shstrtab(1, '\0');
+    std::vector<Elf64_Shdr> headers(sections);
+
+    // The output is allocated once: contents, tables and headers, plus the alignment padding
+    size_t total = sizeof(Elf64_Ehdr) + symtab.size() + strtab.size() + sections * (sizeof(Elf64_Shdr) + 32);
+    for (const Section &s : m_sections) {
+        total += s.bytes.size() + s.align + s.relocations.size() * sizeof(Elf64_Rela);
+    }
+    const size_t base = out.size();
+    out.reserve(base + total);
+    out.append(sizeof(Elf64_Ehdr), '\0');
+
+    for (size_t i = 0; i < section_count; ++i) {
+        const Section &s = m_sections[i];
+        Elf64_Shdr &h = headers[first_section + i];
+        h.sh_name = add_string(shstrtab, section_names[i]);
+        h.sh_type = i == static_cast<size_t>(SectionId::Bss) ? SHT_NOBITS : SHT_PROGBITS;
+        h.sh_flags = SHF_ALLOC;
+        if (i == static_cast<size_t>(SectionId::Text)) {
+            h.sh_flags |= SHF_EXECINSTR;
+        } else if (i != static_cast<size_t>(SectionId::Rodata)) {
+            h.sh_flags |= SHF_WRITE;
+        }
+        h.sh_addralign = s.align;
+        pad(out, base, s.align);
+        h.sh_offset = out.size() - base;
+        if (h.sh_type == SHT_NOBITS) {
+            h.sh_size = s.bss_size;
+        } else {
+            h.sh_size = s.bytes.size();
+            out.append(s.bytes);
+        }
+    }
+
+    // Empty .note.GNU-stack: the stack is not executable
+    Elf64_Shdr &note = headers[note_index];
+    note.sh_name = add_string(shstrtab, ".note.GNU-stack");
+    note.sh_type = SHT_PROGBITS;
+    note.sh_offset = out.size() - base;
+    note.sh_addralign = 1;
+
+    for (size_t r = 0; r < relocated.size(); ++r) {
+        const Section &s = m_sections[relocated[r]];
+        Elf64_Shdr &h = headers[note_index + 1 + r];
+        h.sh_name = add_string(shstrtab, std::string(".rela") + section_names[relocated[r]]);
+        h.sh_type = SHT_RELA;
+        h.sh_flags = SHF_INFO_LINK;
+        h.sh_link = symtab_index;
+        h.sh_info = static_cast<uint32_t>(first_section + relocated[r]);
+        h.sh_addralign = 8;
+        h.sh_entsize = sizeof(Elf64_Rela);
+        pad(out, base, 8);
+        h.sh_offset = out.size() - base;
+        h.sh_size = s.relocations.size() * sizeof(Elf64_Rela);
+        for (const RelocationEntry &e : s.relocations) {
+            Elf64_Rela rela{};
+            rela.r_offset = e.offset;
+            rela.r_info = ELF64_R_INFO(uint64_t{index[e.symbol]}, static_cast<uint64_t>(e.type));
+            rela.r_addend = e.addend;
+            append_struct(out, rela);
+        }
+    }
+
+    Elf64_Shdr &sym = headers[symtab_index];
+    sym.sh_name = add_string(shstrtab, ".symtab");
+    sym.sh_type = SHT_SYMTAB;
+    sym.sh_link = strtab_index;
+    sym.sh_info = first_global;
+    sym.sh_addralign = 8;
+    sym.sh_entsize = sizeof(Elf64_Sym);
+    pad(out, base, 8);
+    sym.sh_offset = out.size() - base;
+    sym.sh_size = symtab.size();
+    out.append(symtab);
+
+    Elf64_Shdr &str = headers[strtab_index];
+    str.sh_name = add_string(shstrtab, ".strtab");
+    str.sh_type = SHT_STRTAB;
+    str.sh_addralign = 1;
+    str.sh_offset = out.size() - base;
+    str.sh_size = strtab.size();
+    out.append(strtab);
+
+    Elf64_Shdr &shstr = headers[shstrtab_index];
+    shstr.sh_name = add_string(shstrtab, ".shstrtab");
+    shstr.sh_type = SHT_STRTAB;
+    shstr.sh_addralign = 1;
+    shstr.sh_offset = out.size() - base;
+    shstr.sh_size = shstrtab.size();
+    out.append(shstrtab);
+
+    pad(out, base, 8);
+    const uint64_t headers_offset = out.size() - base;
+    for (const Elf64_Shdr &h : headers) {
+        append_struct(out, h);
+    }
+
+    Elf64_Ehdr e{};
+    std::memcpy(e.e_ident, ELFMAG, SELFMAG);
+    e.e_ident[EI_CLASS] = ELFCLASS64;
+    e.e_ident[EI_DATA] = ELFDATA2LSB;
+    e.e_ident[EI_VERSION] = EV_CURRENT;
+    e.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    e.e_type = ET_REL;
+    e.e_machine = EM_X86_64;
+    e.e_version = EV_CURRENT;
+    e.e_shoff = headers_offset;
+    e.e_ehsize = sizeof(Elf64_Ehdr);
+    e.e_shentsize = sizeof(Elf64_Shdr);
+    e.e_shnum = sections;
+    e.e_shstrndx = shstrtab_index;
+    std::memcpy(out.data() + base, &e, sizeof(e));
+}
+
+SymbolId emit_litterals(ObjectFile &o, const LitteralPool &pool, std::string name) {
+    Section &rodata = o.section(SectionId::Rodata);
+    rodata.align_to(unit_size(Encoding::Utf32));
+    uint64_t offset = rodata.size();
+    rodata.append(pool.data());
+    return o.define(std::move(name), SectionId::Rodata, offset, pool.data().size(), ObjectFile::Binding::Local, ObjectFile::SymbolKind::Object);
+}
@@ -0,0 +1,127 @@
+#ifndef ELF_HPP
+#define ELF_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class LitteralPool;
+
+/**
+ * Sections of an object file, in the order of their headers (the null section is 0)
+ */
+enum class SectionId { Text, Rodata, Data, Bss };
+
+constexpr size_t section_count = 4;
+
+using SymbolId = uint32_t;
+
+/**
+ * R_X86_64 relocation types used by the encoder, values of the System V AMD64 ABI
+ */
+enum class Relocation : uint32_t {
+    Abs64 = 1,  // R_X86_64_64: S + A
+    Pc32 = 2,   // R_X86_64_PC32: S + A - P
+    Plt32 = 4,  // R_X86_64_PLT32: L + A - P
+    Abs32s = 11, // R_X86_64_32S: S + A, sign extended
+};
+
+struct RelocationEntry {
+    uint64_t offset; // in the section
+    SymbolId symbol;
+    Relocation type;
+    int64_t addend;
+};
+
+/**
+ * Content of a section: bytes appended by the encoder, and the relocations to apply to them
+ * .bss has no bytes, only a size
+ */
+struct Section {
+    std::string bytes;
+    std::vector<RelocationEntry> relocations;
+    uint64_t align = 1;
+    uint64_t bss_size = 0;
+
+    uint64_t size() const noexcept { return bytes.size(); }
+
+    /**
+     * Pad with `fill` up to a multiple of `a`, which becomes the alignment of the section if larger
+     */
+    void align_to(uint64_t a, char fill = 0);
+
+    void append(std::string_view s) { bytes.append(s); }
+    template <typename T> void append_le(T v) {
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            bytes.push_back(static_cast<char>(static_cast<uint64_t>(v) >> (8 * i)));
+        }
+    }
+};
+
+/**
+ * In-memory ELF64 relocatable object for x86-64 Linux (ET_REL, EM_X86_64)
+ *
+ * Sections are filled in place by the encoder; reserve() them up front so that the buffers are not reallocated while
+ * emitting. write() lays out the headers, the section contents, the .rela sections, .symtab, .strtab and .shstrtab.
+ */
+class ObjectFile {
+  public:
+    enum class Binding { Local, Global, Weak };
+    enum class SymbolKind { NoType, Object, Function };
+
+    Section &section(SectionId id) noexcept { return m_sections[static_cast<size_t>(id)]; }
+    const Section &section(SectionId id) const noexcept { return m_sections[static_cast<size_t>(id)]; }
+
+    void reserve(SectionId id, size_t bytes, size_t relocations = 0);
+
+    /**
+     * Add an undefined symbol, resolved by the linker unless it is define()d later
+     */
+    SymbolId declare(std::string name, Binding binding = Binding::Global, SymbolKind kind = SymbolKind::NoType);
+
+    /**
+     * Place a declared symbol at `offset` in `section`
+     */
+    void define(SymbolId id, SectionId section, uint64_t offset, uint64_t size = 0);
+
+    SymbolId define(std::string name, SectionId section, uint64_t offset, uint64_t size, Binding binding, SymbolKind kind) {
+        SymbolId id = declare(std::move(name), binding, kind);
+        define(id, section, offset, size);
+        return id;
+    }
+
+    /**
+     * Relocate the bytes at `offset` in `section` against `symbol`
+     */
+    void relocate(SectionId section, uint64_t offset, SymbolId symbol, Relocation type, int64_t addend);
+
+    size_t symbols() const noexcept { return m_symbols.size(); }
+
+    /**
+     * Append the object file to `out`
+     */
+    void write(std::string &out) const;
+
+  private:
+    struct Symbol {
+        std::string name;
+        Binding binding;
+        SymbolKind kind;
+        bool defined = false;
+        SectionId section = SectionId::Text;
+        uint64_t value = 0;
+        uint64_t size = 0;
+    };
+
+    Section m_sections[section_count];
+    std::vector<Symbol> m_symbols;
+};
+
+/**
+ * Append the litterals of `pool`, already encoded, to .rodata as one block aligned for UTF-32
+ * Return a local symbol at the start of the block: litteral `id` is at this symbol + pool.entry(id).offset
+ */
+SymbolId emit_litterals(ObjectFile &o, const LitteralPool &pool, std::string name = ".Lstr");
+
+#endif // !ELF_HPP
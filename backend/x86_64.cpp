@@ -0,0 +1,204 @@
+#include <algorithm>
+
+#include "tools/error.hpp"
+
+#include "x86_64.hpp"
+
+// Encodings from the Intel 64 and IA-32 Architectures Software Developer's Manual, volume 2
+
+static unsigned number(Reg r) noexcept { return static_cast<unsigned>(r); }
+
+static bool is_int8(int64_t v) noexcept { return v >= INT8_MIN && v <= INT8_MAX; }
+
+void Assembler::rex(bool w, unsigned reg, unsigned rm, bool force) {
+    unsigned r = 0x40 | unsigned{w} << 3 | (reg >> 3) << 2 | rm >> 3;
+    if (r != 0x40 || force) {
+        byte(r);
+    }
+}
+
+void Assembler::modrm(unsigned reg, Mem m) {
+    unsigned base = number(m.base) & 7;
+    // mod 00 with rbp or r13 is RIP-relative or disp32 only, they take a disp8 of 0 instead
+    unsigned mod = m.disp == 0 && base != 5 ? 0 : is_int8(m.disp) ? 1 : 2;
+    byte(mod << 6 | (reg & 7) << 3 | base);
+    if (base == 4) {
+        byte(0x24); // SIB without index, rsp or r12 as base
+    }
+    if (mod == 1) {
+        byte(static_cast<unsigned>(m.disp) & 0xff);
+    } else if (mod == 2) {
+        text().append_le(m.disp);
+    }
+}
+
+void Assembler::mov(Reg dst, Reg src) {
+    rex(true, number(src), number(dst));
+    byte(0x89);
+    modrm(number(src), dst);
+}
+
+void Assembler::mov(Reg dst, Mem src) {
+    rex(true, number(dst), number(src.base));
+    byte(0x8b);
+    modrm(number(dst), src);
+}
+
+void Assembler::mov(Mem dst, Reg src) {
+    rex(true, number(src), number(dst.base));
+    byte(0x89);
+    modrm(number(src), dst);
+}
+
+void Assembler::mov(Reg dst, int64_t imm) {
+    if (imm >= 0 && imm <= UINT32_MAX) {
+        // Writing the 32 bit register clears the upper half
+        mov_imm32(dst, static_cast<uint32_t>(imm));
+    } else if (imm >= INT32_MIN && imm <= INT32_MAX) {
+        rex(true, 0, number(dst));
+        byte(0xc7);
+        modrm(0, dst);
+        text().append_le(static_cast<int32_t>(imm));
+    } else {
+        rex(true, 0, number(dst));
+        byte(0xb8 | (number(dst) & 7));
+        text().append_le(imm);
+    }
+}
+
+void Assembler::mov_imm32(Reg dst, uint32_t imm) {
+    rex(false, 0, number(dst));
+    byte(0xb8 | (number(dst) & 7));
+    text().append_le(imm);
+}
+
+void Assembler::lea(Reg dst, Mem src) {
+    rex(true, number(dst), number(src.base));
+    byte(0x8d);
+    modrm(number(dst), src);
+}
+
+void Assembler::lea(Reg dst, SymbolId symbol, int64_t addend) {
+    rex(true, number(dst), 0);
+    byte(0x8d);
+    byte(0x05 | (number(dst) & 7) << 3);
+    // The displacement is relative to the end of the instruction, which is also the end of the rel32
+    m_object.relocate(m_section, offset(), symbol, Relocation::Pc32, addend - 4);
+    text().append_le(int32_t{0});
+}
+
+void Assembler::push(Reg r) {
+    rex(false, 0, number(r));
+    byte(0x50 | (number(r) & 7));
+}
+
+void Assembler::pop(Reg r) {
+    rex(false, 0, number(r));
+    byte(0x58 | (number(r) & 7));
+}
+
+void Assembler::alu(unsigned opcode, Reg dst, Reg src) {
+    rex(true, number(src), number(dst));
+    byte(opcode);
+    modrm(number(src), dst);
+}
+
+void Assembler::alu(unsigned digit, Reg dst, int32_t imm) {
+    rex(true, 0, number(dst));
+    if (is_int8(imm)) {
+        byte(0x83);
+        modrm(digit, dst);
+        byte(static_cast<unsigned>(imm) & 0xff);
+    } else {
+        byte(0x81);
+        modrm(digit, dst);
+        text().append_le(imm);
+    }
+}
+
+void Assembler::imul(Reg dst, Reg src) {
+    rex(true, number(dst), number(src));
+    byte(0x0f);
+    byte(0xaf);
+    modrm(number(dst), src);
+}
+
+void Assembler::test(Reg a, Reg b) {
+    rex(true, number(b), number(a));
+    byte(0x85);
+    modrm(number(b), a);
+}
+
+void Assembler::set(Cond c, Reg dst) {
+    // Without REX, 4 to 7 are ah, ch, dh and bh instead of spl, bpl, sil and dil
+    rex(false, 0, number(dst), number(dst) >= 4);
+    byte(0x0f);
+    byte(0x90 | static_cast<unsigned>(c));
+    modrm(0, dst);
+}
+
+Assembler::Label Assembler::label() {
+    m_labels.push_back(unbound);
+    return static_cast<Label>(m_labels.size() - 1);
+}
+
+void Assembler::bind(Label l) {
+    if (m_labels[l] != unbound) {
+        fatal("label bound twice");
+    }
+    uint64_t target = offset();
+    m_labels[l] = target;
+    std::string &bytes = text().bytes;
+    auto bound = std::remove_if(m_fixups.begin(), m_fixups.end(), [l, target, &bytes](const Fixup &f) {
+        if (f.label != l) {
+            return false;
+        }
+        uint32_t rel = static_cast<uint32_t>(target - (f.offset + 4));
+        for (size_t i = 0; i < 4; ++i) {
+            bytes[f.offset + i] = static_cast<char>(rel >> (8 * i));
+        }
+        return true;
+    });
+    m_fixups.erase(bound, m_fixups.end());
+}
+
+void Assembler::rel32(Label l) {
+    if (m_labels[l] == unbound) {
+        m_fixups.push_back(Fixup{offset(), l});
+        text().append_le(int32_t{0});
+    } else {
+        text().append_le(static_cast<uint32_t>(m_labels[l] - (offset() + 4)));
+    }
+}
+
+void Assembler::jmp(Label l) {
+    byte(0xe9);
+    rel32(l);
+}
+
+void Assembler::j(Cond c, Label l) {
+    byte(0x0f);
+    byte(0x80 | static_cast<unsigned>(c));
+    rel32(l);
+}
+
+void Assembler::call(SymbolId symbol) {
+    byte(0xe8);
+    m_object.relocate(m_section, offset(), symbol, Relocation::Plt32, -4);
+    text().append_le(int32_t{0});
+}
+
+void Assembler::ret() { byte(0xc3); }
+
+void Assembler::syscall() {
+    byte(0x0f);
+    byte(0x05);
+}
+
+void Assembler::nop() { byte(0x90); }
+
+void Assembler::finish() const {
+    if (!m_fixups.empty()) {
+        fatal("branch to a label which is not bound");
+    }
+}
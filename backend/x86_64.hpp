@@ -0,0 +1,133 @@
+#ifndef X86_64_HPP
+#define X86_64_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "elf.hpp"
+
+/**
+ * General purpose registers, numbered as in the ModRM, SIB and REX encodings
+ */
+enum class Reg : uint8_t { Rax, Rcx, Rdx, Rbx, Rsp, Rbp, Rsi, Rdi, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+/**
+ * Condition codes of Jcc and SETcc, the low nibble of their opcode
+ */
+enum class Cond : uint8_t { O, No, B, Ae, E, Ne, Be, A, S, Ns, P, Np, L, Ge, Le, G };
+
+/**
+ * [base + disp]
+ */
+struct Mem {
+    Reg base;
+    int32_t disp = 0;
+};
+
+/**
+ * Encoder of x86-64 instructions, appended to the .text of an object file
+ *
+ * 64 bit operand size everywhere except mov_imm32(). Branches to labels use rel32 and are patched when the label is
+ * bound; calls and RIP-relative addresses of symbols leave a relocation for the linker.
+ */
+class Assembler {
+  public:
+    using Label = uint32_t;
+
+    explicit Assembler(ObjectFile &o, SectionId section = SectionId::Text) noexcept : m_object(o), m_section(section) {}
+    Assembler(const Assembler &) = delete;
+    Assembler &operator=(const Assembler &) = delete;
+
+    /**
+     * Current offset in the section
+     */
+    uint64_t offset() const noexcept { return text().size(); }
+
+    // Data movement
+    void mov(Reg dst, Reg src);
+    void mov(Reg dst, Mem src);
+    void mov(Mem dst, Reg src);
+    /**
+     * The shortest encoding of `imm`: mov r32, mov r/m64 sign extended or movabs
+     */
+    void mov(Reg dst, int64_t imm);
+    void mov_imm32(Reg dst, uint32_t imm);
+    void lea(Reg dst, Mem src);
+    /**
+     * lea dst, [rip + symbol + addend]
+     */
+    void lea(Reg dst, SymbolId symbol, int64_t addend = 0);
+    void push(Reg r);
+    void pop(Reg r);
+
+    // Arithmetic, dst op= src
+    void add(Reg dst, Reg src) { alu(0x01, dst, src); }
+    void or_(Reg dst, Reg src) { alu(0x09, dst, src); }
+    void and_(Reg dst, Reg src) { alu(0x21, dst, src); }
+    void sub(Reg dst, Reg src) { alu(0x29, dst, src); }
+    void xor_(Reg dst, Reg src) { alu(0x31, dst, src); }
+    void cmp(Reg dst, Reg src) { alu(0x39, dst, src); }
+    void add(Reg dst, int32_t imm) { alu(0, dst, imm); }
+    void or_(Reg dst, int32_t imm) { alu(1, dst, imm); }
+    void and_(Reg dst, int32_t imm) { alu(4, dst, imm); }
+    void sub(Reg dst, int32_t imm) { alu(5, dst, imm); }
+    void xor_(Reg dst, int32_t imm) { alu(6, dst, imm); }
+    void cmp(Reg dst, int32_t imm) { alu(7, dst, imm); }
+    void imul(Reg dst, Reg src);
+    void test(Reg a, Reg b);
+    /**
+     * Set the low byte of `dst` to 0 or 1, the upper bytes are kept
+     */
+    void set(Cond c, Reg dst);
+
+    // Control flow
+    Label label();
+    void bind(Label l);
+    void jmp(Label l);
+    void j(Cond c, Label l);
+    /**
+     * call symbol, through the PLT if it is not defined in this object
+     */
+    void call(SymbolId symbol);
+    void ret();
+    void syscall();
+    void nop();
+
+    /**
+     * Check that every label used by a branch was bound
+     */
+    void finish() const;
+
+  private:
+    Section &text() noexcept { return m_object.section(m_section); }
+    const Section &text() const noexcept { return m_object.section(m_section); }
+
+    void byte(unsigned b) { text().bytes.push_back(static_cast<char>(b)); }
+    void rex(bool w, unsigned reg, unsigned rm, bool force = false);
+    /**
+     * ModRM (and SIB, displacement) of `reg` with the memory operand `m`
+     */
+    void modrm(unsigned reg, Mem m);
+    void modrm(unsigned reg, Reg rm) { byte(0xc0 | (reg & 7) << 3 | (static_cast<unsigned>(rm) & 7)); }
+
+    void alu(unsigned opcode, Reg dst, Reg src);
+    void alu(unsigned digit, Reg dst, int32_t imm);
+
+    /**
+     * rel32 to `l` at the end of the current instruction
+     */
+    void rel32(Label l);
+
+    ObjectFile &m_object;
+    SectionId m_section;
+
+    static constexpr uint64_t unbound = UINT64_MAX;
+    std::vector<uint64_t> m_labels; // offset of each label, unbound until bind()
+    struct Fixup {
+        uint64_t offset; // of the rel32
+        Label label;
+    };
+    std::vector<Fixup> m_fixups; // branches to labels not bound yet
+};
+
+#endif // !X86_64_HPP
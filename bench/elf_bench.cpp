@@ -0,0 +1,104 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "backend/elf.hpp"
+#include "backend/x86_64.hpp"
+#include "tools/stats.hpp"
+#include "xcomp/litteral_pool.hpp"
+
+/**
+ * One function per litteral: a loop around some arithmetic, then puts() of the litteral
+ * Return the number of instructions
+ */
+static size_t emit_functions(ObjectFile &o, const LitteralPool &pool, SymbolId litterals, SymbolId puts, std::vector<SymbolId> &functions) {
+    Assembler a(o);
+    size_t instructions = 0;
+    for (LitteralPool::Id id = 0; id < pool.size(); ++id) {
+        uint64_t start = a.offset();
+        Assembler::Label loop = a.label();
+        Assembler::Label done = a.label();
+        a.push(Reg::Rbx);
+        a.mov(Reg::Rbx, Mem{Reg::Rdi, 8});
+        a.xor_(Reg::Rax, Reg::Rax);
+        a.bind(loop);
+        a.cmp(Reg::Rbx, 1000);
+        a.j(Cond::Ge, done);
+        a.imul(Reg::Rax, Reg::Rbx);
+        a.add(Reg::Rax, static_cast<int32_t>(id));
+        a.add(Reg::Rbx, 1);
+        a.jmp(loop);
+        a.bind(done);
+        a.lea(Reg::Rdi, litterals, static_cast<int64_t>(pool.entry(id).offset));
+        a.call(puts);
+        a.pop(Reg::Rbx);
+        a.ret();
+        instructions += 14;
+        o.define(functions[id], SectionId::Text, start, a.offset() - start);
+    }
+    a.finish();
+    return instructions;
+}
+
+/**
+ * Usage: elf_bench [functions] [iterations] [output.o]
+ * The object file of the last iteration is written to output.o, which can be checked with readelf or linked
+ */
+int main(int argc, char **argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    size_t count = args.empty() ? 20000 : std::stoul(args[0]);
+    size_t iterations = size(args) > 1 ? std::stoul(args[1]) : 10;
+
+    LitteralPool pool;
+    for (size_t i = 0; i < count; ++i) {
+        pool.add("generated litteral " + std::to_string(i), Encoding::Utf8);
+    }
+    std::vector<std::string> names;
+    for (size_t i = 0; i < count; ++i) {
+        names.push_back("function_" + std::to_string(i));
+    }
+
+    size_t instructions = 0;
+    size_t bytes = 0;
+    double encode_seconds = 0;
+    double write_seconds = 0;
+    std::string out;
+    for (size_t i = 0; i < iterations; ++i) {
+        uint64_t start = Stats::now_ns();
+        ObjectFile o;
+        // About 50 bytes and 2 relocations per function
+        o.reserve(SectionId::Text, count * 64, count * 2);
+        o.reserve(SectionId::Rodata, pool.data().size() + 4);
+        SymbolId litterals = emit_litterals(o, pool);
+        SymbolId puts = o.declare("puts", ObjectFile::Binding::Global, ObjectFile::SymbolKind::Function);
+        std::vector<SymbolId> functions;
+        functions.reserve(count);
+        for (const std::string &n : names) {
+            functions.push_back(o.declare(n, ObjectFile::Binding::Global, ObjectFile::SymbolKind::Function));
+        }
+        instructions += emit_functions(o, pool, litterals, puts, functions);
+        uint64_t encoded = Stats::now_ns();
+
+        out.clear();
+        o.write(out);
+        uint64_t written = Stats::now_ns();
+        encode_seconds += static_cast<double>(encoded - start) / 1e9;
+        write_seconds += static_cast<double>(written - encoded) / 1e9;
+        bytes += size(out);
+    }
+    if (size(args) > 2) {
+        std::ofstream(args[2], std::ios::binary) << out;
+    }
+
+    std::cout << "functions         " << count << '\n';
+    std::cout << "iterations        " << iterations << '\n';
+    std::cout << "object bytes      " << size(out) << '\n';
+    std::cout << "encode Minstr/s   " << static_cast<double>(instructions) / encode_seconds / 1e6 << '\n';
+    std::cout << "write MB/s        " << static_cast<double>(bytes) / write_seconds / 1e6 << '\n';
+    std::cout << "emit MB/s         " << static_cast<double>(bytes) / (encode_seconds + write_seconds) / 1e6 << '\n';
+
+    std::cout << '\n';
+    Stats::instance().print_table(std::cout);
+    return 0;
+}
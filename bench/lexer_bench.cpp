@@ -0,0 +1,108 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tools/alloc_stats.hpp"
+#include "tools/arena.hpp"
+#include "tools/fingerprint.hpp"
+#include "tools/lexer.hpp"
+#include "tools/stats.hpp"
+#include "xcomp/string.hpp"
+
+/**
+ * Generated source: long runs of declarations with string litterals, the kind of input which makes RSS spike
+ */
+static std::string generated_source(size_t lines) {
+    std::string s;
+    for (size_t i = 0; i < lines; ++i) {
+        std::string n = std::to_string(i);
+        s += "static const char *name_" + n + " = u8\"generated \\x41 string " + n + "\\n\";\n";
+        s += "int value_" + n + " = (" + n + " << 2) + sizeof(name_" + n + ") % 7;\n";
+    }
+    return s;
+}
+
+static std::string read_file(const std::string &path) {
+    STATS_TIMER(Phase::Read);
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        fatal("cannot open ", path);
+    }
+    std::ostringstream os;
+    os << f.rdbuf();
+    return os.str();
+}
+
+/**
+ * Usage: lexer_bench [file] [iterations] [dfa|switch] [decode] [c11|c17|c++17|c++20] [fingerprint]
+ * Without a file, a generated source is used
+ * With decode, escape sequences are converted by the lexer and convert_escape_sequences() only gathers the litterals
+ * With fingerprint, the Fingerprint of the tokens is computed in the lexing loop
+ */
+int main(int argc, char **argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    std::string source = args.empty() ? generated_source(20000) : read_file(args[0]);
+    size_t iterations = size(args) > 1 ? std::stoul(args[1]) : 10;
+    Lexer::Engine engine = size(args) > 2 && args[2] == "switch" ? Lexer::Engine::Switch : Lexer::Engine::Dfa;
+    bool decode = size(args) > 3 && args[3] == "decode";
+    Standard standard = Standard::Cxx20;
+    if (size(args) > 4 && !standard_of_name(args[4], standard)) {
+        fatal("unknown standard ", args[4]);
+    }
+    bool fingerprint = size(args) > 5 && args[5] == "fingerprint";
+
+    size_t tokens = 0;
+    double seconds = 0;
+    uint64_t hash = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        Arena arena;
+        std::vector<Token> v;
+        uint64_t start = Stats::now_ns();
+        {
+            STATS_TIMER(Phase::Lex);
+            with_lexer(standard, source, arena.resource(), engine, [&v, &hash, decode, fingerprint](auto &l) {
+                l.decode_litterals(decode);
+                Fingerprint f;
+                for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+                    if (fingerprint) {
+                        f.add(t);
+                    }
+                    v.push_back(std::move(t));
+                }
+                hash += f.value();
+            });
+        }
+        seconds += static_cast<double>(Stats::now_ns() - start) / 1e9;
+        tokens += size(v);
+
+        convert_escape_sequences(v, 1);
+    }
+
+    double bytes = static_cast<double>(size(source) * iterations);
+    std::cout << "source bytes      " << size(source) << '\n';
+    std::cout << "iterations        " << iterations << '\n';
+    std::cout << "engine            " << (engine == Lexer::Engine::Dfa ? "dfa" : "switch") << '\n';
+    std::cout << "standard          " << (size(args) > 4 ? args[4] : "c++20") << '\n';
+    std::cout << "decode            " << (decode ? "lexer" : "separate pass") << '\n';
+    std::cout << "fingerprint       " << (fingerprint ? std::to_string(hash) : "off") << '\n';
+    std::cout << "tokens            " << tokens << '\n';
+    std::cout << "lex MB/s          " << bytes / seconds / 1e6 << '\n';
+    std::cout << "lex Mtokens/s     " << static_cast<double>(tokens) / seconds / 1e6 << '\n';
+#if XCOMP_ALLOC_STATS
+    AllocStats &a = AllocStats::instance();
+    double lexemes = static_cast<double>(a.counts(AllocCategory::TokenLexeme).allocations);
+    std::cout << "lexeme allocs/tok " << lexemes / static_cast<double>(tokens) << '\n';
+#endif
+
+    std::cout << '\n';
+    Stats::instance().print_table(std::cout);
+    std::cout << '\n';
+#if XCOMP_ALLOC_STATS
+    a.print_table(std::cout);
+#else
+    std::cout << "allocation profiling disabled, configure with -DXCOMP_ALLOC_STATS=ON\n";
+#endif
+    return 0;
+}
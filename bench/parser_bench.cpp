@@ -0,0 +1,64 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "parser/parser.hpp"
+#include "tools/arena.hpp"
+#include "tools/stats.hpp"
+
+/**
+ * Generated source: declarations with initializers and expression statements of every precedence level
+ */
+static std::string generated_source(size_t lines) {
+    std::string s;
+    for (size_t i = 0; i < lines; ++i) {
+        std::string n = std::to_string(i);
+        s += "static const int *table_" + n + "[4] = {0, &x, (int *)p + " + n + ",};\n";
+        s += "a_" + n + " = b[" + n + "] * (c->d + f(e, 1)) << 2 | g ? ++h : sizeof(long) - ~i;\n";
+    }
+    return s;
+}
+
+/**
+ * Usage: parser_bench [lines] [iterations]
+ */
+int main(int argc, char **argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    size_t lines = args.empty() ? 20000 : std::stoul(args[0]);
+    size_t iterations = size(args) > 1 ? std::stoul(args[1]) : 10;
+    std::string source = generated_source(lines);
+
+    Arena tokens_arena;
+    std::vector<Token> tokens;
+    Lexer l(source, tokens_arena.resource());
+    for (Token t = l.next();; t = l.next()) {
+        tokens.push_back(std::move(t));
+        if (tokens.back().is(Token::Type::End)) {
+            break;
+        }
+    }
+
+    size_t nodes = 0;
+    size_t bytes = 0;
+    double seconds = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        Arena arena;
+        Ast ast(arena.resource());
+        uint64_t start = Stats::now_ns();
+        Parser(tokens, ast, Lexer::Language::standard).parse();
+        seconds += static_cast<double>(Stats::now_ns() - start) / 1e9;
+        nodes += ast.size();
+        bytes = ast.bytes();
+    }
+
+    std::cout << "tokens            " << size(tokens) << '\n';
+    std::cout << "iterations        " << iterations << '\n';
+    std::cout << "nodes             " << nodes / iterations << '\n';
+    std::cout << "AST bytes/node    " << static_cast<double>(bytes) / static_cast<double>(nodes / iterations) << '\n';
+    std::cout << "parse Mnodes/s    " << static_cast<double>(nodes) / seconds / 1e6 << '\n';
+    std::cout << "parse Mtokens/s   " << static_cast<double>(size(tokens) * iterations) / seconds / 1e6 << '\n';
+
+    std::cout << '\n';
+    Stats::instance().print_table(std::cout);
+    return 0;
+}
@@ -0,0 +1,19 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "tools/file_cache.hpp"
+
+#include "runner.hpp"
+
+int main(int argc, char **argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    RunnerOptions o = parse_runner_options(args);
+
+    // The cases are lexed in this process, so the compiler is this binary
+    std::string binary;
+    if (read_file("/proc/self/exe", binary) || read_file(argv[0], binary)) {
+        o.compiler = content_hash(binary);
+    }
+    return run_conformance(o, std::cout);
+}
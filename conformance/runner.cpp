@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "tools/error.hpp"
+#include "tools/file_cache.hpp"
+#include "tools/lexer.hpp"
+#include "tools/stats.hpp"
+#include "tools/thread_pool.hpp"
+#include "xcomp/preprocessed.hpp"
+#include "xcomp/string.hpp"
+
+#include "runner.hpp"
+
+static constexpr std::pair<std::string_view, Expectation> expectations[] = {
+    {".tokens", Expectation::Tokens}, {".litterals", Expectation::Litterals}, {".error", Expectation::Error}};
+
+static constexpr std::string_view source_extensions[] = {".cpp", ".c"};
+
+std::vector<Case> find_cases(const std::string &dir) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::recursive_directory_iterator it(dir, ec);
+    if (ec) {
+        fatal("cannot read ", dir, ": ", ec.message());
+    }
+    std::vector<Case> cases;
+    for (const fs::directory_entry &e : it) {
+        if (!e.is_regular_file()) {
+            continue;
+        }
+        for (const auto &[extension, kind] : expectations) {
+            if (e.path().extension() != extension) {
+                continue;
+            }
+            Case c{fs::relative(e.path(), dir).string(), {}, e.path().string(), kind};
+            for (std::string_view s : source_extensions) {
+                fs::path source = fs::path(e.path()).replace_extension(s);
+                if (fs::exists(source)) {
+                    c.source = source.string();
+                    break;
+                }
+            }
+            if (c.source.empty()) {
+                fatal("no source for ", c.expected);
+            }
+            cases.push_back(std::move(c));
+        }
+    }
+    std::sort(cases.begin(), cases.end(), [](const Case &a, const Case &b) { return a.name < b.name; });
+    return cases;
+}
+
+/**
+ * <prefix>"<content>", printable ASCII as is and the other bytes as \xHH
+ */
+static void append_litteral(std::string &out, const Token &t) {
+    char quote = t.is(Token::Type::CharLitteral) ? '\'' : '"';
+    out += t.prefix();
+    out += quote;
+    for (char c : t.lex()) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (c == '\\' || c == quote) {
+            out += '\\';
+            out += c;
+        } else if (u >= 0x20 && u < 0x7f) {
+            out += c;
+        } else {
+            constexpr std::string_view digits = "0123456789abcdef";
+            out += "\\x";
+            out += digits[u >> 4];
+            out += digits[u & 0xf];
+        }
+    }
+    out += quote;
+    out += '\n';
+}
+
+std::string actual_output(Expectation kind, Standard standard, std::string source) {
+    std::ostringstream diag;
+    DiagnosticsTo to(diag);
+    ThrowOnFatal guard;
+    std::string out;
+    try {
+        with_lexer(standard, source, std::pmr::get_default_resource(), LexerEngine::Dfa, [&out, kind](auto &l) {
+            if (kind == Expectation::Tokens) {
+                std::ostringstream os;
+                std::string spelling;
+                for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+                    if (!t.is_one_of(Token::Type::Space, Token::Type::Newline)) {
+                        spelling.clear();
+                        append_spelling(spelling, t);
+                        os << t.type() << ' ' << spelling << '\n';
+                    }
+                }
+                out = os.str();
+                return;
+            }
+            l.decode_litterals(true);
+            std::vector<Token> tokens;
+            for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+                tokens.push_back(std::move(t));
+            }
+            concatenate_litterals(tokens);
+            for (const Token &t : tokens) {
+                if (t.is_one_of(Token::Type::CharLitteral, Token::Type::StringLitteral)) {
+                    append_litteral(out, t);
+                }
+            }
+        });
+        if (kind == Expectation::Error) {
+            out = "no error\n";
+        }
+    } catch (const FatalError &e) {
+        out = (kind == Expectation::Error ? "" : "error: ") + std::string(e.what()) + '\n';
+    }
+    return out;
+}
+
+void ResultCache::load(const std::string &path) {
+    std::ifstream f(path);
+    uint64_t key;
+    uint64_t ns;
+    while (f >> std::hex >> key >> std::dec >> ns) {
+        m_entries[key] = ns;
+    }
+}
+
+void ResultCache::save(const std::string &path) const {
+    std::vector<std::pair<uint64_t, uint64_t>> entries(m_entries.begin(), m_entries.end());
+    std::sort(entries.begin(), entries.end());
+    std::ofstream f(path);
+    if (!f) {
+        fatal("cannot write ", path);
+    }
+    for (const auto &[key, ns] : entries) {
+        f << std::hex << key << ' ' << std::dec << ns << '\n';
+    }
+}
+
+bool ResultCache::find(uint64_t key, uint64_t &ns) const noexcept {
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        return false;
+    }
+    ns = it->second;
+    return true;
+}
+
+uint64_t case_key(uint64_t compiler, Expectation kind, const std::string &source, const std::string &expected) noexcept {
+    // The lengths keep the boundary between the source and the expectation in the key
+    uint64_t h = (content_hash(source) ^ compiler) * 0x9e3779b97f4a7c15;
+    h = (h ^ content_hash(expected)) * 0x9e3779b97f4a7c15;
+    return (h ^ (static_cast<uint64_t>(kind) << 56 | size(source) << 28 | size(expected))) * 0x9e3779b97f4a7c15;
+}
+
+std::vector<size_t> slow_cases(const std::vector<CaseResult> &results, double factor, uint64_t min_ns) {
+    auto per_byte = [](const CaseResult &r) { return static_cast<double>(r.ns) / static_cast<double>(std::max<size_t>(r.bytes, 1)); };
+    std::vector<double> v;
+    v.reserve(size(results));
+    for (const CaseResult &r : results) {
+        v.push_back(per_byte(r));
+    }
+    std::vector<size_t> slow;
+    if (v.empty()) {
+        return slow;
+    }
+    std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(size(v) / 2), v.end());
+    double median = v[size(v) / 2];
+    for (size_t i = 0; i < size(results); ++i) {
+        if (results[i].ns >= min_ns && per_byte(results[i]) > factor * median) {
+            slow.push_back(i);
+        }
+    }
+    return slow;
+}
+
+/**
+ * First line which differs between `expected` and `actual`
+ */
+static std::string first_difference(const std::string &expected, const std::string &actual) {
+    std::istringstream e(expected);
+    std::istringstream a(actual);
+    std::string le;
+    std::string la;
+    for (size_t line = 1;; ++line) {
+        bool has_e = static_cast<bool>(std::getline(e, le));
+        bool has_a = static_cast<bool>(std::getline(a, la));
+        if (!has_e && !has_a) {
+            return "the outputs differ";
+        }
+        if (!has_e || !has_a || le != la) {
+            std::ostringstream os;
+            os << "line " << line << ": expected " << (has_e ? "'" + le + "'" : "end of file") << ", got "
+               << (has_a ? "'" + la + "'" : "end of file");
+            return os.str();
+        }
+    }
+}
+
+static CaseResult run_case(const Case &c, const RunnerOptions &options, const ResultCache &cache) {
+    CaseResult r;
+    std::string source;
+    std::string expected;
+    if (!read_file(c.source, source) || !read_file(c.expected, expected)) {
+        r.message = "cannot read the case";
+        return r;
+    }
+    r.bytes = size(source);
+    r.key = case_key(options.compiler, c.kind, source, expected);
+    if (!options.update && cache.find(r.key, r.ns)) {
+        r.passed = true;
+        r.cached = true;
+        return r;
+    }
+
+    uint64_t start = Stats::now_ns();
+    std::string actual = actual_output(c.kind, standard_of_path(c.source), std::move(source));
+    r.ns = Stats::now_ns() - start;
+    r.passed = actual == expected;
+    if (!r.passed && options.update) {
+        std::ofstream(c.expected, std::ios::binary | std::ios::trunc) << actual;
+        r.passed = true;
+        r.message = "updated";
+    } else if (!r.passed) {
+        r.message = first_difference(expected, actual);
+    }
+    return r;
+}
+
+/**
+ * Parse the N of `option`=N, a positive number
+ */
+static double number_of(const std::string &option, const std::string &s) {
+    size_t end = 0;
+    double n = 0;
+    try {
+        n = std::stod(s, &end);
+    } catch (const std::exception &) {
+        end = 0;
+    }
+    if (s.empty() || end != size(s) || !(n > 0)) {
+        fatal("invalid ", option, " argument '", s, "'");
+    }
+    return n;
+}
+
+RunnerOptions parse_runner_options(const std::vector<std::string> &args) {
+    RunnerOptions o;
+    for (const std::string &a : args) {
+        if (a.rfind("-j", 0) == 0) {
+            o.jobs = static_cast<unsigned>(std::min(number_of("-j", a.substr(2)), 1024.0));
+        } else if (a.rfind("--cache=", 0) == 0) {
+            o.cache = a.substr(8);
+        } else if (a.rfind("--report=", 0) == 0) {
+            o.report = a.substr(9);
+        } else if (a == "--update") {
+            o.update = true;
+        } else if (a.rfind("--slow-factor=", 0) == 0) {
+            o.slow_factor = number_of("--slow-factor", a.substr(14));
+        } else if (a.rfind("--slow-ms=", 0) == 0) {
+            o.slow_ns = static_cast<uint64_t>(number_of("--slow-ms", a.substr(10)) * 1e6);
+        } else if (a.size() > 1 && a[0] == '-') {
+            fatal("unrecognized command-line option '", a, "'");
+        } else {
+            o.dirs.push_back(a);
+        }
+    }
+    if (o.dirs.empty()) {
+        fatal("no corpus directory");
+    }
+    return o;
+}
+
+int run_conformance(const RunnerOptions &options, std::ostream &out) {
+    std::vector<Case> cases;
+    for (const std::string &dir : options.dirs) {
+        std::vector<Case> v = find_cases(dir);
+        cases.insert(cases.end(), std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()));
+    }
+    ResultCache cache;
+    if (!options.cache.empty()) {
+        cache.load(options.cache);
+    }
+
+    std::vector<CaseResult> results(size(cases));
+    uint64_t start = Stats::now_ns();
+    {
+        // The cache is only read while the cases run
+        ThreadPool pool(options.jobs);
+        for (size_t i = 0; i < size(cases); ++i) {
+            pool.submit([&cases, &results, &options, &cache, i]() noexcept { results[i] = run_case(cases[i], options, cache); });
+        }
+        pool.wait();
+    }
+    uint64_t wall = Stats::now_ns() - start;
+
+    size_t failed = 0;
+    size_t cached = 0;
+    for (size_t i = 0; i < size(cases); ++i) {
+        const CaseResult &r = results[i];
+        if (!r.passed) {
+            ++failed;
+            out << "FAIL " << cases[i].name << ": " << r.message << '\n';
+        } else if (!r.message.empty()) {
+            out << r.message << ' ' << cases[i].name << '\n';
+        }
+        cached += r.cached;
+    }
+
+    auto ms = [](uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+    std::vector<size_t> slow = slow_cases(results, options.slow_factor, options.slow_ns);
+    for (size_t i : slow) {
+        out << "slow " << cases[i].name << ": " << std::fixed << std::setprecision(3) << ms(results[i].ns) << " ms for " << results[i].bytes
+            << " bytes\n";
+    }
+    out << size(cases) << " cases, " << size(cases) - failed << " passed, " << failed << " failed, " << cached << " cached, " << size(slow)
+        << " slow in " << std::fixed << std::setprecision(3) << ms(wall) << " ms\n";
+
+    if (!options.cache.empty() && !options.update) {
+        for (const CaseResult &r : results) {
+            if (r.passed && !r.cached) {
+                cache.insert(r.key, r.ns);
+            }
+        }
+        cache.save(options.cache);
+    }
+    if (!options.report.empty()) {
+        std::ofstream f(options.report);
+        if (!f) {
+            fatal("cannot write ", options.report);
+        }
+        f << "case,status,cached,ns,bytes\n";
+        for (size_t i = 0; i < size(cases); ++i) {
+            const CaseResult &r = results[i];
+            f << cases[i].name << ',' << (r.passed ? "pass" : "fail") << ',' << r.cached << ',' << r.ns << ',' << r.bytes << '\n';
+        }
+    }
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
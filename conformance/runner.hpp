@@ -0,0 +1,98 @@
+#ifndef RUNNER_HPP
+#define RUNNER_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tools/language.hpp"
+
+/**
+ * What an expectation file of the corpus holds, from its extension
+ * .tokens: one line per token, spaces and newlines skipped, as "<type> <spelling>"
+ * .litterals: one line per litteral once decoded and concatenated, as <prefix>"<content>" with non printable bytes escaped
+ * .error: the message of the fatal error, "no error" if there is none
+ */
+enum class Expectation { Tokens, Litterals, Error };
+
+/**
+ * An expectation file and the source it applies to: a.tokens and a.litterals are two cases of a.c or a.cpp
+ * The source is lexed with the standard of its extension
+ */
+struct Case {
+    std::string name; // path of the expectation file relative to the corpus directory
+    std::string source;
+    std::string expected;
+    Expectation kind;
+};
+
+/**
+ * Every case under `dir`, sorted by name
+ */
+std::vector<Case> find_cases(const std::string &dir);
+
+/**
+ * What the expectation file of `kind` should hold for `source`
+ */
+std::string actual_output(Expectation kind, Standard standard, std::string source);
+
+struct CaseResult {
+    bool passed = false;
+    bool cached = false;
+    uint64_t ns = 0;    // run time of actual_output(), recorded in the cache for cached cases
+    size_t bytes = 0;   // of the source
+    uint64_t key = 0;   // in the ResultCache
+    std::string message; // first difference for a failed case
+};
+
+/**
+ * Run times of the passing cases, by case key
+ * The file holds one "<key> <ns>" line per case
+ */
+class ResultCache {
+  public:
+    void load(const std::string &path);
+    void save(const std::string &path) const;
+
+    bool find(uint64_t key, uint64_t &ns) const noexcept;
+    void insert(uint64_t key, uint64_t ns) { m_entries[key] = ns; }
+
+  private:
+    std::unordered_map<uint64_t, uint64_t> m_entries;
+};
+
+/**
+ * Key of a case in the ResultCache, from the contents of its files: a change of the compiler, the source or the expectation runs it again
+ */
+[[gnu::pure]] uint64_t case_key(uint64_t compiler, Expectation kind, const std::string &source, const std::string &expected) noexcept;
+
+/**
+ * Indices of the cases whose time per source byte is more than `factor` times the median, and which took at least `min_ns`
+ */
+std::vector<size_t> slow_cases(const std::vector<CaseResult> &results, double factor, uint64_t min_ns);
+
+struct RunnerOptions {
+    std::vector<std::string> dirs;
+    unsigned jobs = 0;        // -j<N>, 0 for one per hardware thread
+    uint64_t compiler = 0;    // hash of the binary which lexes the cases
+    std::string cache;        // --cache=<file>, empty for none
+    std::string report;       // --report=<file>: csv of every case with its run time
+    bool update = false;      // --update: write the actual output to the expectation files
+    double slow_factor = 10;  // --slow-factor=<N>
+    uint64_t slow_ns = 1'000'000; // --slow-ms=<N>
+};
+
+/**
+ * Usage: conformance [-j<N>] [--cache=<file>] [--report=<file>] [--update] [--slow-factor=<N>] [--slow-ms=<N>] <dir>...
+ */
+RunnerOptions parse_runner_options(const std::vector<std::string> &args);
+
+/**
+ * Run the cases of every directory in parallel, print the failures, the slow cases and a summary
+ * Return EXIT_SUCCESS if every case passed
+ */
+int run_conformance(const RunnerOptions &options, std::ostream &out);
+
+#endif // !RUNNER_HPP
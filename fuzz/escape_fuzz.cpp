@@ -0,0 +1,5 @@
+#include "targets.hpp"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) { return fuzz_escape_sequence(data, size); }
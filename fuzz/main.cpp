@@ -0,0 +1,47 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static void run(std::istream &in) {
+    std::ostringstream os;
+    os << in.rdbuf();
+    std::string s = os.str();
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t *>(s.data()), s.size());
+}
+
+/**
+ * Driver of a fuzz target without libFuzzer: run each file, or each file of a directory, given as argument
+ * Without arguments the input is read from stdin, which is how AFL runs a target built with afl-g++ or afl-clang++
+ */
+int main(int argc, char **argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (args.empty()) {
+        run(std::cin);
+        return 0;
+    }
+    for (const std::string &a : args) {
+        std::vector<std::string> files;
+        if (std::filesystem::is_directory(a)) {
+            for (const auto &e : std::filesystem::directory_iterator(a)) {
+                files.push_back(e.path().string());
+            }
+        } else {
+            files.push_back(a);
+        }
+        for (const std::string &f : files) {
+            std::ifstream in(f, std::ios::binary);
+            if (!in) {
+                std::cerr << "cannot open " << f << '\n';
+                return 1;
+            }
+            run(in);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tools/error.hpp"
+#include "tools/lexer.hpp"
+#include "xcomp/string.hpp"
+
+#include "targets.hpp"
+
+/**
+ * CPU time of the calling thread
+ */
+static uint64_t thread_cpu_ns() noexcept {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+uint64_t linear_ns_per_byte() {
+    static const uint64_t ns = [] {
+        std::string source;
+        for (size_t i = 0; i < 8192; ++i) {
+            source += "/*";
+        }
+        // Each engine is timed on its own, the budget follows the slower one
+        uint64_t slowest = 1;
+        for (LexerEngine engine : {LexerEngine::Dfa, LexerEngine::Switch}) {
+            uint64_t best = UINT64_MAX;
+            for (int i = 0; i < 3; ++i) {
+                uint64_t start = thread_cpu_ns();
+                with_lexer(Standard::Cxx20, source, std::pmr::get_default_resource(), engine, [](auto &l) {
+                    for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+                    }
+                });
+                best = std::min(best, thread_cpu_ns() - start);
+            }
+            slowest = std::max(slowest, best / size(source));
+        }
+        return slowest;
+    }();
+    return ns;
+}
+
+/**
+ * Abort if `f` took more than the budget of an input of `size` bytes
+ */
+template <typename F> static void within_budget(const char *target, size_t size, F f) {
+    uint64_t per_byte = linear_ns_per_byte();
+    uint64_t start = thread_cpu_ns();
+    f();
+    uint64_t ns = thread_cpu_ns() - start;
+    if (over_budget(size, ns, per_byte)) {
+        std::cerr << target << ": " << ns / 1000 << " us for " << size << " bytes, over the budget of " << fuzz_budget_factor * per_byte
+                  << " ns per byte\n";
+        std::abort();
+    }
+}
+
+/**
+ * Tokens of `source` one per line, or the fatal error which stopped the lexer
+ */
+static std::string lex(Standard standard, const std::string &source, LexerEngine engine, bool decode) {
+    std::ostringstream os;
+    try {
+        with_lexer(standard, source, std::pmr::get_default_resource(), engine, [&os, decode](auto &l) {
+            l.decode_litterals(decode);
+            for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+                os << t.type() << ' ' << t.prefix() << ' ' << t.lex() << ' ' << t.punctuator() << '\n';
+            }
+        });
+    } catch (const FatalError &e) {
+        os << "fatal: " << e.what() << '\n';
+    }
+    return os.str();
+}
+
+int fuzz_lexer(const uint8_t *data, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    constexpr Standard standards[] = {Standard::C11, Standard::C17, Standard::Cxx17, Standard::Cxx20};
+    Standard standard = standards[data[0] & 3];
+    bool decode = data[0] & 4;
+    std::string source(reinterpret_cast<const char *>(data) + 1, size - 1);
+
+    std::ostringstream diagnostics;
+    DiagnosticsTo to(diagnostics);
+    ThrowOnFatal guard;
+    std::string dfa;
+    std::string reference;
+    within_budget("lexer", size, [&] { dfa = lex(standard, source, LexerEngine::Dfa, decode); });
+    within_budget("lexer", size, [&] { reference = lex(standard, source, LexerEngine::Switch, decode); });
+    if (dfa != reference) {
+        std::cerr << "the engines disagree\ndfa:\n" << dfa << "switch:\n" << reference;
+        std::abort();
+    }
+    return 0;
+}
+
+int fuzz_escape_sequence(const uint8_t *data, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    constexpr std::string_view prefixes[] = {"", "u8", "u", "U", "L"};
+    Token t(data[0] & 8 ? Token::Type::CharLitteral : Token::Type::StringLitteral,
+            std::string_view(reinterpret_cast<const char *>(data) + 1, size - 1));
+    t.prefix(prefixes[(data[0] & 7) % std::size(prefixes)]);
+
+    std::ostringstream diagnostics;
+    DiagnosticsTo to(diagnostics);
+    ThrowOnFatal guard;
+    within_budget("escape sequence", size, [&t] {
+        try {
+            convert_escape_sequence(t);
+        } catch (const FatalError &) {
+        }
+    });
+    return 0;
+}
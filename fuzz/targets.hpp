@@ -0,0 +1,38 @@
+#ifndef TARGETS_HPP
+#define TARGETS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Time budget of one input, in CPU time of the thread so that preemption does not count
+ * A small fixed part, and a part per byte of `fuzz_budget_factor` times the cost per byte of the densest linear input,
+ * comment openers one after the other, measured once at startup: the budget follows the build, sanitizers and coverage included. That is
+ * about 1 us per byte in an optimized build, a quadratic path on a 4 KiB input already exceeds it.
+ * An input over budget aborts like a crash, so that super-linear behaviour is a finding of the fuzzer
+ */
+constexpr uint64_t fuzz_fixed_ns = 2'000'000;
+constexpr uint64_t fuzz_budget_factor = 4;
+
+[[gnu::const]] constexpr bool over_budget(size_t bytes, uint64_t ns, uint64_t linear_ns_per_byte) noexcept {
+    return ns > fuzz_fixed_ns + bytes * fuzz_budget_factor * linear_ns_per_byte;
+}
+
+/**
+ * CPU time per byte of lexing the densest linear input, measured on the first call
+ */
+uint64_t linear_ns_per_byte();
+
+/**
+ * Lex data[1..] with both engines and check they agree
+ * data[0] selects the standard (bits 0-1) and the decoding of the litterals (bit 2)
+ */
+int fuzz_lexer(const uint8_t *data, size_t size);
+
+/**
+ * convert_escape_sequence() on a token whose lexeme is data[1..]
+ * data[0] selects the prefix (bits 0-2: none, u8, u, U, L) and a CharLitteral instead of a StringLitteral (bit 3)
+ */
+int fuzz_escape_sequence(const uint8_t *data, size_t size);
+
+#endif // !TARGETS_HPP
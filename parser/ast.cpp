@@ -0,0 +1,50 @@
+#include <iterator>
+
+#include "tools/error.hpp"
+#include "tools/lexer_dfa.hpp"
+
+#include "ast.hpp"
+
+static constexpr const char *node_kind_names[] = {
+    "Name",      "Number",   "CharLitteral", "StringLitteral", "Unary",          "Postfix",     "Binary",
+    "Conditional", "Call",   "Index",        "Member",         "Cast",           "SizeofType",  "SizeofExpr",
+    "InitList",  "Specifier", "Declarator",  "Pointer",        "Array",          "Function",    "Parameter",
+    "TypeName",  "InitDeclarator", "Declaration", "ExpressionStatement", "Unit",
+};
+
+static_assert(std::size(node_kind_names) == static_cast<size_t>(NodeKind::Unit) + 1);
+
+const char *node_kind_name(NodeKind k) noexcept { return node_kind_names[static_cast<size_t>(k)]; }
+
+/**
+ * Kinds whose token is part of what they mean, the others only keep it as a location
+ */
+static bool names_token(NodeKind k) noexcept {
+    return k == NodeKind::Name || k == NodeKind::Number || k == NodeKind::CharLitteral || k == NodeKind::StringLitteral || k == NodeKind::Member ||
+           k == NodeKind::Specifier || k == NodeKind::Declarator;
+}
+
+NodeId Ast::add(NodeKind kind, int16_t op, uint32_t token, const NodeId *children, size_t count) {
+    if (m_nodes.size() == no_node) {
+        fatal("too many AST nodes");
+    }
+    m_nodes.push_back(Node{kind, op, token, static_cast<uint32_t>(m_children.size()), static_cast<uint32_t>(count)});
+    m_children.insert(m_children.end(), children, children + count);
+    return static_cast<NodeId>(m_nodes.size() - 1);
+}
+
+void Ast::dump(std::ostream &os, NodeId id, const std::vector<Token> &tokens) const {
+    const Node &n = m_nodes[id];
+    os << '(' << node_kind_name(n.kind);
+    if (n.op != Token::no_punctuator) {
+        os << ' ' << punctuators[n.op].spelling;
+    }
+    if (n.token != no_token && names_token(n.kind)) {
+        os << ' ' << tokens[n.token].lex();
+    }
+    for (NodeId c : children(id)) {
+        os << ' ';
+        dump(os, c, tokens);
+    }
+    os << ')';
+}
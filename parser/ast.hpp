@@ -0,0 +1,139 @@
+#ifndef AST_HPP
+#define AST_HPP
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory_resource>
+#include <ostream>
+#include <vector>
+
+#include "tools/lexer.hpp"
+
+/**
+ * Handle of a node, an index in its Ast
+ */
+using NodeId = uint32_t;
+
+inline constexpr NodeId no_node = UINT32_MAX;
+
+enum class NodeKind : uint8_t {
+    // Expressions
+    Name,           // token: the identifier
+    Number,         // token: the number
+    CharLitteral,   // token: the litteral
+    StringLitteral, // token: the first litteral, children: the following adjacent litterals
+    Unary,          // op, children: operand
+    Postfix,        // op (++ or --), children: operand
+    Binary,         // op, assignments and comma included, children: left, right
+    Conditional,    // children: condition, then, else
+    Call,           // children: callee, arguments...
+    Index,          // children: array, index
+    Member,         // op (. or ->), token: the member name, children: object
+    Cast,           // children: type name, operand
+    SizeofType,     // children: type name
+    SizeofExpr,     // children: operand
+    InitList,       // children: initializers...
+
+    // Declarations
+    Specifier,      // token: a type specifier, qualifier or storage class, children: the tag name for struct, union and enum
+    Declarator,     // token: the declared identifier, no_token for an abstract declarator
+    Pointer,        // token: the '*', children: the declarator the pointer applies to, qualifiers...
+    Array,          // children: declarator, size if any
+    Function,       // children: declarator, parameters...
+    Parameter,      // children: specifiers..., declarator
+    TypeName,       // children: specifiers..., abstract declarator
+    InitDeclarator, // children: declarator, initializer if any
+    Declaration,    // children: specifiers..., init declarators...
+
+    // Top level
+    ExpressionStatement, // children: the expression
+    Unit,                // children: declarations and expression statements
+};
+
+/**
+ * Name of `k`, used by dump()
+ */
+[[gnu::const]] const char *node_kind_name(NodeKind k) noexcept;
+
+/**
+ * 16 bytes, children are a slice of the child array of the Ast
+ */
+struct Node {
+    NodeKind kind;
+    int16_t op;     // punctuator id of the operator, Token::no_punctuator if none
+    uint32_t token; // index of the main token in the token vector
+    uint32_t first; // first child in Ast::m_children
+    uint32_t count; // number of children
+};
+
+static_assert(sizeof(Node) == 16);
+
+inline constexpr uint32_t no_token = UINT32_MAX;
+
+/**
+ * Flat, index-addressed node pool
+ *
+ * A node is created once its children are complete, so the children of a node are stored contiguously
+ * and every child has a smaller id than its parent. Nothing is freed one by one: with the memory
+ * resource of an Arena, the whole tree goes away with the arena.
+ */
+class Ast {
+  public:
+    explicit Ast(std::pmr::memory_resource *mr = std::pmr::get_default_resource()) : m_nodes(mr), m_children(mr) {}
+
+    /**
+     * Contiguous children of a node
+     */
+    class Children {
+      public:
+        Children(const NodeId *first, const NodeId *last) noexcept : m_first(first), m_last(last) {}
+
+        const NodeId *begin() const noexcept { return m_first; }
+        const NodeId *end() const noexcept { return m_last; }
+        size_t size() const noexcept { return static_cast<size_t>(m_last - m_first); }
+        NodeId operator[](size_t i) const noexcept { return m_first[i]; }
+
+      private:
+        const NodeId *m_first;
+        const NodeId *m_last;
+    };
+
+    NodeId add(NodeKind kind, int16_t op, uint32_t token, const NodeId *children, size_t count);
+    NodeId add(NodeKind kind, int16_t op, uint32_t token, std::initializer_list<NodeId> children) {
+        return add(kind, op, token, children.begin(), children.size());
+    }
+
+    const Node &operator[](NodeId id) const noexcept { return m_nodes[id]; }
+    Children children(NodeId id) const noexcept {
+        const Node &n = m_nodes[id];
+        return Children(m_children.data() + n.first, m_children.data() + n.first + n.count);
+    }
+
+    size_t size() const noexcept { return m_nodes.size(); }
+
+    /**
+     * Memory held by the nodes and the child array
+     */
+    size_t bytes() const noexcept { return m_nodes.capacity() * sizeof(Node) + m_children.capacity() * sizeof(NodeId); }
+
+    void reserve(size_t nodes) {
+        m_nodes.reserve(nodes);
+        m_children.reserve(nodes);
+    }
+
+    void clear() noexcept {
+        m_nodes.clear();
+        m_children.clear();
+    }
+
+    /**
+     * Write `id` as an S-expression, e.g. (Binary + (Name a) (Number 1))
+     */
+    void dump(std::ostream &os, NodeId id, const std::vector<Token> &tokens) const;
+
+  private:
+    std::pmr::vector<Node> m_nodes;
+    std::pmr::vector<NodeId> m_children;
+};
+
+#endif // !AST_HPP
@@ -0,0 +1,521 @@
+#include <iterator>
+
+#include "tools/error.hpp"
+#include "tools/lexer_dfa.hpp"
+#include "tools/stats.hpp"
+
+#include "parser.hpp"
+
+static constexpr int16_t op_lparen = punctuator_id("(");
+static constexpr int16_t op_rparen = punctuator_id(")");
+static constexpr int16_t op_lbracket = punctuator_id("[");
+static constexpr int16_t op_rbracket = punctuator_id("]");
+static constexpr int16_t op_lbrace = punctuator_id("{");
+static constexpr int16_t op_rbrace = punctuator_id("}");
+static constexpr int16_t op_comma = punctuator_id(",");
+static constexpr int16_t op_semicolon = punctuator_id(";");
+static constexpr int16_t op_question = punctuator_id("?");
+static constexpr int16_t op_colon = punctuator_id(":");
+static constexpr int16_t op_star = punctuator_id("*");
+static constexpr int16_t op_assign = punctuator_id("=");
+static constexpr int16_t op_dot = punctuator_id(".");
+static constexpr int16_t op_arrow = punctuator_id("->");
+static constexpr int16_t op_increment = punctuator_id("++");
+static constexpr int16_t op_decrement = punctuator_id("--");
+static constexpr int16_t op_ellipsis = punctuator_id("...");
+
+/**
+ * Binary precedence and assignment flag of every punctuator, indexed by punctuator id
+ */
+struct OperatorTable {
+    int8_t precedence[std::size(punctuators)];
+    bool assignment[std::size(punctuators)];
+    bool unary[std::size(punctuators)];
+};
+
+static constexpr OperatorTable make_operator_table() {
+    OperatorTable t{};
+    constexpr std::pair<std::string_view, int8_t> binary[] = {{"||", 1}, {"&&", 2}, {"|", 3},  {"^", 4},  {"&", 5},  {"==", 6},
+                                                              {"!=", 6}, {"<", 7},  {">", 7},  {"<=", 7}, {">=", 7}, {"<<", 8},
+                                                              {">>", 8}, {"+", 9},  {"-", 9},  {"*", 10}, {"/", 10}, {"%", 10}};
+    for (const auto &[op, p] : binary) {
+        t.precedence[punctuator_id(op)] = p;
+    }
+    for (std::string_view op : {"=", "+=", "-=", "*=", "/=", "%=", "<<=", ">>=", "&=", "^=", "|="}) {
+        t.assignment[punctuator_id(op)] = true;
+    }
+    for (std::string_view op : {"&", "*", "+", "-", "~", "!"}) {
+        t.unary[punctuator_id(op)] = true;
+    }
+    return t;
+}
+
+static constexpr OperatorTable operators = make_operator_table();
+
+/**
+ * Spellings of operators which lex as identifiers
+ * https://timsong-cpp.github.io/cppwp/lex#digraph-2
+ */
+static constexpr std::pair<std::string_view, std::string_view> alternative[] = {
+    {"and", "&&"},   {"or", "||"},   {"not", "!"},     {"not_eq", "!="}, {"bitand", "&"}, {"bitor", "|"},
+    {"xor", "^"},    {"compl", "~"}, {"and_eq", "&="}, {"or_eq", "|="},  {"xor_eq", "^="},
+};
+
+static constexpr std::string_view qualifiers[] = {"const", "volatile", "restrict", "_Atomic"};
+
+static constexpr std::string_view specifier_keywords[] = {
+    "void",   "char",   "short",    "int",     "long",     "float",  "double", "signed",   "unsigned", "_Bool",   "_Complex", "const",
+    "volatile", "restrict", "_Atomic", "static", "extern", "auto", "register", "typedef", "inline", "struct", "union", "enum",
+};
+
+template <size_t N> static bool in_array(std::string_view s, const std::string_view (&a)[N]) noexcept {
+    for (std::string_view x : a) {
+        if (x == s) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Keywords which are never the name of a variable
+ */
+static bool is_keyword(std::string_view s) noexcept { return s == "sizeof" || in_array(s, specifier_keywords); }
+
+static bool is_blank(const Token &t) noexcept { return t.is_one_of(Token::Type::Space, Token::Type::Newline); }
+
+/**
+ * How a token is quoted in diagnostics
+ */
+static std::string_view spelling(const Token &t) noexcept { return t.is(Token::Type::End) ? "end of input" : t.lex(); }
+
+const Token &Parser::peek() noexcept {
+    while (is_blank(m_tokens[m_pos])) {
+        ++m_pos;
+    }
+    return m_tokens[m_pos];
+}
+
+const Token &Parser::peek(size_t k) const noexcept {
+    size_t i = m_pos;
+    for (;;) {
+        while (is_blank(m_tokens[i])) {
+            ++i;
+        }
+        if (k == 0 || m_tokens[i].is(Token::Type::End)) {
+            return m_tokens[i];
+        }
+        --k;
+        ++i;
+    }
+}
+
+uint32_t Parser::get() noexcept {
+    peek();
+    uint32_t i = static_cast<uint32_t>(m_pos);
+    if (!m_tokens[m_pos].is(Token::Type::End)) {
+        ++m_pos;
+    }
+    return i;
+}
+
+int16_t Parser::peek_op() noexcept {
+    const Token &t = peek();
+    if (t.is(Token::Type::OpOrPunctuator)) {
+        return t.punctuator();
+    }
+    if (m_alternative_tokens && t.is(Token::Type::Identifier)) {
+        for (const auto &[name, op] : alternative) {
+            if (t.lex() == name) {
+                return punctuator_id(op);
+            }
+        }
+    }
+    return Token::no_punctuator;
+}
+
+bool Parser::accept(int16_t op) noexcept {
+    if (peek_op() != op) {
+        return false;
+    }
+    get();
+    return true;
+}
+
+uint32_t Parser::expect(int16_t op) {
+    if (peek_op() != op) {
+        fatal("expected '", punctuators[op].spelling, "' before '", spelling(peek()), "'");
+    }
+    return get();
+}
+
+NodeId Parser::reduce(NodeKind kind, int16_t op, uint32_t token, size_t count) {
+    NodeId id = m_ast.add(kind, op, token, m_stack.data() + size(m_stack) - count, count);
+    m_stack.resize(size(m_stack) - count);
+    return id;
+}
+
+bool Parser::is_type_start(const Token &t) const noexcept {
+    return t.is(Token::Type::Identifier) && (in_array(t.lex(), specifier_keywords) || m_typedefs.count(t.lex()) != 0);
+}
+
+bool Parser::at_declaration() { return is_type_start(peek()); }
+
+NodeId Parser::parse() {
+    STATS_TIMER(Phase::Parse);
+    size_t start = size(m_stack);
+    while (!peek().is(Token::Type::End)) {
+        if (accept(op_semicolon)) {
+            continue;
+        }
+        if (at_declaration()) {
+            m_stack.push_back(declaration());
+            continue;
+        }
+        NodeId e = expression();
+        expect(op_semicolon);
+        m_stack.push_back(m_ast.add(NodeKind::ExpressionStatement, Token::no_punctuator, no_token, {e}));
+    }
+    return reduce(NodeKind::Unit, Token::no_punctuator, no_token, size(m_stack) - start);
+}
+
+class Parser::Nested {
+  public:
+    explicit Nested(Parser &p) : m_depth(p.m_depth) {
+        if (m_depth == max_depth) {
+            fatal("nesting too deep");
+        }
+        ++m_depth;
+    }
+    ~Nested() { --m_depth; }
+    Nested(const Nested &) = delete;
+    Nested &operator=(const Nested &) = delete;
+
+  private:
+    size_t &m_depth;
+};
+
+// Expressions
+
+NodeId Parser::expression() {
+    Nested nested(*this);
+    NodeId e = assignment();
+    while (peek_op() == op_comma) {
+        uint32_t t = get();
+        NodeId r = assignment();
+        e = m_ast.add(NodeKind::Binary, op_comma, t, {e, r});
+    }
+    return e;
+}
+
+NodeId Parser::assignment() {
+    Nested nested(*this);
+    NodeId l = conditional();
+    int16_t op = peek_op();
+    if (op == Token::no_punctuator || !operators.assignment[op]) {
+        return l;
+    }
+    uint32_t t = get();
+    NodeId r = assignment(); // right associative
+    return m_ast.add(NodeKind::Binary, op, t, {l, r});
+}
+
+NodeId Parser::conditional() {
+    Nested nested(*this);
+    NodeId c = binary(1);
+    if (peek_op() != op_question) {
+        return c;
+    }
+    uint32_t t = get();
+    NodeId a = expression();
+    expect(op_colon);
+    NodeId b = conditional();
+    return m_ast.add(NodeKind::Conditional, Token::no_punctuator, t, {c, a, b});
+}
+
+NodeId Parser::binary(int min_precedence) {
+    NodeId l = cast();
+    for (;;) {
+        int16_t op = peek_op();
+        int p = op == Token::no_punctuator ? 0 : operators.precedence[op];
+        if (p == 0 || p < min_precedence) {
+            return l;
+        }
+        uint32_t t = get();
+        NodeId r = binary(p + 1); // left associative
+        l = m_ast.add(NodeKind::Binary, op, t, {l, r});
+    }
+}
+
+NodeId Parser::cast() {
+    Nested nested(*this);
+    if (peek_op() != op_lparen || !is_type_start(peek(1))) {
+        return unary();
+    }
+    uint32_t t = get();
+    NodeId type = type_name();
+    expect(op_rparen);
+    // (type){...} is a compound litteral
+    NodeId e = peek_op() == op_lbrace ? initializer() : cast();
+    return m_ast.add(NodeKind::Cast, Token::no_punctuator, t, {type, e});
+}
+
+NodeId Parser::unary() {
+    Nested nested(*this);
+    int16_t op = peek_op();
+    if (op == op_increment || op == op_decrement) {
+        uint32_t t = get();
+        NodeId e = unary();
+        return m_ast.add(NodeKind::Unary, op, t, {e});
+    }
+    if (op != Token::no_punctuator && operators.unary[op]) {
+        uint32_t t = get();
+        NodeId e = cast();
+        return m_ast.add(NodeKind::Unary, op, t, {e});
+    }
+    if (peek().is(Token::Type::Identifier) && peek().lex() == "sizeof") {
+        uint32_t t = get();
+        if (peek_op() == op_lparen && is_type_start(peek(1))) {
+            get();
+            NodeId type = type_name();
+            expect(op_rparen);
+            return m_ast.add(NodeKind::SizeofType, Token::no_punctuator, t, {type});
+        }
+        NodeId e = unary();
+        return m_ast.add(NodeKind::SizeofExpr, Token::no_punctuator, t, {e});
+    }
+    return postfix(primary());
+}
+
+NodeId Parser::postfix(NodeId e) {
+    for (;;) {
+        int16_t op = peek_op();
+        if (op == op_lbracket) {
+            uint32_t t = get();
+            NodeId i = expression();
+            expect(op_rbracket);
+            e = m_ast.add(NodeKind::Index, Token::no_punctuator, t, {e, i});
+        } else if (op == op_lparen) {
+            uint32_t t = get();
+            size_t start = size(m_stack);
+            m_stack.push_back(e);
+            if (!accept(op_rparen)) {
+                do {
+                    m_stack.push_back(assignment());
+                } while (accept(op_comma));
+                expect(op_rparen);
+            }
+            e = reduce(NodeKind::Call, Token::no_punctuator, t, size(m_stack) - start);
+        } else if (op == op_dot || op == op_arrow) {
+            get();
+            if (!peek().is(Token::Type::Identifier)) {
+                fatal("expected identifier before '", spelling(peek()), "'");
+            }
+            e = m_ast.add(NodeKind::Member, op, get(), {e});
+        } else if (op == op_increment || op == op_decrement) {
+            e = m_ast.add(NodeKind::Postfix, op, get(), {e});
+        } else {
+            return e;
+        }
+    }
+}
+
+NodeId Parser::primary() {
+    const Token &t = peek();
+    if (t.is(Token::Type::Identifier) && !is_keyword(t.lex())) {
+        return m_ast.add(NodeKind::Name, Token::no_punctuator, get(), {});
+    }
+    if (t.is(Token::Type::Number)) {
+        return m_ast.add(NodeKind::Number, Token::no_punctuator, get(), {});
+    }
+    if (t.is(Token::Type::CharLitteral)) {
+        return m_ast.add(NodeKind::CharLitteral, Token::no_punctuator, get(), {});
+    }
+    if (t.is(Token::Type::StringLitteral)) {
+        // Adjacent litterals are one litteral, the following ones are children of the first
+        uint32_t first = get();
+        size_t start = size(m_stack);
+        while (peek().is(Token::Type::StringLitteral)) {
+            m_stack.push_back(m_ast.add(NodeKind::StringLitteral, Token::no_punctuator, get(), {}));
+        }
+        return reduce(NodeKind::StringLitteral, Token::no_punctuator, first, size(m_stack) - start);
+    }
+    if (peek_op() == op_lparen) {
+        get();
+        NodeId e = expression();
+        expect(op_rparen);
+        return e;
+    }
+    fatal("expected expression before '", spelling(t), "'");
+}
+
+// Declarations
+
+size_t Parser::specifiers(bool &is_typedef) {
+    size_t count = 0;
+    bool has_type = false;
+    for (const Token *t = &peek(); is_type_start(*t); t = &peek()) {
+        std::string_view s = t->lex();
+        bool keyword = in_array(s, specifier_keywords);
+        if (!keyword && has_type) {
+            break; // a typedef name after a type is the declared name: int T;
+        }
+        has_type = has_type || !(in_array(s, qualifiers) || s == "static" || s == "extern" || s == "auto" || s == "register" ||
+                                 s == "typedef" || s == "inline");
+        is_typedef = is_typedef || s == "typedef";
+
+        uint32_t i = get();
+        if (s == "struct" || s == "union" || s == "enum") {
+            if (!peek().is(Token::Type::Identifier)) {
+                fatal("anonymous ", s, " is not supported yet");
+            }
+            NodeId tag = m_ast.add(NodeKind::Name, Token::no_punctuator, get(), {});
+            if (peek_op() == op_lbrace) {
+                fatal(s, " definitions are not supported yet");
+            }
+            m_stack.push_back(m_ast.add(NodeKind::Specifier, Token::no_punctuator, i, {tag}));
+        } else {
+            m_stack.push_back(m_ast.add(NodeKind::Specifier, Token::no_punctuator, i, {}));
+        }
+        ++count;
+    }
+    return count;
+}
+
+NodeId Parser::type_name() {
+    size_t start = size(m_stack);
+    bool is_typedef = false;
+    if (specifiers(is_typedef) == 0) {
+        fatal("expected type name before '", spelling(peek()), "'");
+    }
+    m_stack.push_back(declarator(true));
+    return reduce(NodeKind::TypeName, Token::no_punctuator, no_token, size(m_stack) - start);
+}
+
+NodeId Parser::declarator(bool abstract) {
+    Nested nested(*this);
+    if (peek_op() != op_star) {
+        return direct_declarator(abstract);
+    }
+    uint32_t star = get();
+    size_t start = size(m_stack);
+    while (peek().is(Token::Type::Identifier) && in_array(peek().lex(), qualifiers)) {
+        m_stack.push_back(m_ast.add(NodeKind::Specifier, Token::no_punctuator, get(), {}));
+    }
+    // The declarator comes first, before the qualifiers of the pointer
+    NodeId inner = declarator(abstract);
+    m_stack.insert(begin(m_stack) + static_cast<std::ptrdiff_t>(start), inner);
+    return reduce(NodeKind::Pointer, op_star, star, size(m_stack) - start);
+}
+
+NodeId Parser::direct_declarator(bool abstract) {
+    NodeId d;
+    const Token &t = peek();
+    if (t.is(Token::Type::Identifier) && !is_keyword(t.lex())) {
+        d = m_ast.add(NodeKind::Declarator, Token::no_punctuator, get(), {});
+    } else if (peek_op() == op_lparen && !(abstract && (peek(1).punctuator() == op_rparen || is_type_start(peek(1))))) {
+        get();
+        d = declarator(abstract);
+        expect(op_rparen);
+    } else if (abstract) {
+        d = m_ast.add(NodeKind::Declarator, Token::no_punctuator, no_token, {});
+    } else {
+        fatal("expected identifier or '(' before '", spelling(t), "'");
+    }
+
+    for (;;) {
+        size_t start = size(m_stack);
+        if (accept(op_lbracket)) {
+            m_stack.push_back(d);
+            if (!accept(op_rbracket)) {
+                m_stack.push_back(assignment());
+                expect(op_rbracket);
+            }
+            d = reduce(NodeKind::Array, Token::no_punctuator, no_token, size(m_stack) - start);
+        } else if (accept(op_lparen)) {
+            m_stack.push_back(d);
+            if (peek().lex() == "void" && peek(1).punctuator() == op_rparen) {
+                get(); // (void): no parameter
+            }
+            if (!accept(op_rparen)) {
+                do {
+                    m_stack.push_back(parameter());
+                } while (accept(op_comma));
+                expect(op_rparen);
+            }
+            d = reduce(NodeKind::Function, Token::no_punctuator, no_token, size(m_stack) - start);
+        } else {
+            return d;
+        }
+    }
+}
+
+NodeId Parser::parameter() {
+    if (peek_op() == op_ellipsis) {
+        return m_ast.add(NodeKind::Parameter, op_ellipsis, get(), {});
+    }
+    size_t start = size(m_stack);
+    bool is_typedef = false;
+    if (specifiers(is_typedef) == 0) {
+        fatal("expected parameter declaration before '", spelling(peek()), "'");
+    }
+    m_stack.push_back(declarator(true));
+    return reduce(NodeKind::Parameter, Token::no_punctuator, no_token, size(m_stack) - start);
+}
+
+NodeId Parser::initializer() {
+    Nested nested(*this);
+    if (peek_op() != op_lbrace) {
+        return assignment();
+    }
+    uint32_t t = get();
+    size_t start = size(m_stack);
+    while (!accept(op_rbrace)) {
+        m_stack.push_back(initializer());
+        if (!accept(op_comma)) {
+            expect(op_rbrace);
+            break;
+        }
+    }
+    return reduce(NodeKind::InitList, Token::no_punctuator, t, size(m_stack) - start);
+}
+
+/**
+ * Token of the identifier declared by `d`, no_token if it is abstract
+ */
+static uint32_t declared_name(const Ast &ast, NodeId d) noexcept {
+    while (ast[d].kind != NodeKind::Declarator) {
+        d = ast.children(d)[0];
+    }
+    return ast[d].token;
+}
+
+NodeId Parser::declaration() {
+    size_t start = size(m_stack);
+    bool is_typedef = false;
+    if (specifiers(is_typedef) == 0) {
+        fatal("expected declaration specifiers before '", spelling(peek()), "'");
+    }
+
+    if (!accept(op_semicolon)) {
+        do {
+            size_t init = size(m_stack);
+            NodeId d = declarator(false);
+            if (is_typedef) {
+                m_typedefs.insert(m_tokens[declared_name(m_ast, d)].lex());
+            }
+            m_stack.push_back(d);
+            if (accept(op_assign)) {
+                m_stack.push_back(initializer());
+            }
+            NodeId id = reduce(NodeKind::InitDeclarator, Token::no_punctuator, no_token, size(m_stack) - init);
+            m_stack.push_back(id);
+        } while (accept(op_comma));
+
+        if (peek_op() == op_lbrace) {
+            fatal("function definitions are not supported yet");
+        }
+        expect(op_semicolon);
+    }
+    return reduce(NodeKind::Declaration, Token::no_punctuator, no_token, size(m_stack) - start);
+}
@@ -0,0 +1,108 @@
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "tools/language.hpp"
+
+#include "ast.hpp"
+
+/**
+ * Recursive descent parser for C expressions and declarations, over the tokens of a Lexer
+ *
+ * Spaces and newlines are skipped, operators are identified by their punctuator id.
+ * Typedef names are remembered as they are declared, to tell a cast from a parenthesized expression.
+ * Function bodies and struct, union or enum definitions are not handled yet.
+ */
+class Parser {
+  public:
+    /**
+     * `tokens`, lexed as `standard`, must end with an End token and outlive the parser
+     */
+    Parser(const std::vector<Token> &tokens, Ast &ast, Standard standard) : m_tokens(tokens), m_ast(ast), m_alternative_tokens(is_cxx(standard)) {}
+
+    /**
+     * Parse declarations and expression statements up to the end of the tokens, return the Unit node
+     */
+    NodeId parse();
+
+    /**
+     * expression: assignment-expression, the comma operator included
+     */
+    NodeId expression();
+    NodeId assignment();
+
+    /**
+     * declaration: specifiers init-declarator-list? ;
+     */
+    NodeId declaration();
+
+    /**
+     * True if the next token starts a declaration
+     */
+    bool at_declaration();
+
+  private:
+    /**
+     * Guard of a recursive call: fatal() once `max_depth` of them are in progress, so that deeply nested input gives an
+     * error instead of overflowing the stack
+     */
+    class Nested;
+    static constexpr size_t max_depth = 1024; // about 200 levels of parentheses
+
+    NodeId conditional();
+    NodeId binary(int min_precedence);
+    NodeId cast();
+    NodeId unary();
+    NodeId postfix(NodeId e);
+    NodeId primary();
+
+    /**
+     * Append the specifiers to m_stack, return how many there are
+     */
+    size_t specifiers(bool &is_typedef);
+    NodeId type_name();
+    NodeId declarator(bool abstract);
+    NodeId direct_declarator(bool abstract);
+    NodeId parameter();
+    NodeId initializer();
+
+    [[gnu::pure]] bool is_type_start(const Token &t) const noexcept;
+
+    /**
+     * Current token, spaces and newlines skipped
+     */
+    const Token &peek() noexcept;
+    [[gnu::pure]] const Token &peek(size_t k) const noexcept;
+
+    /**
+     * Consume the current token, return its index
+     */
+    uint32_t get() noexcept;
+
+    /**
+     * Punctuator id of the current token, alternative identifiers (and, bitor...) included in C++
+     */
+    int16_t peek_op() noexcept;
+    bool accept(int16_t op) noexcept;
+    uint32_t expect(int16_t op);
+
+    /**
+     * Create a node from the last `count` entries of m_stack and pop them
+     */
+    NodeId reduce(NodeKind kind, int16_t op, uint32_t token, size_t count);
+
+    const std::vector<Token> &m_tokens;
+    Ast &m_ast;
+    size_t m_pos = 0;
+    size_t m_depth = 0; // Nested guards in progress
+    bool m_alternative_tokens; // and, bitor... are operators in C++, identifiers or <iso646.h> macros in C
+
+    // Children of the nodes being built, they are copied contiguously into the Ast once the node is complete
+    std::vector<NodeId> m_stack;
+    std::unordered_set<std::string_view> m_typedefs;
+};
+
+#endif // !PARSER_HPP
@@ -0,0 +1,491 @@
+#include <cassert>
+#include <cstdint>
+#include <string_view>
+
+#include "tools/error.hpp"
+#include "tools/stats.hpp"
+
+#include "expression.hpp"
+
+static constexpr uint64_t fnv_offset = 0xcbf29ce484222325;
+static constexpr uint64_t fnv_prime = 0x100000001b3;
+
+static bool is_blank(const Token &t) noexcept { return t.is_one_of(Token::Type::Space, Token::Type::Newline); }
+
+/**
+ * Hash of the tokens which are not spaces, used as memoization key
+ */
+static uint64_t hash(const Token *first, const Token *last) noexcept {
+    uint64_t h = fnv_offset;
+    for (; first != last; ++first) {
+        if (is_blank(*first)) {
+            continue;
+        }
+        h = (h ^ static_cast<uint64_t>(first->type())) * fnv_prime;
+        for (char c : first->lex()) {
+            h = (h ^ static_cast<unsigned char>(c)) * fnv_prime;
+        }
+        h = (h ^ 0xff) * fnv_prime;
+    }
+    return h;
+}
+
+/**
+ * Text stored in the memo: for each token, its type, its lexeme and a '\0'
+ */
+static std::string memo_text(const Token *first, const Token *last) {
+    std::string s;
+    for (; first != last; ++first) {
+        if (!is_blank(*first)) {
+            s += static_cast<char>(first->type());
+            s += first->lex();
+            s += '\0';
+        }
+    }
+    return s;
+}
+
+static bool same_text(const Token *first, const Token *last, std::string_view s) noexcept {
+    size_t i = 0;
+    for (; first != last; ++first) {
+        if (is_blank(*first)) {
+            continue;
+        }
+        std::string_view lex = first->lex();
+        if (i + size(lex) + 2 > size(s) || s[i] != static_cast<char>(first->type()) || s.compare(i + 1, size(lex), lex) != 0 ||
+            s[i + 1 + size(lex)] != '\0') {
+            return false;
+        }
+        i += size(lex) + 2;
+    }
+    return i == size(s);
+}
+
+PPValue ExpressionEvaluator::evaluate(const Token *first, const Token *last) {
+    STATS_TIMER(Phase::Preprocess);
+    uint64_t h = hash(first, last);
+    auto range = m_memo.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        Memo &m = it->second;
+        if (!same_text(first, last, m.text)) {
+            continue;
+        }
+        if (m.generation == m_state.generation()) {
+            ++m_hits;
+            return m.value;
+        }
+        m.value = parse(first, last);
+        m.generation = m_state.generation();
+        return m.value;
+    }
+
+    PPValue v = parse(first, last);
+    m_memo.emplace(h, Memo{memo_text(first, last), m_state.generation(), v});
+    return v;
+}
+
+PPValue ExpressionEvaluator::parse(const Token *first, const Token *last) {
+    m_depth = 0;
+    m_frames[m_depth++] = Frame{first, last, nullptr};
+    if (!peek()) {
+        fatal("#if with no expression");
+    }
+
+    PPValue v = comma(false);
+    if (const Token *t = peek()) {
+        fatal("missing binary operator before token \"", t->lex(), "\"");
+    }
+    return v;
+}
+
+const Token *ExpressionEvaluator::peek() noexcept {
+    while (m_depth > 0) {
+        Frame &f = m_frames[m_depth - 1];
+        while (f.cur != f.end && is_blank(*f.cur)) {
+            ++f.cur;
+        }
+        if (f.cur != f.end) {
+            return f.cur;
+        }
+        if (m_depth == 1) {
+            return nullptr;
+        }
+        --m_depth; // end of a macro body
+    }
+    return nullptr;
+}
+
+const Token *ExpressionEvaluator::get() noexcept {
+    const Token *t = peek();
+    if (t) {
+        ++m_frames[m_depth - 1].cur;
+    }
+    return t;
+}
+
+bool ExpressionEvaluator::is_active(const Macro *m) const noexcept {
+    for (size_t i = 0; i < m_depth; ++i) {
+        if (m_frames[i].macro == m) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static constexpr std::string_view alternative[][2] = {{"and", "&&"}, {"or", "||"},     {"not", "!"},   {"not_eq", "!="},
+                                                      {"bitand", "&"}, {"bitor", "|"}, {"xor", "^"}, {"compl", "~"}};
+
+/**
+ * Return the operator spelled by `t`, alternative tokens included, or an empty view
+ * https://timsong-cpp.github.io/cppwp/lex#digraph-2
+ */
+static std::string_view op_of(const Token *t) noexcept {
+    if (!t) {
+        return {};
+    }
+    if (t->is(Token::Type::OpOrPunctuator)) {
+        return t->lex();
+    }
+    if (!t->is(Token::Type::Identifier)) {
+        return {};
+    }
+    for (const auto &a : alternative) {
+        if (t->lex() == a[0]) {
+            return a[1];
+        }
+    }
+    return {};
+}
+
+/**
+ * Identifiers which are never looked up in the macro table
+ */
+static bool is_keyword(std::string_view id) noexcept {
+    if (id == "defined" || id == "true" || id == "false") {
+        return true;
+    }
+    for (const auto &a : alternative) {
+        if (id == a[0]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int precedence(std::string_view op) noexcept {
+    constexpr std::pair<std::string_view, int> table[] = {{"||", 1}, {"&&", 2}, {"|", 3},  {"^", 4},  {"&", 5},  {"==", 6},
+                                                          {"!=", 6}, {"<", 7},  {">", 7},  {"<=", 7}, {">=", 7}, {"<<", 8},
+                                                          {">>", 8}, {"+", 9},  {"-", 9},  {"*", 10}, {"/", 10}, {"%", 10}};
+    for (const auto &[o, p] : table) {
+        if (o == op) {
+            return p;
+        }
+    }
+    return 0;
+}
+
+static PPValue boolean(bool b) noexcept { return PPValue{b ? 1u : 0u, false}; }
+
+static PPValue shift(std::string_view op, PPValue a, PPValue b) noexcept {
+    // The result has the type of the left operand, a negative count shifts the other way
+    bool left = op == "<<";
+    uintmax_t n = b.v;
+    if (!b.is_unsigned && b.as_signed() < 0) {
+        left = !left;
+        n = 0 - n;
+    }
+
+    constexpr uintmax_t width = sizeof(uintmax_t) * 8;
+    if (left) {
+        a.v = n >= width ? 0 : a.v << n;
+    } else if (a.is_unsigned || a.as_signed() >= 0) {
+        a.v = n >= width ? 0 : a.v >> n;
+    } else {
+        a.v = n >= width ? ~uintmax_t{0} : ~(~a.v >> n); // arithmetic shift of a negative value
+    }
+    return a;
+}
+
+static PPValue apply(std::string_view op, PPValue a, PPValue b, bool skip) {
+    if (op == "&&") {
+        return boolean(a.is_true() && b.is_true());
+    }
+    if (op == "||") {
+        return boolean(a.is_true() || b.is_true());
+    }
+    if (op == "<<" || op == ">>") {
+        return shift(op, a, b);
+    }
+
+    // Usual arithmetic conversions: unsigned wins
+    bool u = a.is_unsigned || b.is_unsigned;
+    if (op == "==") {
+        return boolean(a.v == b.v);
+    }
+    if (op == "!=") {
+        return boolean(a.v != b.v);
+    }
+    if (op == "<") {
+        return boolean(u ? a.v < b.v : a.as_signed() < b.as_signed());
+    }
+    if (op == ">") {
+        return boolean(u ? a.v > b.v : a.as_signed() > b.as_signed());
+    }
+    if (op == "<=") {
+        return boolean(u ? a.v <= b.v : a.as_signed() <= b.as_signed());
+    }
+    if (op == ">=") {
+        return boolean(u ? a.v >= b.v : a.as_signed() >= b.as_signed());
+    }
+
+    // Signed overflow wraps, computing in uintmax_t keeps it defined
+    if (op == "+") {
+        return PPValue{a.v + b.v, u};
+    }
+    if (op == "-") {
+        return PPValue{a.v - b.v, u};
+    }
+    if (op == "*") {
+        return PPValue{a.v * b.v, u};
+    }
+    if (op == "&") {
+        return PPValue{a.v & b.v, u};
+    }
+    if (op == "|") {
+        return PPValue{a.v | b.v, u};
+    }
+    if (op == "^") {
+        return PPValue{a.v ^ b.v, u};
+    }
+
+    assert(op == "/" || op == "%");
+    if (b.v == 0) {
+        if (skip) {
+            return PPValue{0, u};
+        }
+        fatal("division by zero in #if");
+    }
+    if (u) {
+        return PPValue{op == "/" ? a.v / b.v : a.v % b.v, u};
+    }
+    if (a.as_signed() == INTMAX_MIN && b.as_signed() == -1) {
+        return PPValue{op == "/" ? a.v : 0, u};
+    }
+    intmax_t r = op == "/" ? a.as_signed() / b.as_signed() : a.as_signed() % b.as_signed();
+    return PPValue{static_cast<uintmax_t>(r), u};
+}
+
+static int digit_value(char c) noexcept {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * https://timsong-cpp.github.io/cppwp/lex.icon
+ */
+static PPValue number(std::string_view s) {
+    size_t i = 0;
+    uintmax_t base = 10;
+    if (size(s) > 1 && s[0] == '0') {
+        if (s[1] == 'x' || s[1] == 'X') {
+            base = 16;
+            i = 2;
+        } else if (s[1] == 'b' || s[1] == 'B') {
+            base = 2;
+            i = 2;
+        } else {
+            base = 8;
+            i = 1;
+        }
+    }
+
+    PPValue v;
+    bool overflow = false;
+    for (; i < size(s); ++i) {
+        int d = digit_value(s[i]);
+        if (d < 0 || static_cast<uintmax_t>(d) >= base) {
+            break;
+        }
+        auto ud = static_cast<uintmax_t>(d);
+        if (v.v > (UINTMAX_MAX - ud) / base) {
+            overflow = true;
+        }
+        v.v = v.v * base + ud;
+    }
+
+    for (; i < size(s); ++i) {
+        if (s[i] == 'u' || s[i] == 'U') {
+            v.is_unsigned = true;
+        } else if (s[i] != 'l' && s[i] != 'L') {
+            fatal("invalid suffix \"", s.substr(i), "\" on integer constant");
+        }
+    }
+    if (overflow) {
+        fatal("integer constant is too large for its type");
+    }
+    if (v.v > INTMAX_MAX) {
+        v.is_unsigned = true; // too large for intmax_t
+    }
+    return v;
+}
+
+static PPValue character(const Token &t) {
+    std::string_view s = t.lex();
+    if (size(s) == 1) {
+        return PPValue{static_cast<uintmax_t>(static_cast<intmax_t>(s[0])), false};
+    }
+
+    constexpr std::string_view simple_escape_sequence_letter("'\"?\\abfnrtv0");
+    constexpr std::string_view simple_escaped_sequence_letter("\'\"\?\\\a\b\f\n\r\t\v\0");
+    if (size(s) == 2 && s[0] == '\\' && simple_escape_sequence_letter.find(s[1]) != std::string::npos) {
+        char c = simple_escaped_sequence_letter[simple_escape_sequence_letter.find(s[1])];
+        return PPValue{static_cast<uintmax_t>(static_cast<intmax_t>(c)), false};
+    }
+    fatal("character constant '", s, "' not supported in #if");
+}
+
+void ExpressionEvaluator::expand(bool skip) {
+    if (skip) {
+        return; // unevaluated operand, no lookup at all
+    }
+    for (;;) {
+        const Token *t = peek();
+        if (!t || !t->is(Token::Type::Identifier) || is_keyword(t->lex())) {
+            return;
+        }
+        const Macro *m = m_state.find(t->lex());
+        if (!m || is_active(m)) {
+            return;
+        }
+        if (m->function_like) {
+            fatal("function-like macro \"", t->lex(), "\" is not supported in #if");
+        }
+        if (m_depth == max_depth) {
+            fatal("macro expansion too deep in #if");
+        }
+        get();
+        m_frames[m_depth++] = Frame{m->body.data(), m->body.data() + size(m->body), m};
+    }
+}
+
+PPValue ExpressionEvaluator::comma(bool skip) {
+    PPValue v = conditional(skip);
+    expand(skip);
+    while (op_of(peek()) == ",") {
+        get();
+        v = conditional(skip);
+        expand(skip);
+    }
+    return v;
+}
+
+PPValue ExpressionEvaluator::conditional(bool skip) {
+    PPValue c = binary(1, skip);
+    expand(skip);
+    if (op_of(peek()) != "?") {
+        return c;
+    }
+    get();
+
+    PPValue a = comma(skip || !c.is_true());
+    if (op_of(get()) != ":") {
+        fatal("'?' without following ':'");
+    }
+    PPValue b = conditional(skip || c.is_true());
+
+    PPValue r = c.is_true() ? a : b;
+    r.is_unsigned = a.is_unsigned || b.is_unsigned;
+    return r;
+}
+
+PPValue ExpressionEvaluator::binary(int min_prec, bool skip) {
+    PPValue lhs = unary(skip);
+    for (;;) {
+        expand(skip);
+        std::string_view op = op_of(peek());
+        int prec = precedence(op);
+        if (prec == 0 || prec < min_prec) {
+            return lhs;
+        }
+        get();
+
+        bool rhs_skip = skip || (op == "&&" && !lhs.is_true()) || (op == "||" && lhs.is_true());
+        PPValue rhs = binary(prec + 1, rhs_skip);
+        lhs = apply(op, lhs, rhs, skip);
+    }
+}
+
+PPValue ExpressionEvaluator::unary(bool skip) {
+    expand(skip);
+    std::string_view op = op_of(peek());
+    if (op == "+" || op == "-" || op == "~" || op == "!") {
+        get();
+        PPValue v = unary(skip);
+        if (op == "-") {
+            v.v = 0 - v.v;
+        } else if (op == "~") {
+            v.v = ~v.v;
+        } else if (op == "!") {
+            v = boolean(!v.is_true());
+        }
+        return v;
+    }
+    return primary(skip);
+}
+
+PPValue ExpressionEvaluator::primary(bool skip) {
+    const Token *t = get();
+    if (!t) {
+        fatal("#if expression ends unexpectedly");
+    }
+
+    if (op_of(t) == "(") {
+        PPValue v = comma(skip);
+        if (op_of(get()) != ")") {
+            fatal("missing ')' in expression");
+        }
+        return v;
+    }
+    if (t->is(Token::Type::Number)) {
+        return number(t->lex());
+    }
+    if (t->is(Token::Type::CharLitteral)) {
+        return character(*t);
+    }
+    if (t->is(Token::Type::Identifier)) {
+        if (t->lex() == "defined") {
+            return defined(skip);
+        }
+        // Remaining identifiers are not macros, or are being expanded: they are 0
+        return boolean(t->lex() == "true");
+    }
+    fatal("token \"", t->lex(), "\" is not valid in preprocessor expressions");
+}
+
+PPValue ExpressionEvaluator::defined(bool skip) {
+    const Token *t = get();
+    bool paren = op_of(t) == "(";
+    if (paren) {
+        t = get();
+    }
+    if (!t || !t->is(Token::Type::Identifier)) {
+        fatal("operator \"defined\" requires an identifier");
+    }
+
+    PPValue v;
+    if (!skip) {
+        v = boolean(m_state.is_defined(t->lex()));
+    }
+    if (paren && op_of(get()) != ")") {
+        fatal("missing ')' after \"defined\"");
+    }
+    return v;
+}
@@ -0,0 +1,92 @@
+#ifndef EXPRESSION_HPP
+#define EXPRESSION_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "state.hpp"
+
+/**
+ * Value of a #if expression: intmax_t or uintmax_t
+ * https://timsong-cpp.github.io/cppwp/cpp.cond#12
+ */
+struct PPValue {
+    uintmax_t v = 0;
+    bool is_unsigned = false;
+
+    intmax_t as_signed() const noexcept { return static_cast<intmax_t>(v); }
+    bool is_true() const noexcept { return v != 0; }
+};
+
+/**
+ * Evaluate #if / #elif constant expressions directly over the tokens
+ * Object-like macros are expanded on the fly, only in evaluated operands
+ */
+class ExpressionEvaluator {
+  public:
+    explicit ExpressionEvaluator(PreprocessorState &state) noexcept : m_state(state) {}
+
+    /**
+     * Evaluate the tokens following #if / #elif, up to the end of the line
+     */
+    bool condition(const std::vector<Token> &line) { return evaluate(line.data(), line.data() + size(line)).is_true(); }
+
+    /**
+     * Evaluate [first, last), results are memoized until the macro table changes
+     */
+    PPValue evaluate(const Token *first, const Token *last);
+
+    /**
+     * Forget memoized results, called when a new file starts
+     */
+    void reset() noexcept { m_memo.clear(); }
+
+    size_t memo_hits() const noexcept { return m_hits; }
+
+  private:
+    struct Frame {
+        const Token *cur;
+        const Token *end;
+        const Macro *macro;
+    };
+
+    struct Memo {
+        std::string text;
+        uint64_t generation;
+        PPValue value;
+    };
+
+    static constexpr size_t max_depth = 64;
+
+    PPValue parse(const Token *first, const Token *last);
+
+    PPValue comma(bool skip);
+    PPValue conditional(bool skip);
+    PPValue binary(int min_prec, bool skip);
+    PPValue unary(bool skip);
+    PPValue primary(bool skip);
+    PPValue defined(bool skip);
+
+    /**
+     * Replace the object-like macros at the front of the stream by their body
+     */
+    void expand(bool skip);
+
+    /**
+     * Return the next token which is not a space, nullptr at the end of the expression
+     */
+    const Token *peek() noexcept;
+    const Token *get() noexcept;
+    [[gnu::pure]] bool is_active(const Macro *m) const noexcept;
+
+    PreprocessorState &m_state;
+    Frame m_frames[max_depth];
+    size_t m_depth = 0;
+
+    std::unordered_multimap<uint64_t, Memo> m_memo;
+    size_t m_hits = 0;
+};
+
+#endif // !EXPRESSION_HPP
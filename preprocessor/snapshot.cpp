@@ -0,0 +1,259 @@
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tools/error.hpp"
+
+#include "snapshot.hpp"
+
+static constexpr std::string_view magic("XCPS");
+static constexpr size_t header_size = 32;
+static constexpr size_t index_entry_size = 16;
+
+namespace {
+
+class Writer {
+  public:
+    template <typename T> void put(T v) { m_buf.append(reinterpret_cast<const char *>(&v), sizeof(v)); }
+    void raw(std::string_view s) { m_buf.append(s); }
+    void put(std::string_view s) {
+        put(static_cast<uint32_t>(size(s)));
+        m_buf.append(s);
+    }
+    template <typename T> void patch(size_t off, T v) { std::memcpy(&m_buf[off], &v, sizeof(v)); }
+
+    uint32_t offset() const {
+        if (size(m_buf) > UINT32_MAX) {
+            fatal("preprocessor snapshot too large");
+        }
+        return static_cast<uint32_t>(size(m_buf));
+    }
+    const std::string &buffer() const noexcept { return m_buf; }
+
+  private:
+    std::string m_buf;
+};
+
+class Reader {
+  public:
+    Reader(std::string_view data, size_t off) noexcept : m_data(data), m_off(off) {}
+
+    template <typename T> T get() {
+        check(sizeof(T));
+        T v;
+        std::memcpy(&v, m_data.data() + m_off, sizeof(v));
+        m_off += sizeof(v);
+        return v;
+    }
+    std::string_view get_str() {
+        size_t n = get<uint32_t>();
+        check(n);
+        std::string_view s = m_data.substr(m_off, n);
+        m_off += n;
+        return s;
+    }
+
+  private:
+    void check(size_t n) const {
+        if (m_off > size(m_data) || n > size(m_data) - m_off) {
+            fatal("corrupted preprocessor snapshot");
+        }
+    }
+
+    std::string_view m_data;
+    size_t m_off;
+};
+
+} // namespace
+
+static void put_macro(Writer &w, const Macro &m) {
+    uint8_t flags = static_cast<uint8_t>((m.function_like ? 1 : 0) | (m.variadic ? 2 : 0));
+    w.put(flags);
+    w.put(static_cast<uint32_t>(size(m.parameters)));
+    for (const auto &p : m.parameters) {
+        w.put(std::string_view(p));
+    }
+    w.put(static_cast<uint32_t>(size(m.body)));
+    for (const auto &t : m.body) {
+        w.put(static_cast<uint8_t>(t.type()));
+        w.put(static_cast<uint8_t>(t.raw()));
+        w.put(t.prefix());
+        w.put(t.lex());
+    }
+}
+
+void save_snapshot(PreprocessorState &state, std::string_view prefix, const std::string &path) {
+    std::vector<const Macro *> macros = state.macros();
+
+    Writer w;
+    w.raw(magic);
+    w.put(Snapshot::version);
+    w.put(uint64_t{size(prefix)});
+    w.put(static_cast<uint32_t>(size(macros)));
+    w.put(uint32_t{0}); // tables offset
+    w.put(uint32_t{0}); // index offset
+    w.put(uint32_t{0}); // padding
+    w.raw(prefix);
+
+    w.patch(20, w.offset());
+    const Interner &ids = state.identifiers();
+    w.put(static_cast<uint32_t>(ids.size()));
+    for (Interner::Id i = 0; i < ids.size(); ++i) {
+        w.put(ids.str(i));
+    }
+    w.put(static_cast<uint32_t>(size(state.include_guards())));
+    for (const auto &[file, guard] : state.include_guards()) {
+        w.put(std::string_view(file));
+        w.put(std::string_view(guard));
+    }
+    w.put(static_cast<uint32_t>(size(state.pragma_once_files())));
+    for (const auto &file : state.pragma_once_files()) {
+        w.put(std::string_view(file));
+    }
+
+    std::vector<uint32_t> records;
+    records.reserve(size(macros));
+    for (const Macro *m : macros) {
+        records.push_back(w.offset());
+        w.put(std::string_view(m->name));
+        put_macro(w, *m);
+    }
+
+    // Index entries point to the record, whose first field is the name
+    w.patch(24, w.offset());
+    for (size_t i = 0; i < size(macros); ++i) {
+        w.put(records[i] + static_cast<uint32_t>(sizeof(uint32_t)));
+        w.put(static_cast<uint32_t>(size(macros[i]->name)));
+        w.put(records[i]);
+        w.put(uint32_t{0}); // padding
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(w.buffer().data(), static_cast<std::streamsize>(size(w.buffer())));
+    if (!out) {
+        fatal("cannot write preprocessor snapshot ", path);
+    }
+}
+
+std::unique_ptr<Snapshot> Snapshot::open(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < header_size) {
+        close(fd);
+        return nullptr;
+    }
+    size_t n = static_cast<size_t>(st.st_size);
+    void *map = mmap(nullptr, n, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Snapshot> s(new Snapshot(map, n));
+    Reader r(s->m_data, 0);
+    if (s->m_data.substr(0, size(magic)) != magic) {
+        return nullptr;
+    }
+    r.get<uint32_t>(); // magic
+    if (r.get<uint32_t>() != version) {
+        return nullptr;
+    }
+    s->m_prefix_size = r.get<uint64_t>();
+    s->m_macro_count = r.get<uint32_t>();
+    s->m_tables = r.get<uint32_t>();
+    s->m_index = r.get<uint32_t>();
+    if (s->m_prefix_size > n - header_size || s->m_index > n || s->m_macro_count > (n - s->m_index) / index_entry_size) {
+        return nullptr;
+    }
+    return s;
+}
+
+Snapshot::Snapshot(void *map, size_t map_size) noexcept
+    : m_map(map), m_map_size(map_size), m_data(static_cast<const char *>(map), map_size) {}
+
+Snapshot::~Snapshot() { munmap(m_map, m_map_size); }
+
+bool Snapshot::matches(std::string_view source) const noexcept {
+    return size(source) >= m_prefix_size && source.substr(0, m_prefix_size) == m_data.substr(header_size, m_prefix_size);
+}
+
+std::string_view Snapshot::index_name(size_t i) const {
+    Reader r(m_data, m_index + i * index_entry_size);
+    size_t off = r.get<uint32_t>();
+    size_t n = r.get<uint32_t>();
+    if (off > size(m_data) || n > size(m_data) - off) {
+        fatal("corrupted preprocessor snapshot");
+    }
+    return m_data.substr(off, n);
+}
+
+std::optional<Macro> Snapshot::macro(std::string_view name) const {
+    size_t lo = 0;
+    size_t hi = m_macro_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index_name(mid) < name) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == m_macro_count || index_name(lo) != name) {
+        return std::nullopt;
+    }
+
+    Reader entry(m_data, m_index + lo * index_entry_size + 2 * sizeof(uint32_t));
+    Reader r(m_data, entry.get<uint32_t>());
+    Macro m;
+    m.name = r.get_str();
+    auto flags = r.get<uint8_t>();
+    m.function_like = flags & 1;
+    m.variadic = flags & 2;
+    auto n = r.get<uint32_t>();
+    for (uint32_t i = 0; i < n; ++i) {
+        m.parameters.emplace_back(r.get_str());
+    }
+    n = r.get<uint32_t>();
+    m.body.reserve(std::min<size_t>(n, size(m_data)));
+    for (uint32_t i = 0; i < n; ++i) {
+        auto type = r.get<uint8_t>();
+        if (type > static_cast<uint8_t>(Token::Type::Unexpected)) {
+            fatal("corrupted preprocessor snapshot");
+        }
+        Token t(static_cast<Token::Type>(type));
+        t.raw(r.get<uint8_t>() != 0);
+        t.prefix(r.get_str());
+        t.lex(r.get_str());
+        m.body.push_back(std::move(t));
+    }
+    return m;
+}
+
+void Snapshot::for_each_macro_name(const std::function<void(std::string_view)> &f) const {
+    for (size_t i = 0; i < m_macro_count; ++i) {
+        f(index_name(i));
+    }
+}
+
+void Snapshot::restore_tables(PreprocessorState &state) const {
+    Reader r(m_data, m_tables);
+    auto n = r.get<uint32_t>();
+    for (uint32_t i = 0; i < n; ++i) {
+        state.identifiers().intern(r.get_str());
+    }
+    n = r.get<uint32_t>();
+    for (uint32_t i = 0; i < n; ++i) {
+        std::string file(r.get_str());
+        state.include_guard(file, std::string(r.get_str()));
+    }
+    n = r.get<uint32_t>();
+    for (uint32_t i = 0; i < n; ++i) {
+        state.pragma_once(std::string(r.get_str()));
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "state.hpp"
+
+/**
+ * Write the state reached after `prefix` into `path`
+ * The file is only meant to be read back by the same build of xcomp
+ */
+void save_snapshot(PreprocessorState &state, std::string_view prefix, const std::string &path);
+
+/**
+ * Read-only view over a memory mapped snapshot file
+ *
+ * Layout (host endianness):
+ *   header:  magic "XCPS", version, prefix size, macro count, tables offset, index offset
+ *   prefix:  the source prefix itself, compared by matches()
+ *   tables:  identifiers, include guards, pragma once files
+ *   macros:  one record per macro, read only on lookup
+ *   index:   (name, record) offsets sorted by name
+ */
+class Snapshot {
+  public:
+    static constexpr uint32_t version = 3;
+
+    /**
+     * Map `path`, return nullptr if it does not exist or if it was built for another version
+     */
+    static std::unique_ptr<Snapshot> open(const std::string &path);
+
+    ~Snapshot();
+    Snapshot(const Snapshot &) = delete;
+    Snapshot &operator=(const Snapshot &) = delete;
+
+    size_t prefix_size() const noexcept { return m_prefix_size; }
+
+    /**
+     * True if `source` starts with the prefix this snapshot was built from
+     */
+    bool matches(std::string_view source) const noexcept;
+
+    /**
+     * Binary search the index and deserialize the macro named `name`
+     */
+    std::optional<Macro> macro(std::string_view name) const;
+
+    void for_each_macro_name(const std::function<void(std::string_view)> &f) const;
+
+    /**
+     * Restore identifiers, include guards and pragma once files into `state`
+     */
+    void restore_tables(PreprocessorState &state) const;
+
+  private:
+    Snapshot(void *map, size_t map_size) noexcept;
+
+    std::string_view index_name(size_t i) const;
+
+    void *m_map;
+    size_t m_map_size;
+    std::string_view m_data;
+    size_t m_prefix_size = 0;
+    size_t m_macro_count = 0;
+    size_t m_tables = 0;
+    size_t m_index = 0;
+};
+
+#endif // !SNAPSHOT_HPP
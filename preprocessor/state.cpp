@@ -0,0 +1,67 @@
+#include <algorithm>
+
+#include "snapshot.hpp"
+#include "state.hpp"
+
+void PreprocessorState::define(Macro m) {
+    Interner::Id id = m_identifiers.intern(m.name);
+    m_macros[id] = std::move(m);
+    ++m_generation;
+}
+
+void PreprocessorState::undefine(std::string_view name) {
+    Interner::Id id;
+    if (!m_identifiers.find(name, id)) {
+        return; // never defined, neither here nor in the snapshot
+    }
+    if (m_snapshot) {
+        m_macros[id] = std::nullopt;
+    } else {
+        m_macros.erase(id);
+    }
+    ++m_generation;
+}
+
+const Macro *PreprocessorState::find(std::string_view name) {
+    // Every macro name is interned, snapshot ones included: an unknown name is not a macro
+    Interner::Id id;
+    if (!m_identifiers.find(name, id)) {
+        return nullptr;
+    }
+
+    auto it = m_macros.find(id);
+    if (it == m_macros.end()) {
+        if (!m_snapshot) {
+            return nullptr;
+        }
+        // Remember misses too, so each name hits the snapshot index only once
+        it = m_macros.emplace(id, m_snapshot->macro(name)).first;
+    }
+    return it->second ? &*it->second : nullptr;
+}
+
+std::vector<const Macro *> PreprocessorState::macros() {
+    if (m_snapshot) {
+        m_snapshot->for_each_macro_name([this](std::string_view name) { find(name); });
+    }
+
+    std::vector<const Macro *> v;
+    for (const auto &[name, m] : m_macros) {
+        if (m) {
+            v.push_back(&*m);
+        }
+    }
+    std::sort(v.begin(), v.end(), [](const Macro *a, const Macro *b) { return a->name < b->name; });
+    return v;
+}
+
+const std::string *PreprocessorState::include_guard(const std::string &file) const {
+    auto it = m_guards.find(file);
+    return it == m_guards.end() ? nullptr : &it->second;
+}
+
+void PreprocessorState::attach(std::shared_ptr<const Snapshot> s) {
+    m_snapshot = std::move(s);
+    m_snapshot->restore_tables(*this);
+    ++m_generation;
+}
@@ -0,0 +1,79 @@
+#ifndef STATE_HPP
+#define STATE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "tools/interner.hpp"
+#include "tools/lexer.hpp"
+
+struct Macro {
+    std::string name;
+    bool function_like = false;
+    bool variadic = false;
+    std::vector<std::string> parameters;
+    std::vector<Token> body;
+};
+
+class Snapshot;
+
+/**
+ * Everything the preprocessor remembers between two directives:
+ * macro table, interned identifiers, include-guard cache and pragma-once set
+ */
+class PreprocessorState {
+  public:
+    void define(Macro m);
+    void undefine(std::string_view name);
+
+    /**
+     * Return the macro named `name` or nullptr
+     * Macros coming from an attached snapshot are deserialized here, on first lookup
+     */
+    const Macro *find(std::string_view name);
+    bool is_defined(std::string_view name) { return find(name) != nullptr; }
+
+    /**
+     * Return every defined macro sorted by name, loading the whole snapshot if needed
+     */
+    std::vector<const Macro *> macros();
+
+    void include_guard(const std::string &file, const std::string &guard) { m_guards[file] = guard; }
+    const std::string *include_guard(const std::string &file) const;
+    const std::unordered_map<std::string, std::string> &include_guards() const noexcept { return m_guards; }
+
+    void pragma_once(const std::string &file) { m_once.insert(file); }
+    bool is_pragma_once(const std::string &file) const { return m_once.count(file) != 0; }
+    const std::set<std::string> &pragma_once_files() const noexcept { return m_once; }
+
+    Interner &identifiers() noexcept { return m_identifiers; }
+    const Interner &identifiers() const noexcept { return m_identifiers; }
+
+    /**
+     * Start from the state saved in `s`
+     * Identifiers, include guards and pragma once are restored now, macros lazily
+     */
+    void attach(std::shared_ptr<const Snapshot> s);
+
+    /**
+     * Incremented on every change of the macro table
+     */
+    uint64_t generation() const noexcept { return m_generation; }
+
+  private:
+    // Keyed by interned name, an empty optional is an undefined macro which hides the snapshot one
+    std::unordered_map<Interner::Id, std::optional<Macro>> m_macros;
+    std::unordered_map<std::string, std::string> m_guards;
+    std::set<std::string> m_once;
+    Interner m_identifiers;
+    std::shared_ptr<const Snapshot> m_snapshot;
+    uint64_t m_generation = 0;
+};
+
+#endif // !STATE_HPP
@@ -0,0 +1,146 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <elf.h>
+#include <fstream>
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "backend/elf.hpp"
+#include "backend/x86_64.hpp"
+#include "tools/error.hpp"
+#include "xcomp/litteral_pool.hpp"
+#include "xcomp/string.hpp"
+
+template <typename T> static T read(const std::string &s, size_t offset) {
+    T v;
+    std::memcpy(&v, s.data() + offset, sizeof(T));
+    return v;
+}
+
+/**
+ * Name of each section of the object file `s`, in header order
+ */
+static std::vector<std::string> section_names(const std::string &s) {
+    Elf64_Ehdr e = read<Elf64_Ehdr>(s, 0);
+    Elf64_Shdr names = read<Elf64_Shdr>(s, e.e_shoff + e.e_shstrndx * sizeof(Elf64_Shdr));
+    std::vector<std::string> v;
+    for (size_t i = 0; i < e.e_shnum; ++i) {
+        Elf64_Shdr h = read<Elf64_Shdr>(s, e.e_shoff + i * sizeof(Elf64_Shdr));
+        v.emplace_back(s.data() + names.sh_offset + h.sh_name);
+    }
+    return v;
+}
+
+/**
+ * int main(void) { puts(<litteral>); return 42; } with the litteral taken from a LitteralPool
+ */
+static ObjectFile hello(LitteralPool &pool) {
+    pool.add("not used", Encoding::Utf32);
+    LitteralPool::Id id = pool.add("hello from xcomp", Encoding::Utf8);
+
+    ObjectFile o;
+    o.reserve(SectionId::Text, 64, 2);
+    SymbolId str = emit_litterals(o, pool);
+    SymbolId puts = o.declare("puts", ObjectFile::Binding::Global, ObjectFile::SymbolKind::Function);
+    Assembler a(o);
+    uint64_t main = a.offset();
+    a.push(Reg::Rbp);
+    a.mov(Reg::Rbp, Reg::Rsp);
+    a.lea(Reg::Rdi, str, static_cast<int64_t>(pool.entry(id).offset));
+    a.call(puts);
+    a.mov(Reg::Rax, 42);
+    a.pop(Reg::Rbp);
+    a.ret();
+    a.finish();
+    o.define("main", SectionId::Text, main, a.offset() - main, ObjectFile::Binding::Global, ObjectFile::SymbolKind::Function);
+    return o;
+}
+
+TEST(ElfTest, layout) {
+    LitteralPool pool;
+    std::string s;
+    hello(pool).write(s);
+
+    Elf64_Ehdr e = read<Elf64_Ehdr>(s, 0);
+    EXPECT_EQ(std::memcmp(e.e_ident, ELFMAG, SELFMAG), 0);
+    EXPECT_EQ(e.e_ident[EI_CLASS], ELFCLASS64);
+    EXPECT_EQ(e.e_type, ET_REL);
+    EXPECT_EQ(e.e_machine, EM_X86_64);
+    EXPECT_EQ(e.e_shoff % 8, 0);
+    EXPECT_EQ(section_names(s), (std::vector<std::string>{"", ".text", ".rodata", ".data", ".bss", ".note.GNU-stack", ".rela.text", ".symtab",
+                                                          ".strtab", ".shstrtab"}));
+
+    // The pool is copied as is into .rodata
+    Elf64_Shdr rodata = read<Elf64_Shdr>(s, e.e_shoff + 2 * sizeof(Elf64_Shdr));
+    EXPECT_EQ(s.substr(rodata.sh_offset, rodata.sh_size), pool.data());
+    EXPECT_EQ(rodata.sh_addralign, 4);
+
+    // null, .Lstr, then the globals main and puts
+    Elf64_Shdr symtab = read<Elf64_Shdr>(s, e.e_shoff + 7 * sizeof(Elf64_Shdr));
+    EXPECT_EQ(symtab.sh_size / sizeof(Elf64_Sym), 4);
+    EXPECT_EQ(symtab.sh_info, 2);
+    Elf64_Shdr rela = read<Elf64_Shdr>(s, e.e_shoff + 6 * sizeof(Elf64_Shdr));
+    EXPECT_EQ(rela.sh_size / sizeof(Elf64_Rela), 2);
+    EXPECT_EQ(rela.sh_info, 1);
+    EXPECT_EQ(rela.sh_link, 7);
+}
+
+TEST(ElfTest, escaped_litterals) {
+    // The bytes of the converted litterals: "\xff" is the byte FF, "\u00FF" its UTF-8 encoding
+    LitteralPool pool;
+    LitteralPool::Id ids[2];
+    const char *sources[] = {"\"\\xff-\\0z\"", "u8\"\\u00FF\""};
+    for (int i = 0; i < 2; ++i) {
+        Lexer l(sources[i]);
+        Token t = l.next();
+        convert_escape_sequence(t);
+        ids[i] = pool.add(t);
+    }
+    ObjectFile o;
+    emit_litterals(o, pool);
+    std::string s;
+    o.write(s);
+
+    Elf64_Ehdr e = read<Elf64_Ehdr>(s, 0);
+    Elf64_Shdr rodata = read<Elf64_Shdr>(s, e.e_shoff + 2 * sizeof(Elf64_Shdr));
+    ASSERT_EQ(section_names(s)[2], ".rodata");
+    EXPECT_EQ(s.substr(rodata.sh_offset + pool.entry(ids[0]).offset, pool.entry(ids[0]).size), std::string("\xFF-\0z\0", 5));
+    EXPECT_EQ(s.substr(rodata.sh_offset + pool.entry(ids[1]).offset, pool.entry(ids[1]).size), std::string("\xC3\xBF\0", 3));
+}
+
+TEST(ElfTest, errors) {
+    ThrowOnFatal guard;
+    std::ostringstream os;
+    DiagnosticsTo to(os);
+    ObjectFile o;
+    SymbolId f = o.define("f", SectionId::Text, 0, 0, ObjectFile::Binding::Global, ObjectFile::SymbolKind::Function);
+    EXPECT_THROW(o.define(f, SectionId::Text, 0), FatalError);
+
+    o.declare("l", ObjectFile::Binding::Local);
+    std::string s;
+    EXPECT_THROW(o.write(s), FatalError);
+}
+
+TEST(ElfTest, links_with_the_system_linker) {
+    if (std::system("cc --version > /dev/null 2>&1") != 0) {
+        GTEST_SKIP() << "no cc to link with";
+    }
+    LitteralPool pool;
+    std::string s;
+    hello(pool).write(s);
+    std::ofstream("elf_test_hello.o", std::ios::binary) << s;
+
+    ASSERT_EQ(std::system("cc elf_test_hello.o -o elf_test_hello"), 0);
+    int status = std::system("./elf_test_hello > elf_test_hello.txt");
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 42);
+    std::ostringstream out;
+    out << std::ifstream("elf_test_hello.txt").rdbuf();
+    EXPECT_EQ(out.str(), "hello from xcomp\n");
+
+    for (const char *f : {"elf_test_hello.o", "elf_test_hello", "elf_test_hello.txt"}) {
+        std::remove(f);
+    }
+}
@@ -0,0 +1,114 @@
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "backend/x86_64.hpp"
+#include "tools/error.hpp"
+
+/**
+ * Bytes of .text in hexadecimal, space separated
+ */
+static std::string hex(const ObjectFile &o) {
+    std::ostringstream os;
+    os << std::hex;
+    for (char c : o.section(SectionId::Text).bytes) {
+        unsigned b = static_cast<unsigned char>(c);
+        os << (os.tellp() ? " " : "") << (b < 16 ? "0" : "") << b;
+    }
+    return os.str();
+}
+
+template <typename F> static std::string encode(F f) {
+    ObjectFile o;
+    Assembler a(o);
+    f(a);
+    return hex(o);
+}
+
+// Expected bytes are the ones of GNU as
+TEST(X86_64Test, moves) {
+    EXPECT_EQ(encode([](Assembler &a) { a.mov(Reg::Rax, Reg::Rbx); }), "48 89 d8");
+    EXPECT_EQ(encode([](Assembler &a) { a.mov(Reg::R12, Reg::Rsi); }), "49 89 f4");
+    EXPECT_EQ(encode([](Assembler &a) { a.mov(Reg::Rdx, Mem{Reg::Rsp, 8}); }), "48 8b 54 24 08");
+    EXPECT_EQ(encode([](Assembler &a) { a.mov(Mem{Reg::Rbp}, Reg::R9); }), "4c 89 4d 00");
+    EXPECT_EQ(encode([](Assembler &a) { a.mov(Mem{Reg::R13, 0x1000}, Reg::Rax); }), "49 89 85 00 10 00 00");
+    EXPECT_EQ(encode([](Assembler &a) { a.mov(Reg::Rcx, Mem{Reg::R12, -4}); }), "49 8b 4c 24 fc");
+    EXPECT_EQ(encode([](Assembler &a) { a.lea(Reg::Rdi, Mem{Reg::Rbx, 16}); }), "48 8d 7b 10");
+    EXPECT_EQ(encode([](Assembler &a) {
+                  a.push(Reg::Rbp);
+                  a.push(Reg::R15);
+                  a.pop(Reg::Rbx);
+                  a.pop(Reg::R12);
+              }),
+              "55 41 57 5b 41 5c");
+}
+
+TEST(X86_64Test, immediates) {
+    EXPECT_EQ(encode([](Assembler &a) { a.mov(Reg::Rax, 42); }), "b8 2a 00 00 00");
+    EXPECT_EQ(encode([](Assembler &a) { a.mov(Reg::R10, 0xffffffff); }), "41 ba ff ff ff ff");
+    EXPECT_EQ(encode([](Assembler &a) { a.mov(Reg::Rax, -1); }), "48 c7 c0 ff ff ff ff");
+    EXPECT_EQ(encode([](Assembler &a) { a.mov(Reg::Rax, 0x123456789); }), "48 b8 89 67 45 23 01 00 00 00");
+    EXPECT_EQ(encode([](Assembler &a) { a.sub(Reg::R8, 1); }), "49 83 e8 01");
+    EXPECT_EQ(encode([](Assembler &a) { a.cmp(Reg::Rdi, 1000); }), "48 81 ff e8 03 00 00");
+    EXPECT_EQ(encode([](Assembler &a) { a.and_(Reg::R11, -16); }), "49 83 e3 f0");
+}
+
+TEST(X86_64Test, arithmetic) {
+    EXPECT_EQ(encode([](Assembler &a) { a.add(Reg::Rax, Reg::Rcx); }), "48 01 c8");
+    EXPECT_EQ(encode([](Assembler &a) { a.xor_(Reg::Rax, Reg::Rax); }), "48 31 c0");
+    EXPECT_EQ(encode([](Assembler &a) { a.imul(Reg::Rdx, Reg::R9); }), "49 0f af d1");
+    EXPECT_EQ(encode([](Assembler &a) { a.test(Reg::Rax, Reg::Rax); }), "48 85 c0");
+    EXPECT_EQ(encode([](Assembler &a) { a.set(Cond::E, Reg::Rax); }), "0f 94 c0");
+    EXPECT_EQ(encode([](Assembler &a) { a.set(Cond::Ne, Reg::Rsi); }), "40 0f 95 c6");
+    EXPECT_EQ(encode([](Assembler &a) { a.set(Cond::L, Reg::R9); }), "41 0f 9c c1");
+    EXPECT_EQ(encode([](Assembler &a) {
+                  a.ret();
+                  a.syscall();
+                  a.nop();
+              }),
+              "c3 0f 05 90");
+}
+
+TEST(X86_64Test, labels) {
+    // Backward and forward branches, the forward one is patched by bind()
+    EXPECT_EQ(encode([](Assembler &a) {
+                  Assembler::Label top = a.label();
+                  Assembler::Label out = a.label();
+                  a.bind(top);
+                  a.j(Cond::E, out);
+                  a.jmp(top);
+                  a.bind(out);
+                  a.finish();
+              }),
+              "0f 84 05 00 00 00 e9 f5 ff ff ff");
+
+    ThrowOnFatal guard;
+    std::ostringstream os;
+    DiagnosticsTo to(os);
+    EXPECT_THROW(encode([](Assembler &a) {
+                     a.jmp(a.label());
+                     a.finish();
+                 }),
+                 FatalError);
+}
+
+TEST(X86_64Test, relocations) {
+    ObjectFile o;
+    SymbolId puts = o.declare("puts");
+    SymbolId str = o.declare(".Lstr", ObjectFile::Binding::Local);
+    Assembler a(o);
+    a.lea(Reg::Rdi, str, 8);
+    a.call(puts);
+    EXPECT_EQ(hex(o), "48 8d 3d 00 00 00 00 e8 00 00 00 00");
+
+    const std::vector<RelocationEntry> &r = o.section(SectionId::Text).relocations;
+    ASSERT_EQ(size(r), 2);
+    EXPECT_EQ(r[0].offset, 3);
+    EXPECT_EQ(r[0].symbol, str);
+    EXPECT_EQ(r[0].type, Relocation::Pc32);
+    EXPECT_EQ(r[0].addend, 4);
+    EXPECT_EQ(r[1].offset, 8);
+    EXPECT_EQ(r[1].symbol, puts);
+    EXPECT_EQ(r[1].type, Relocation::Plt32);
+    EXPECT_EQ(r[1].addend, -4);
+}
@@ -0,0 +1 @@
+char c = '\q';
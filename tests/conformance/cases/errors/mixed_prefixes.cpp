@@ -0,0 +1 @@
+auto s = u"a" U"b";
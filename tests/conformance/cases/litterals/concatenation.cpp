@@ -0,0 +1,2 @@
+const char *s = "a"
+    "b"  u8"c" R"(\q)";
@@ -0,0 +1,3 @@
+const char *s = "a\tb" "\x41\101" u8"\u00e9";
+char c = '\n';
+const char32_t *u = U"\U0001F600";
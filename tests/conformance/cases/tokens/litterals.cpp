@@ -0,0 +1 @@
+x = u8R"d(a\b)d" L'c' 42;
@@ -0,0 +1,2 @@
+a<:1:> += b->*c <=> d::e;
+#define f(x) #x ## y
@@ -0,0 +1,136 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "conformance/runner.hpp"
+#include "tests/temp_dir.hpp"
+
+TEST(RunnerTest, actual_output) {
+    EXPECT_EQ(actual_output(Expectation::Tokens, Standard::Cxx20, "a  +=\n u8\"b\";"),
+              "Identifier a\nOpOrPunctuator +=\nStringLitteral u8\"b\"\nOpOrPunctuator ;\n");
+    EXPECT_EQ(actual_output(Expectation::Tokens, Standard::C17, "a::b"), "Identifier a\nOpOrPunctuator :\nOpOrPunctuator :\nIdentifier b\n");
+    EXPECT_EQ(actual_output(Expectation::Litterals, Standard::Cxx20, "f('\\'', \"a\\n\" \"\\\"\", u8\"\\u00e9\");"),
+              "'\\''\n\"a\\x0a\\\"\"\nu8\"\\xc3\\xa9\"\n");
+    EXPECT_EQ(actual_output(Expectation::Error, Standard::Cxx20, "'\\q'"), "bad escape sequence\n");
+    EXPECT_EQ(actual_output(Expectation::Error, Standard::Cxx20, "'q'"), "no error\n");
+    EXPECT_EQ(actual_output(Expectation::Litterals, Standard::Cxx20, "'\\q'"), "error: bad escape sequence\n");
+}
+
+TEST(RunnerTest, slow_cases) {
+    std::vector<CaseResult> results(5);
+    for (CaseResult &r : results) {
+        r.ns = 2'000'000;
+        r.bytes = 1000;
+    }
+    // 30 times slower per byte, and a case as slow per byte but too short to matter
+    results[1].ns = 60'000'000;
+    results[3].ns = 600'000;
+    results[3].bytes = 10;
+    EXPECT_EQ(slow_cases(results, 10, 1'000'000), (std::vector<size_t>{1}));
+    EXPECT_EQ(slow_cases(results, 10, 0), (std::vector<size_t>{1, 3}));
+    EXPECT_TRUE(slow_cases({}, 10, 0).empty());
+}
+
+TEST(RunnerTest, case_key) {
+    uint64_t k = case_key(1, Expectation::Tokens, "a", "b");
+    EXPECT_EQ(k, case_key(1, Expectation::Tokens, "a", "b"));
+    EXPECT_NE(k, case_key(2, Expectation::Tokens, "a", "b"));
+    EXPECT_NE(k, case_key(1, Expectation::Error, "a", "b"));
+    EXPECT_NE(k, case_key(1, Expectation::Tokens, "ab", ""));
+    EXPECT_NE(k, case_key(1, Expectation::Tokens, "a", "c"));
+}
+
+class RunnerCorpusTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        std::filesystem::create_directories(dir + "/sub");
+        write("a.cpp", "int a;\n");
+        write("a.tokens", "Identifier int\nIdentifier a\nOpOrPunctuator ;\n");
+        write("sub/b.c", "char c = '\\q';\n");
+        write("sub/b.error", "bad escape sequence\n");
+    }
+    void write(const std::string &name, const std::string &content) { std::ofstream(dir + "/" + name, std::ios::binary) << content; }
+
+    std::string run(RunnerOptions o) {
+        o.dirs = {dir};
+        o.jobs = 2;
+        o.cache = cache;
+        o.report = report;
+        std::ostringstream out;
+        status = run_conformance(o, out);
+        return out.str();
+    }
+
+    TempDir tmp{"runner_test"};
+    std::string dir = tmp.path() + "/corpus"; // in `tmp` with the cache and the report
+    std::string cache = tmp.path() + "/runner_test.cache";
+    std::string report = tmp.path() + "/runner_test.csv";
+    int status = 0;
+};
+
+TEST_F(RunnerCorpusTest, find_cases) {
+    std::vector<Case> cases = find_cases(dir);
+    ASSERT_EQ(size(cases), 2);
+    EXPECT_EQ(cases[0].name, "a.tokens");
+    EXPECT_EQ(cases[0].kind, Expectation::Tokens);
+    EXPECT_EQ(cases[1].name, "sub/b.error");
+    EXPECT_EQ(cases[1].source, dir + "/sub/b.c");
+}
+
+TEST_F(RunnerCorpusTest, results_are_cached) {
+    RunnerOptions o;
+    o.compiler = 1;
+    EXPECT_NE(run(o).find("2 cases, 2 passed, 0 failed, 0 cached"), std::string::npos);
+    EXPECT_EQ(status, EXIT_SUCCESS);
+    EXPECT_NE(run(o).find("2 cases, 2 passed, 0 failed, 2 cached"), std::string::npos);
+
+    // A new compiler runs every case again, a changed case only itself
+    write("a.cpp", "int  a ;");
+    EXPECT_NE(run(o).find("2 passed, 0 failed, 1 cached"), std::string::npos);
+    o.compiler = 2;
+    EXPECT_NE(run(o).find("2 passed, 0 failed, 0 cached"), std::string::npos);
+
+    std::ostringstream csv;
+    csv << std::ifstream(report).rdbuf();
+    EXPECT_EQ(csv.str().rfind("case,status,cached,ns,bytes\na.tokens,pass,0,", 0), 0);
+}
+
+TEST_F(RunnerCorpusTest, failures) {
+    write("a.cpp", "int b;\n");
+    RunnerOptions o;
+    std::string out = run(o);
+    EXPECT_EQ(out.rfind("FAIL a.tokens: line 2: expected 'Identifier a', got 'Identifier b'\n"
+                        "2 cases, 1 passed, 1 failed, 0 cached, 0 slow in ",
+                        0),
+              0);
+    EXPECT_EQ(status, EXIT_FAILURE);
+}
+
+TEST_F(RunnerCorpusTest, update) {
+    write("a.cpp", "b;\n");
+    RunnerOptions o;
+    o.update = true;
+    EXPECT_NE(run(o).find("updated a.tokens\n"), std::string::npos);
+    EXPECT_EQ(status, EXIT_SUCCESS);
+    std::ostringstream tokens;
+    tokens << std::ifstream(dir + "/a.tokens").rdbuf();
+    EXPECT_EQ(tokens.str(), "Identifier b\nOpOrPunctuator ;\n");
+}
+
+TEST(RunnerTest, options) {
+    RunnerOptions o = parse_runner_options({"-j3", "--cache=c", "--report=r.csv", "--update", "--slow-factor=4", "--slow-ms=0.5", "d1", "d2"});
+    EXPECT_EQ(o.jobs, 3);
+    EXPECT_EQ(o.cache, "c");
+    EXPECT_EQ(o.report, "r.csv");
+    EXPECT_TRUE(o.update);
+    EXPECT_DOUBLE_EQ(o.slow_factor, 4);
+    EXPECT_EQ(o.slow_ns, 500'000);
+    EXPECT_EQ(o.dirs, (std::vector<std::string>{"d1", "d2"}));
+
+    EXPECT_DEATH(parse_runner_options({}), "no corpus directory");
+    EXPECT_DEATH(parse_runner_options({"-jx", "d"}), "invalid -j argument 'x'");
+    EXPECT_DEATH(parse_runner_options({"--slow", "d"}), "unrecognized command-line option '--slow'");
+}
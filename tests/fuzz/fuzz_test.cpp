@@ -0,0 +1,88 @@
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "fuzz/targets.hpp"
+#include "tools/stats.hpp"
+
+static int lexer(uint8_t selector, const std::string &source) {
+    std::string data = static_cast<char>(selector) + source;
+    return fuzz_lexer(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+}
+
+static int escape(uint8_t selector, const std::string &lexeme) {
+    std::string data = static_cast<char>(selector) + lexeme;
+    return fuzz_escape_sequence(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+}
+
+static std::string repeat(const std::string &s, size_t n) {
+    std::string r;
+    r.reserve(size(s) * n);
+    for (size_t i = 0; i < n; ++i) {
+        r += s;
+    }
+    return r;
+}
+
+// Inputs which crashed, or were quadratic, before the targets existed
+TEST(FuzzTest, regressions) {
+    const std::string sources[] = {"'\\x'", "u8\"\\u12", "'\\U0001'", "\"\\", "''", "R\"abc(", "R\"" + std::string(20, 'd'), "'", "0x"};
+    for (uint8_t selector = 0; selector < 8; ++selector) {
+        for (const std::string &s : sources) {
+            EXPECT_EQ(lexer(selector, s), 0) << s;
+        }
+    }
+    const std::string lexemes[] = {"\\x", "\\u12", "\\U0001F", "a\\", "", "\\", "\\777", "\\x123456789"};
+    for (uint8_t selector = 0; selector < 16; ++selector) {
+        for (const std::string &s : lexemes) {
+            EXPECT_EQ(escape(selector, s), 0) << s;
+        }
+    }
+}
+
+// Each target aborts past its time budget, so these only have to run: a quadratic path would take hours on them
+TEST(FuzzTest, worst_cases) {
+    constexpr size_t n = 1 << 18;
+    const std::string delimiter(16, 'd');
+    const std::string sources[] = {
+        "R\"" + delimiter + "(" + repeat(")" + delimiter.substr(1) + "\"", n / 16) + ")" + delimiter + "\"", // near matches of the end
+        "R\"" + delimiter + "(" + repeat(")", n),                                                          // unterminated
+        "\"" + repeat("\\\\", n) + "\"",
+        "\"" + repeat("\\x41", n / 4) + "\"",
+        "u\"" + repeat("\\u00e9", n / 6) + "\"",
+        repeat("/*", n / 2),
+        repeat("a", n),
+    };
+    for (const std::string &s : sources) {
+        EXPECT_EQ(lexer(4, s), 0);
+    }
+    EXPECT_EQ(escape(0, repeat("\\\\", n)), 0);
+    EXPECT_EQ(escape(3, repeat("\\U0001F600", n / 10)), 0);
+    EXPECT_EQ(escape(0, repeat("\\x", n / 2)), 0);
+}
+
+TEST(FuzzTest, budget) {
+    // A linear pass is a few ns per byte, a quadratic one on 4 KiB is 16 M steps
+    EXPECT_FALSE(over_budget(4096, 4096 * 50, 30));
+    EXPECT_TRUE(over_budget(4096, 4096 * 4096, 30));
+    EXPECT_FALSE(over_budget(0, 1'000'000, 30));
+    EXPECT_GE(linear_ns_per_byte(), 1);
+}
+
+// Twice the input takes at most about twice the time
+TEST(FuzzTest, linear) {
+    auto ns = [](size_t n) {
+        std::string s = "R\"delim(" + repeat(")delim", n) + ")delim\"";
+        uint64_t best = UINT64_MAX;
+        for (int i = 0; i < 3; ++i) {
+            uint64_t start = Stats::now_ns();
+            lexer(4, s);
+            best = std::min(best, Stats::now_ns() - start);
+        }
+        return best;
+    };
+    uint64_t small = ns(1 << 15);
+    uint64_t large = ns(1 << 17);
+    // 4 times the input, quadratic would be 16 times the time
+    EXPECT_LT(large, 10 * small + 1'000'000);
+}
@@ -0,0 +1,167 @@
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "parser/parser.hpp"
+#include "tools/arena.hpp"
+#include "tools/error.hpp"
+
+static std::vector<Token> lex(const std::string &source, Standard standard = Standard::Cxx20) {
+    std::vector<Token> tokens;
+    with_lexer(standard, source, std::pmr::get_default_resource(), LexerEngine::Dfa, [&tokens](auto &l) {
+        for (Token t = l.next();; t = l.next()) {
+            tokens.push_back(t);
+            if (t.is(Token::Type::End)) {
+                return;
+            }
+        }
+    });
+    return tokens;
+}
+
+/**
+ * Children of the Unit node of `source`, one per line, or the fatal error which stopped the parser
+ */
+static std::string parse(const std::string &source, Standard standard = Standard::Cxx20) {
+    std::ostringstream os;
+    DiagnosticsTo to(os);
+    ThrowOnFatal guard;
+    std::vector<Token> tokens = lex(source, standard);
+    Ast ast;
+    try {
+        NodeId unit = Parser(tokens, ast, standard).parse();
+        for (NodeId c : ast.children(unit)) {
+            ast.dump(os, c, tokens);
+            os << '\n';
+        }
+    } catch (const FatalError &e) {
+        os << "fatal: " << e.what() << '\n';
+    }
+    return os.str();
+}
+
+TEST(ParserTest, precedence) {
+    EXPECT_EQ(parse("a + b * c;"), "(ExpressionStatement (Binary + (Name a) (Binary * (Name b) (Name c))))\n");
+    EXPECT_EQ(parse("a - b - c;"), "(ExpressionStatement (Binary - (Binary - (Name a) (Name b)) (Name c)))\n");
+    EXPECT_EQ(parse("a = b += c;"), "(ExpressionStatement (Binary = (Name a) (Binary += (Name b) (Name c))))\n");
+    EXPECT_EQ(parse("a || b && c | d ^ e & f == g < h << i;"),
+              "(ExpressionStatement (Binary || (Name a) (Binary && (Name b) (Binary | (Name c) (Binary ^ (Name d) (Binary & (Name e) "
+              "(Binary == (Name f) (Binary < (Name g) (Binary << (Name h) (Name i))))))))))\n");
+    EXPECT_EQ(parse("a ? b : c ? d : e;"), "(ExpressionStatement (Conditional (Name a) (Name b) (Conditional (Name c) (Name d) (Name e))))\n");
+    EXPECT_EQ(parse("a, b = 1;"), "(ExpressionStatement (Binary , (Name a) (Binary = (Name b) (Number 1))))\n");
+    EXPECT_EQ(parse("(a + b) * c;"), "(ExpressionStatement (Binary * (Binary + (Name a) (Name b)) (Name c)))\n");
+}
+
+TEST(ParserTest, operators_come_from_the_lexer) {
+    // Digraphs and alternative tokens are the operator they stand for
+    EXPECT_EQ(parse("a<:1:> and not b;"), "(ExpressionStatement (Binary && (Index (Name a) (Number 1)) (Unary ! (Name b))))\n");
+    EXPECT_EQ(parse("a bitor b xor_eq c;"), "(ExpressionStatement (Binary ^= (Binary | (Name a) (Name b)) (Name c)))\n");
+    // In C they are identifiers, operators only once <iso646.h> is expanded
+    EXPECT_EQ(parse("a<:1:> and b;", Standard::C17), "fatal: expected ';' before 'and'\n");
+    EXPECT_EQ(parse("not;", Standard::C11), "(ExpressionStatement (Name not))\n");
+}
+
+TEST(ParserTest, unary_and_postfix) {
+    EXPECT_EQ(parse("-*p++;"), "(ExpressionStatement (Unary - (Unary * (Postfix ++ (Name p)))))\n");
+    EXPECT_EQ(parse("++a.b->c[2];"), "(ExpressionStatement (Unary ++ (Index (Member -> c (Member . b (Name a))) (Number 2))))\n");
+    EXPECT_EQ(parse("f();"), "(ExpressionStatement (Call (Name f)))\n");
+    EXPECT_EQ(parse("f(a, b = 2)(c);"), "(ExpressionStatement (Call (Call (Name f) (Name a) (Binary = (Name b) (Number 2))) (Name c)))\n");
+    EXPECT_EQ(parse("sizeof a + sizeof(int *);"),
+              "(ExpressionStatement (Binary + (SizeofExpr (Name a)) (SizeofType (TypeName (Specifier int) (Pointer * (Declarator))))))\n");
+    EXPECT_EQ(parse("\"a\" \"b\" u8\"c\";"), "(ExpressionStatement (StringLitteral a (StringLitteral b) (StringLitteral c)))\n");
+}
+
+TEST(ParserTest, casts) {
+    EXPECT_EQ(parse("(unsigned long)-a;"),
+              "(ExpressionStatement (Cast (TypeName (Specifier unsigned) (Specifier long) (Declarator)) (Unary - (Name a))))\n");
+    // (T)-a is a cast once T is a typedef name, a subtraction before
+    EXPECT_EQ(parse("(T)-a; typedef int T; (T)-a;"),
+              "(ExpressionStatement (Binary - (Name T) (Name a)))\n"
+              "(Declaration (Specifier typedef) (Specifier int) (InitDeclarator (Declarator T)))\n"
+              "(ExpressionStatement (Cast (TypeName (Specifier T) (Declarator)) (Unary - (Name a))))\n");
+    EXPECT_EQ(parse("(int[]){1, 2,};"),
+              "(ExpressionStatement (Cast (TypeName (Specifier int) (Array (Declarator))) (InitList (Number 1) (Number 2))))\n");
+}
+
+TEST(ParserTest, declarations) {
+    EXPECT_EQ(parse("int *a[3], (*f)(int, char *);"),
+              "(Declaration (Specifier int) (InitDeclarator (Pointer * (Array (Declarator a) (Number 3)))) "
+              "(InitDeclarator (Function (Pointer * (Declarator f)) (Parameter (Specifier int) (Declarator)) "
+              "(Parameter (Specifier char) (Pointer * (Declarator))))))\n");
+    EXPECT_EQ(parse("const char *const p = \"x\";"),
+              "(Declaration (Specifier const) (Specifier char) (InitDeclarator (Pointer * (Declarator p) (Specifier const)) "
+              "(StringLitteral x)))\n");
+    EXPECT_EQ(parse("int printf(const char *, ...), g(void);"),
+              "(Declaration (Specifier int) (InitDeclarator (Function (Declarator printf) (Parameter (Specifier const) (Specifier char) "
+              "(Pointer * (Declarator))) (Parameter ...))) (InitDeclarator (Function (Declarator g))))\n");
+    EXPECT_EQ(parse("struct s *p; int m[2][2] = {{1}, {2, 3}};"),
+              "(Declaration (Specifier struct (Name s)) (InitDeclarator (Pointer * (Declarator p))))\n"
+              "(Declaration (Specifier int) (InitDeclarator (Array (Array (Declarator m) (Number 2)) (Number 2)) "
+              "(InitList (InitList (Number 1)) (InitList (Number 2) (Number 3)))))\n");
+    // A typedef name after a type is the declared name
+    EXPECT_EQ(parse("typedef int T; static long T;"),
+              "(Declaration (Specifier typedef) (Specifier int) (InitDeclarator (Declarator T)))\n"
+              "(Declaration (Specifier static) (Specifier long) (InitDeclarator (Declarator T)))\n");
+    EXPECT_EQ(parse(";int;"), "(Declaration (Specifier int))\n");
+}
+
+TEST(ParserTest, errors) {
+    EXPECT_EQ(parse("a +;"), "fatal: expected expression before ';'\n");
+    EXPECT_EQ(parse("(a"), "fatal: expected ')' before 'end of input'\n");
+    EXPECT_EQ(parse("'a' 'b';"), "fatal: expected ';' before 'b'\n");
+    EXPECT_EQ(parse("a.1;"), "fatal: expected identifier before '1'\n");
+    EXPECT_EQ(parse("int 1;"), "fatal: expected identifier or '(' before '1'\n");
+    EXPECT_EQ(parse("int f(1);"), "fatal: expected parameter declaration before '1'\n");
+    EXPECT_EQ(parse("int f() {}"), "fatal: function definitions are not supported yet\n");
+    EXPECT_EQ(parse("struct s {int a;};"), "fatal: struct definitions are not supported yet\n");
+}
+
+TEST(ParserTest, nesting_too_deep) {
+    constexpr size_t n = 20'000;
+    std::string assignments;
+    std::string conditionals;
+    for (size_t i = 0; i < n; ++i) {
+        assignments += "a=";
+        conditionals += "a?b:";
+    }
+    const std::string sources[] = {std::string(n, '(') + "a" + std::string(n, ')') + ";",
+                                   assignments + "b;",
+                                   "int a = " + std::string(n, '{') + "1" + std::string(n, '}') + ";",
+                                   "int " + std::string(n, '*') + "p;",
+                                   "int " + std::string(n, '(') + "p" + std::string(n, ')') + ";",
+                                   std::string(n, '-') + "a;",
+                                   conditionals + "c;"};
+    for (const std::string &source : sources) {
+        EXPECT_EQ(parse(source), "fatal: nesting too deep\n") << source.substr(0, 16);
+    }
+    // Up to the limit is fine
+    EXPECT_EQ(parse(std::string(100, '(') + "a" + std::string(100, ')') + ";"), "(ExpressionStatement (Name a))\n");
+}
+
+TEST(ParserTest, flat_storage) {
+    std::vector<Token> tokens = lex("a = b * (c + d), f(e, 1);");
+    Arena arena;
+    Ast ast(arena.resource());
+    NodeId unit = Parser(tokens, ast, Standard::Cxx20).parse();
+
+    // Children are created before their parent, so the unit is the last node
+    EXPECT_EQ(unit, ast.size() - 1);
+    for (NodeId id = 0; id < ast.size(); ++id) {
+        for (NodeId c : ast.children(id)) {
+            EXPECT_LT(c, id);
+        }
+    }
+    EXPECT_EQ(ast.children(unit).size(), 1u);
+    EXPECT_EQ(ast[ast.children(unit)[0]].kind, NodeKind::ExpressionStatement);
+    EXPECT_GE(ast.bytes(), ast.size() * sizeof(Node));
+}
+
+TEST(ParserTest, expression_entry_point) {
+    std::vector<Token> tokens = lex("1 + 2 * 3");
+    Ast ast;
+    Parser p(tokens, ast, Standard::Cxx20);
+    NodeId e = p.expression();
+    std::ostringstream os;
+    ast.dump(os, e, tokens);
+    EXPECT_EQ(os.str(), "(Binary + (Number 1) (Binary * (Number 2) (Number 3)))");
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include "preprocessor/expression.hpp"
+
+static std::vector<Token> tokenize(const std::string &s) {
+    Lexer l(s);
+    std::vector<Token> v;
+    for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+        v.push_back(t);
+    }
+    return v;
+}
+
+class ExpressionTest : public ::testing::Test {
+  protected:
+    PPValue eval(const std::string &s) {
+        std::vector<Token> v = tokenize(s);
+        return evaluator.evaluate(v.data(), v.data() + size(v));
+    }
+
+    void define(const std::string &name, const std::string &body) {
+        Macro m;
+        m.name = name;
+        m.body = tokenize(body);
+        state.define(m);
+    }
+
+    PreprocessorState state;
+    ExpressionEvaluator evaluator{state};
+};
+
+using ExpressionDeathTest = ExpressionTest;
+
+class GenerateTest : public testing::TestWithParam<std::tuple<std::string, intmax_t>> {};
+
+const std::vector<std::tuple<std::string, intmax_t>> expressions{
+    {"1", 1},           {"1 + 2 * 3", 7},   {"(1 + 2) * 3", 9},  {"10 / 3", 3},       {"10 % 3", 1},      {"-7 / 2", -3},
+    {"1 << 4", 16},     {"-16 >> 2", -4},   {"1 < 2", 1},        {"2 <= 1", 0},       {"3 == 3", 1},      {"3 != 3", 0},
+    {"6 & 3", 2},       {"6 | 3", 7},       {"6 ^ 3", 5},        {"~0", -1},          {"!5", 0},          {"1 ? 2 : 3", 2},
+    {"0 ? 2 : 3", 3},   {"1 && 0", 0},      {"0 || 7", 1},       {"010", 8},          {"1 - 2 - 3", -4},  {"1 ? 0 ? 4 : 5 : 6", 5},
+    {"not 0", 1},       {"1 and 2", 1},     {"1 bitor 6", 7},    {"true", 1},         {"false", 0},       {"undefined_id", 0},
+    {"'a'", 'a'},       {"'\\n'", '\n'},    {"(0, 4)", 4},       {"-1 < 0", 1},       {"1 << -1", 0},     {"2 >> -1", 4},
+};
+
+TEST_P(GenerateTest, evaluate) {
+    auto [expr, value] = GetParam();
+    PreprocessorState state;
+    ExpressionEvaluator e(state);
+    std::vector<Token> v = tokenize(expr);
+    EXPECT_EQ(e.evaluate(v.data(), v.data() + size(v)).as_signed(), value) << expr;
+}
+
+INSTANTIATE_TEST_SUITE_P(expressions, GenerateTest, testing::ValuesIn(expressions));
+
+TEST_F(ExpressionTest, unsigned_arithmetic) {
+    EXPECT_TRUE(eval("18446744073709551615").is_unsigned);
+    EXPECT_FALSE(eval("-1 < 18446744073709551615").is_true());
+    EXPECT_TRUE(eval("18446744073709551615 + 1 == 0").is_true());
+    EXPECT_TRUE(eval("1 ? 1 : 18446744073709551615").is_unsigned);
+    EXPECT_FALSE(eval("1 == 18446744073709551615").is_unsigned);
+}
+
+TEST_F(ExpressionTest, defined) {
+    define("FOO", "");
+    EXPECT_TRUE(eval("defined FOO").is_true());
+    EXPECT_TRUE(eval("defined(FOO) && !defined ( BAR )").is_true());
+    EXPECT_FALSE(eval("defined BAR").is_true());
+}
+
+TEST_F(ExpressionTest, object_macro) {
+    define("VERSION", "3");
+    define("SUM", "1 + 2");
+    define("NEG", "-1");
+    define("REC", "REC + 1");
+    define("INDIRECT", "VERSION");
+    EXPECT_EQ(eval("VERSION >= 3").as_signed(), 1);
+    EXPECT_EQ(eval("SUM * 3").as_signed(), 7);
+    EXPECT_EQ(eval("NEG < 0").as_signed(), 1);
+    EXPECT_EQ(eval("REC").as_signed(), 1);
+    EXPECT_EQ(eval("INDIRECT * INDIRECT").as_signed(), 9);
+}
+
+TEST_F(ExpressionTest, short_circuit) {
+    EXPECT_FALSE(eval("0 && 1 / 0").is_true());
+    EXPECT_TRUE(eval("1 || 1 % 0").is_true());
+    EXPECT_EQ(eval("1 ? 2 : 1 / 0").as_signed(), 2);
+    EXPECT_EQ(eval("0 ? 1 / 0 : 3").as_signed(), 3);
+}
+
+TEST_F(ExpressionTest, short_circuit_no_lookup) {
+    Macro m;
+    m.name = "F";
+    m.function_like = true;
+    state.define(m);
+    EXPECT_FALSE(eval("0 && F").is_true());
+}
+
+TEST_F(ExpressionTest, memoization) {
+    define("A", "1");
+    EXPECT_TRUE(eval("A == 1").is_true());
+    EXPECT_TRUE(eval("A  ==  1").is_true());
+    EXPECT_EQ(evaluator.memo_hits(), 1u);
+
+    define("A", "2");
+    EXPECT_FALSE(eval("A == 1").is_true());
+    EXPECT_EQ(evaluator.memo_hits(), 1u);
+
+    evaluator.reset();
+    EXPECT_FALSE(eval("A == 1").is_true());
+    EXPECT_EQ(evaluator.memo_hits(), 1u);
+}
+
+TEST_F(ExpressionTest, condition) { EXPECT_TRUE(evaluator.condition(tokenize("2 > 1"))); }
+
+class GenerateDeathTest : public testing::TestWithParam<std::string> {};
+
+const std::vector<std::string> bad_expressions{"",      "1 +",  "(1",     "1 2",          "1 / 0",   "5 % 0", "defined",
+                                               "defined(", "1 ? 2", "\"s\"", "99999999999999999999", "1x", "+"};
+
+TEST_P(GenerateDeathTest, bad_expression) {
+    PreprocessorState state;
+    ExpressionEvaluator e(state);
+    std::vector<Token> v = tokenize(GetParam());
+    EXPECT_DEATH(e.evaluate(v.data(), v.data() + size(v)), "error");
+}
+
+INSTANTIATE_TEST_SUITE_P(bad_expressions, GenerateDeathTest, testing::ValuesIn(bad_expressions));
+
+TEST_F(ExpressionDeathTest, function_macro) {
+    Macro m;
+    m.name = "F";
+    m.function_like = true;
+    state.define(m);
+    EXPECT_DEATH(eval("F"), "not supported");
+}
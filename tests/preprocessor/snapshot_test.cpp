@@ -0,0 +1,118 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include "preprocessor/snapshot.hpp"
+#include "tests/temp_dir.hpp"
+
+class SnapshotTest : public ::testing::Test {
+  protected:
+    static Macro object_macro(const std::string &name, const std::string &value) {
+        Macro m;
+        m.name = name;
+        m.body.emplace_back(Token::Type::Number, value);
+        return m;
+    }
+
+    TempDir tmp{"snapshot_test"};
+    std::string dir = tmp.path();
+    std::string path = dir + "/snapshot_test.xcps";
+};
+
+TEST_F(SnapshotTest, state_define_undefine) {
+    PreprocessorState s;
+    s.define(object_macro("A", "1"));
+    ASSERT_NE(s.find("A"), nullptr);
+    EXPECT_EQ(s.find("A")->body[0].lex(), "1");
+    s.undefine("A");
+    EXPECT_EQ(s.find("A"), nullptr);
+    EXPECT_FALSE(s.is_defined("B"));
+}
+
+TEST_F(SnapshotTest, missing_file) { EXPECT_EQ(Snapshot::open("does_not_exist.xcps"), nullptr); }
+
+TEST_F(SnapshotTest, round_trip) {
+    const std::string prefix = "#include <a.h>\n";
+    {
+        PreprocessorState s;
+        s.define(object_macro("VERSION", "3"));
+        Macro f;
+        f.name = "MAX";
+        f.function_like = true;
+        f.variadic = true;
+        f.parameters = {"a", "b"};
+        f.body.emplace_back(Token::Type::Identifier, "a");
+        f.body.emplace_back(Token::Type::OpOrPunctuator, ">");
+        Token str(Token::Type::StringLitteral, "x");
+        str.prefix("u8");
+        str.raw(true);
+        f.body.push_back(str);
+        s.define(f);
+        s.identifiers().intern("foo");
+        s.include_guard("a.h", "A_H");
+        s.pragma_once("b.h");
+        save_snapshot(s, prefix, path);
+    }
+
+    std::shared_ptr<const Snapshot> snap = Snapshot::open(path);
+    ASSERT_NE(snap, nullptr);
+    EXPECT_EQ(snap->prefix_size(), size(prefix));
+    EXPECT_TRUE(snap->matches(prefix + "int a;"));
+    EXPECT_FALSE(snap->matches("#include <b.h>\nint a;"));
+    EXPECT_FALSE(snap->matches("#include <a.h>\r"));
+    EXPECT_FALSE(snap->matches("#"));
+
+    PreprocessorState s;
+    s.attach(snap);
+    EXPECT_TRUE(s.is_pragma_once("b.h"));
+    ASSERT_NE(s.include_guard("a.h"), nullptr);
+    EXPECT_EQ(*s.include_guard("a.h"), "A_H");
+    Interner::Id id;
+    EXPECT_TRUE(s.identifiers().find("foo", id));
+    EXPECT_TRUE(s.identifiers().find("MAX", id));
+
+    EXPECT_EQ(s.find("NOPE"), nullptr);
+    const Macro *m = s.find("MAX");
+    ASSERT_NE(m, nullptr);
+    EXPECT_TRUE(m->function_like);
+    EXPECT_TRUE(m->variadic);
+    EXPECT_EQ(m->parameters, (std::vector<std::string>{"a", "b"}));
+    ASSERT_EQ(size(m->body), 3u);
+    EXPECT_EQ(m->body[1].type(), Token::Type::OpOrPunctuator);
+    EXPECT_EQ(m->body[1].lex(), ">");
+    EXPECT_EQ(m->body[2].prefix(), "u8");
+    EXPECT_TRUE(m->body[2].raw());
+
+    s.undefine("VERSION");
+    EXPECT_EQ(s.find("VERSION"), nullptr);
+    ASSERT_EQ(size(s.macros()), 1u);
+    EXPECT_EQ(s.macros()[0]->name, "MAX");
+}
+
+TEST_F(SnapshotTest, lookup_many) {
+    PreprocessorState s;
+    for (int i = 0; i < 100; ++i) {
+        s.define(object_macro("M" + std::to_string(i), std::to_string(i)));
+    }
+    save_snapshot(s, "", path);
+
+    auto snap = Snapshot::open(path);
+    ASSERT_NE(snap, nullptr);
+    for (int i = 0; i < 100; ++i) {
+        auto m = snap->macro("M" + std::to_string(i));
+        ASSERT_TRUE(m);
+        EXPECT_EQ(m->body[0].lex(), std::to_string(i));
+    }
+    EXPECT_FALSE(snap->macro("M100"));
+    EXPECT_FALSE(snap->macro(""));
+}
+
+TEST_F(SnapshotTest, bad_magic) {
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << std::string(64, 'x');
+    }
+    EXPECT_EQ(Snapshot::open(path), nullptr);
+}
@@ -0,0 +1,36 @@
+#ifndef TEMP_DIR_HPP
+#define TEMP_DIR_HPP
+
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+/**
+ * Empty directory created for one test under the system temporary directory, removed with its content at the end
+ * Each test gets its own: ctest runs them in parallel
+ */
+class TempDir {
+  public:
+    explicit TempDir(const std::string &name) {
+        std::string pattern = (std::filesystem::temp_directory_path() / (name + ".XXXXXX")).string();
+        if (!mkdtemp(pattern.data())) {
+            throw std::system_error(errno, std::generic_category(), "cannot create " + pattern);
+        }
+        m_path = pattern;
+    }
+    ~TempDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(m_path, ec);
+    }
+    TempDir(const TempDir &) = delete;
+    TempDir &operator=(const TempDir &) = delete;
+
+    const std::string &path() const noexcept { return m_path; }
+
+  private:
+    std::string m_path;
+};
+
+#endif // !TEMP_DIR_HPP
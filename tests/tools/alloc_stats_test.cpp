@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <vector>
+
+#include "tools/alloc_stats.hpp"
+#include "tools/arena.hpp"
+#include "tools/lexer.hpp"
+
+class AllocStatsTest : public ::testing::Test {
+  protected:
+    void SetUp() override { AllocStats::instance().reset(); }
+};
+
+static size_t lex_all(Lexer &l) {
+    size_t n = 0;
+    for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+        ++n;
+    }
+    return n;
+}
+
+static std::string long_identifiers(size_t n) {
+    std::string s;
+    for (size_t i = 0; i < n; ++i) {
+        s += "an_identifier_longer_than_the_small_string_buffer_" + std::to_string(i) + " ";
+    }
+    return s;
+}
+
+TEST_F(AllocStatsTest, small_tokens_do_not_allocate) {
+    Lexer l("int a = b + 42; x <<= 3;");
+    lex_all(l);
+    EXPECT_EQ(AllocStats::instance().counts(AllocCategory::TokenLexeme).allocations, 0);
+    EXPECT_EQ(AllocStats::instance().counts(AllocCategory::OperatorTable).allocations, 0);
+}
+
+TEST_F(AllocStatsTest, lexemes_on_the_heap) {
+    Lexer l(long_identifiers(100));
+    lex_all(l);
+    AllocStats::Counts c = AllocStats::instance().counts(AllocCategory::TokenLexeme);
+    EXPECT_EQ(c.allocations, 100);
+    EXPECT_GE(c.bytes, 100 * 50);
+}
+
+TEST_F(AllocStatsTest, lexemes_in_an_arena) {
+    Arena arena(1 << 16);
+    Lexer l(long_identifiers(100), arena.resource());
+    EXPECT_EQ(lex_all(l), 200);
+    EXPECT_EQ(AllocStats::instance().counts(AllocCategory::TokenLexeme).allocations, 1); // the arena buffer
+}
+
+TEST_F(AllocStatsTest, prefixed_litterals_in_an_arena) {
+    Arena arena(1 << 16);
+    Lexer l("u8\"a string litteral longer than the small string buffer\" LR\"(a raw string longer than the small string buffer)\"",
+            arena.resource());
+    EXPECT_EQ(lex_all(l), 3);
+    EXPECT_EQ(AllocStats::instance().counts(AllocCategory::TokenLexeme).allocations, 1);
+}
+
+TEST_F(AllocStatsTest, diagnostics) {
+    ThrowOnFatal guard;
+    EXPECT_THROW(fatal("a diagnostic message long enough to need the heap"), FatalError);
+    EXPECT_NE(AllocStats::instance().counts(AllocCategory::Diagnostics).allocations, 0);
+}
+
+TEST_F(AllocStatsTest, live_and_peak) {
+    AllocStats &a = AllocStats::instance();
+    uint64_t live = a.live_bytes();
+    {
+        ScopedTimer timer(Phase::Parse);
+        std::vector<char> v(1 << 20);
+        EXPECT_GE(a.live_bytes(), live + (1 << 20));
+    }
+    EXPECT_LT(a.live_bytes(), live + (1 << 20));
+    EXPECT_GE(a.peak_bytes(Phase::Parse), 1 << 20);
+    EXPECT_EQ(a.peak_bytes(Phase::Escape), 0);
+}
+
+TEST_F(AllocStatsTest, table) {
+    std::ostringstream os;
+    AllocStats::instance().print_table(os);
+    EXPECT_NE(os.str().find("token lexemes"), std::string::npos);
+    EXPECT_NE(os.str().find("preprocess"), std::string::npos);
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <memory_resource>
+#include <vector>
+
+#include "tools/arena.hpp"
+#include "tools/lexer.hpp"
+
+class ArenaTest : public ::testing::Test {};
+
+/**
+ * Count the allocations forwarded upstream
+ */
+class CountingResource : public std::pmr::memory_resource {
+  public:
+    size_t allocations = 0;
+    size_t live = 0;
+
+  private:
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        ++allocations;
+        ++live;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+        --live;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+};
+
+static std::vector<Token> lex_all(Lexer &l) {
+    std::vector<Token> v;
+    for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+        v.push_back(std::move(t));
+    }
+    return v;
+}
+
+TEST_F(ArenaTest, tokens_use_the_arena) {
+    CountingResource upstream;
+    Arena arena(1024, &upstream);
+    Lexer l("const char *a_rather_long_identifier_name = \"a string litteral which does not fit in place\";", arena.resource());
+    std::vector<Token> tokens = lex_all(l);
+
+    ASSERT_EQ(size(tokens), 11);
+    EXPECT_EQ(tokens[5].lex(), "a_rather_long_identifier_name");
+    EXPECT_EQ(tokens[5].resource(), arena.resource());
+    EXPECT_EQ(tokens[9].lex(), "a string litteral which does not fit in place");
+    EXPECT_EQ(upstream.allocations, 1);
+}
+
+TEST_F(ArenaTest, reset_releases_everything) {
+    CountingResource upstream;
+    Arena arena(16, &upstream);
+    {
+        Lexer l("int an_identifier_longer_than_the_small_string_buffer = 0;", arena.resource());
+        lex_all(l);
+    }
+    EXPECT_NE(upstream.live, 0);
+    arena.reset();
+    EXPECT_EQ(upstream.live, 0);
+}
+
+TEST_F(ArenaTest, copy_leaves_the_arena) {
+    Arena arena;
+    Token t(Token::Type::Identifier, "an_identifier_longer_than_the_small_string_buffer", arena.resource());
+    t.prefix("u8");
+
+    Token c(t);
+    EXPECT_EQ(c.resource(), std::pmr::get_default_resource());
+    EXPECT_EQ(c.lex(), t.lex());
+    EXPECT_EQ(c.prefix(), "u8");
+}
@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include "tools/file_cache.hpp"
+
+class FileCacheTest : public ::testing::Test {
+  protected:
+    void TearDown() override {
+        for (const std::string &f : files) {
+            std::remove(f.c_str());
+        }
+    }
+
+    std::string write(const std::string &name, const std::string &content) {
+        std::ofstream(name, std::ios::binary | std::ios::trunc) << content;
+        files.push_back(name);
+        return name;
+    }
+
+    std::vector<std::string> files;
+};
+
+TEST_F(FileCacheTest, read_once) {
+    FileCache cache;
+    std::string f = write("file_cache_a.txt", "int a;");
+    FileCache::Content c = cache.read(f);
+    ASSERT_NE(c, nullptr);
+    EXPECT_EQ(c->text, "int a;");
+    EXPECT_EQ(c->hash, content_hash("int a;"));
+    EXPECT_EQ(cache.read(f), c);
+    EXPECT_EQ(cache.misses(), 1);
+    EXPECT_EQ(cache.hits(), 1);
+    EXPECT_EQ(cache.bytes(), 6);
+}
+
+TEST_F(FileCacheTest, missing) {
+    FileCache cache;
+    EXPECT_EQ(cache.read("file_cache_missing.txt"), nullptr);
+    EXPECT_EQ(cache.size(), 0);
+}
+
+TEST_F(FileCacheTest, invalidated_on_change) {
+    FileCache cache;
+    std::string f = write("file_cache_b.txt", "int a;");
+    FileCache::Content c = cache.read(f);
+    write(f, "int bb;");
+    FileCache::Content d = cache.read(f);
+    EXPECT_NE(d, c);
+    EXPECT_EQ(d->text, "int bb;");
+    EXPECT_EQ(cache.size(), 1);
+    EXPECT_EQ(cache.bytes(), 7);
+}
+
+TEST_F(FileCacheTest, same_content_is_kept) {
+    FileCache cache;
+    std::string f = write("file_cache_c.txt", "int a;");
+    FileCache::Content c = cache.read(f);
+    std::remove(f.c_str());
+    write(f, "int a;"); // new inode, same content
+    EXPECT_EQ(cache.read(f), c);
+    EXPECT_EQ(cache.misses(), 2);
+}
+
+TEST_F(FileCacheTest, lru_budget) {
+    FileCache cache(10);
+    std::string a = write("file_cache_d.txt", "aaaa");
+    std::string b = write("file_cache_e.txt", "bbbb");
+    std::string c = write("file_cache_f.txt", "cccc");
+    cache.read(a);
+    cache.read(b);
+    cache.read(a); // b is now the oldest
+    cache.read(c);
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_EQ(cache.bytes(), 8);
+    EXPECT_NE(cache.find(a), nullptr);
+    EXPECT_EQ(cache.find(b), nullptr);
+    EXPECT_NE(cache.find(c), nullptr);
+}
+
+TEST_F(FileCacheTest, over_budget_entry_is_not_kept) {
+    FileCache cache(3);
+    std::string a = write("file_cache_g.txt", "aaaa");
+    FileCache::Content c = cache.read(a);
+    ASSERT_NE(c, nullptr);
+    EXPECT_EQ(c->text, "aaaa");
+    EXPECT_EQ(cache.size(), 0);
+}
+
+TEST_F(FileCacheTest, insert) {
+    FileCache cache;
+    std::string a = write("file_cache_h.txt", "int a;");
+    FileCache::Content c = cache.insert(a, "int a;");
+    EXPECT_EQ(cache.find(a), c);
+    EXPECT_EQ(cache.insert(a, "other"), c);
+    EXPECT_EQ(cache.read(a), c);
+    EXPECT_EQ(cache.hits(), 1);
+}
+
+TEST_F(FileCacheTest, key_is_absolute) {
+    FileCache cache;
+    std::string a = write("file_cache_i.txt", "x");
+    FileCache::Content c = cache.read(a);
+    EXPECT_EQ(cache.read("./" + a), c);
+    EXPECT_EQ(cache.size(), 1);
+}
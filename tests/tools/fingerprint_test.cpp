@@ -0,0 +1,64 @@
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "tools/error.hpp"
+#include "tools/fingerprint.hpp"
+
+static uint64_t cxx(const std::string &s) { return fingerprint(Standard::Cxx20, s); }
+
+TEST(FingerprintTest, formatting_is_ignored) {
+    EXPECT_EQ(cxx("int a = b+c;\n"), cxx("int a=b + c ;"));
+    EXPECT_EQ(cxx("int a;\nint b;\n"), cxx("\n\n    int a;\n\n\n\tint b;"));
+    // Spelling of a litteral which decodes to the same content
+    EXPECT_EQ(cxx("s = \"\\x41\";"), cxx("s = \"A\";"));
+}
+
+TEST(FingerprintTest, tokens_are_not_ignored) {
+    EXPECT_NE(cxx("int a;"), cxx("int b;"));
+    EXPECT_NE(cxx("a b"), cxx("ab"));
+    EXPECT_NE(cxx("a + + b"), cxx("a ++ b"));
+    EXPECT_NE(cxx("\"a b\""), cxx("\"a  b\""));
+    EXPECT_NE(cxx("u8\"a\""), cxx("u8 \"a\""));
+    EXPECT_NE(cxx("u8\"a\""), cxx("\"a\""));
+    EXPECT_NE(cxx("'a'"), cxx("\"a\""));
+    EXPECT_NE(cxx("x = 123456789012;"), cxx("x = 123456789013;"));
+    EXPECT_NE(cxx(""), cxx(";"));
+}
+
+TEST(FingerprintTest, directives) {
+    // The end of a directive and the space after a macro name are not formatting
+    EXPECT_NE(cxx("#define F (x)\n"), cxx("#define F(x)\n"));
+    EXPECT_NE(cxx("#define A\nint a;"), cxx("#define A int a;"));
+    EXPECT_NE(cxx("#define A 1\n"), cxx("#define A 1"));
+    EXPECT_EQ(cxx("#define F(x)  x\n\n"), cxx("  # define F(x) x\n"));
+    EXPECT_EQ(cxx("#define A  1\n"), cxx("#define A\t1\n"));
+    EXPECT_EQ(cxx("#include <a.h>\nint a;\n"), cxx("#include <a.h>\n\n\nint a;"));
+    EXPECT_NE(cxx("a\n#b\n"), cxx("a #b\n"));
+    EXPECT_EQ(cxx("#undef A\n"), cxx("#undef  A\n"));
+}
+
+TEST(FingerprintTest, standard) {
+    // "::" is one token in C++ and two ':' in C
+    EXPECT_NE(fingerprint(Standard::Cxx20, "a::b"), fingerprint(Standard::C17, "a::b"));
+    EXPECT_EQ(fingerprint(Standard::C17, "a::b"), fingerprint(Standard::C17, "a: :b"));
+}
+
+TEST(FingerprintTest, lexing_errors) {
+    ThrowOnFatal guard;
+    std::ostringstream os;
+    DiagnosticsTo to(os);
+    EXPECT_THROW(cxx("'\\q'"), FatalError);
+}
+
+TEST(FingerprintTest, streaming) {
+    // Same value fused in a lexing loop as from fingerprint()
+    std::string source = "const char *s = R\"(x\\y)\"; int  a =\n1;";
+    Fingerprint f;
+    Lexer l(source);
+    l.decode_litterals(true);
+    for (const Token &t : l) {
+        f.add(t);
+    }
+    EXPECT_EQ(f.value(), cxx(source));
+}
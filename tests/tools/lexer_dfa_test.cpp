@@ -0,0 +1,175 @@
+#include <random>
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "tools/lexer_dfa.hpp"
+
+/**
+ * Every token of `source` with its spelling, or the fatal error which stopped the lexer, diagnostics included
+ */
+static std::string lex_all(const std::string &source, Lexer::Engine engine, Standard standard = Standard::Cxx20) {
+    std::ostringstream os;
+    DiagnosticsTo to(os);
+    ThrowOnFatal guard;
+    try {
+        with_lexer(standard, source, std::pmr::get_default_resource(), engine, [&os](auto &l) {
+            for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+                os << t.type() << ' ' << t.prefix() << '|' << t.lex() << '|' << t.raw() << ' ' << t.punctuator() << '\n';
+            }
+        });
+    } catch (const FatalError &e) {
+        os << "fatal: " << e.what() << '\n';
+    }
+    return os.str();
+}
+
+class LexerDfaTest : public testing::TestWithParam<std::string> {};
+
+// The inputs of lexer_test.cpp
+const std::vector<std::string> inputs{
+    "",
+    "\\",
+    "'\\s'",
+    "'\\u123'",
+    "'\\U12345'",
+    "'\\$'",
+    "'e\n'",
+    "'e\xff'",
+    "R\"ccccccccccccccccc(b)a\"",
+    "R\"c\xff(b)a\"",
+    "R\"c(b\xff)a\"",
+    "R\"cc(b)ca\"",
+    "R\"c(b)ce",
+    "a",
+    "\xf4",
+    "\ta",
+    "a\na",
+    "#include <string>",
+    "#include \"file.hpp\"",
+    "int a[6];",
+    "x+++++y",
+    "a..y",
+    "a%:%b",
+    "a<:::b",
+    "a<::>b",
+    "a<::b",
+    "a<:b",
+    "'am'",
+    "'\\x41m'",
+    "'\\U0001F996m'",
+    "u8'a'",
+    "L\"a\"",
+    "uR\"cee(ab)cee\";",
+    "u8R\"cee(ab)cee\";",
+    "=d'a';",
+    "ua u8b Lc Ud Re uRa u8Rb LRc URd",
+    "=R\"cee(d)cee)cee\";",
+    "=R\"(a)\";",
+    "# ## %: %:%:",
+    "<% %> <: :> %: %:%:",
+    "a->*b <=> c <<= d >>= e ... f .* g :: h",
+    "\xce\xb1\xce\xb2 = \xe2\x82\xac;",
+    "\x01",
+    "a = b @ c $ d `",
+};
+
+TEST_P(LexerDfaTest, same_tokens) { EXPECT_EQ(lex_all(GetParam(), Lexer::Engine::Dfa), lex_all(GetParam(), Lexer::Engine::Switch)); }
+
+INSTANTIATE_TEST_SUITE_P(inputs, LexerDfaTest, testing::ValuesIn(inputs));
+
+class LexerStandardTest : public testing::TestWithParam<Standard> {};
+
+TEST_P(LexerStandardTest, random_punctuators) {
+    // Mostly punctuator characters, to hit every path of the DFA and of the "<::" rule
+    const std::string alphabet = std::string(punctuator_chars) + "<:%>.ab1 \n";
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> pick(0, size(alphabet) - 1);
+    for (int n = 0; n < 2000; ++n) {
+        std::string s;
+        for (int i = 0; i < 12; ++i) {
+            s += alphabet[pick(rng)];
+        }
+        ASSERT_EQ(lex_all(s, Lexer::Engine::Dfa, GetParam()), lex_all(s, Lexer::Engine::Switch, GetParam())) << s;
+    }
+}
+
+TEST_P(LexerStandardTest, same_tokens) {
+    for (const std::string &s : inputs) {
+        EXPECT_EQ(lex_all(s, Lexer::Engine::Dfa, GetParam()), lex_all(s, Lexer::Engine::Switch, GetParam())) << s;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(standards, LexerStandardTest, testing::Values(Standard::C11, Standard::C17, Standard::Cxx17, Standard::Cxx20));
+
+/**
+ * Spellings of the tokens of `source` lexed as `standard`, separated by spaces
+ */
+static std::string spellings(const std::string &source, Standard standard) {
+    return with_lexer(standard, source, std::pmr::get_default_resource(), LexerEngine::Dfa, [](auto &l) {
+        std::string r;
+        for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+            if (!t.is(Token::Type::Space)) {
+                r += (r.empty() ? "" : " ") + std::string(t.prefix()) + std::string(t.lex());
+            }
+        }
+        return r;
+    });
+}
+
+TEST(LexerStandard, c_has_no_cxx_tokens) {
+    EXPECT_EQ(spellings("a::b .* ->* <=> <::x", Standard::C17), "a : : b . * -> * <= > [ : x");
+    EXPECT_EQ(spellings("a::b .* ->* <=> <::x", Standard::Cxx17), "a :: b .* ->* <= > < :: x");
+    EXPECT_EQ(spellings("a::b .* ->* <=> <::x", Standard::Cxx20), "a :: b .* ->* <=> < :: x");
+    EXPECT_EQ(spellings("R\"(a)\" u8'b' u8\"c\"", Standard::C11), "R (a) u8 b u8c");
+    EXPECT_EQ(spellings("R\"(a)\" u8'b' u8\"c\"", Standard::Cxx17), "a u8b u8c");
+    EXPECT_EQ(spellings("<: %:%: and", Standard::C11), "[ ## and");
+}
+
+TEST(LexerDfa, random_bytes) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> byte(1, 255);
+    for (int n = 0; n < 2000; ++n) {
+        std::string s;
+        for (int i = 0; i < 16; ++i) {
+            s += static_cast<char>(byte(rng));
+        }
+        ASSERT_EQ(lex_all(s, Lexer::Engine::Dfa), lex_all(s, Lexer::Engine::Switch)) << s;
+    }
+}
+
+TEST(LexerDfa, punctuator_id) {
+    Lexer l("<% %:%: a+=b and");
+    Token t = l.next();
+    EXPECT_EQ(t.punctuator(), punctuator_id("{"));
+    l.next();
+    EXPECT_EQ(l.next().punctuator(), punctuator_id("##"));
+    l.next();
+    EXPECT_EQ(l.next().punctuator(), Token::no_punctuator);
+    EXPECT_EQ(l.next().punctuator(), punctuator_id("+="));
+    static_assert(punctuators[punctuator_id("<<=")].spelling == "<<=");
+}
+
+TEST(LexerDfa, char_classes) {
+    EXPECT_EQ(char_classes['\0'], CharClass::End);
+    EXPECT_EQ(char_classes['\v'], CharClass::Space);
+    EXPECT_EQ(char_classes['R'], CharClass::Prefix);
+    EXPECT_EQ(char_classes['_'], CharClass::Letter);
+    EXPECT_EQ(char_classes['#'], CharClass::Punct);
+    EXPECT_EQ(char_classes['"'], CharClass::Quote);
+    EXPECT_EQ(char_classes['@'], CharClass::Other);
+    EXPECT_EQ(char_classes['\x80'], CharClass::Other);
+}
+
+TEST(LexerDfa, every_punctuator_is_accepted) {
+    for (size_t i = 0; i < std::size(punctuators); ++i) {
+        uint8_t s = 0;
+        for (char c : punctuators[i].spelling) {
+            s = punctuator_dfa<Cxx20>.step(s, c);
+            ASSERT_NE(s, 0) << punctuators[i].spelling;
+        }
+        EXPECT_EQ(punctuator_dfa<Cxx20>.accept[s], punctuator_id(punctuators[i].canonical));
+    }
+    EXPECT_LE(punctuator_dfa<Cxx20>.states, PunctuatorDfa::max_states);
+    EXPECT_LT(punctuator_dfa<C17>.states, punctuator_dfa<Cxx20>.states);
+}
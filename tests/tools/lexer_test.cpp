@@ -371,6 +371,15 @@ TEST_F(LexerTest, StringLitteral_raw) {
     EXPECT_EQ(l.next().type(), Token::Type::End);
 }
 
+TEST_F(LexerTest, StringLitteral_raw_longest_delimiter) {
+    // Up to 16 characters, 17 is an error
+    Lexer l("R\"abcdefghijklmnop(a)abcdefghijklmnop\"");
+    Token t(l.next());
+    EXPECT_EQ(t.lex(), "a");
+    EXPECT_TRUE(t.raw());
+    EXPECT_EQ(l.next().type(), Token::Type::End);
+}
+
 class GenerateTest00 : public testing::TestWithParam<std::string> {};
 
 const std::vector<std::string> processop{"#", "##", "%:", "%:%:"};
@@ -418,3 +427,45 @@ TEST_P(GenerateTest, OpOrPunctuator) {
 }
 
 INSTANTIATE_TEST_SUITE_P(punctuators, GenerateTest, testing::ValuesIn(punctuators));
+
+TEST_F(LexerTest, utf8_identifier) {
+    Lexer l("caf\xC3\xA9 \xCE\xBBx\xCC\x81");
+    Token t(l.next());
+    EXPECT_EQ(t.type(), Token::Type::Identifier);
+    EXPECT_EQ(t.lex(), "caf\xC3\xA9");
+    EXPECT_EQ(l.next().type(), Token::Type::Space);
+    t = l.next();
+    EXPECT_EQ(t.type(), Token::Type::Identifier);
+    EXPECT_EQ(t.lex(), "\xCE\xBBx\xCC\x81");
+    EXPECT_EQ(l.next().type(), Token::Type::End);
+}
+
+TEST_F(LexerTest, utf8_not_identifier) {
+    Lexer l("a\xE2\x82\xAC");
+    EXPECT_EQ(l.next().lex(), "a");
+    Token t(l.next());
+    EXPECT_EQ(t.type(), Token::Type::Unexpected);
+    EXPECT_EQ(t.lex(), "\xE2\x82\xAC");
+    EXPECT_EQ(l.next().type(), Token::Type::End);
+}
+
+TEST_F(LexerTest, utf8_litteral) {
+    Lexer l("\"\xE2\x82\xAC\\n\xF0\x9F\xA6\x96\" '\xC3\xA9' R\"(\xC3\xA9)\"");
+    Token t(l.next());
+    EXPECT_EQ(t.type(), Token::Type::StringLitteral);
+    EXPECT_EQ(t.lex(), "\xE2\x82\xAC\\n\xF0\x9F\xA6\x96");
+    l.next();
+    t = l.next();
+    EXPECT_EQ(t.type(), Token::Type::CharLitteral);
+    EXPECT_EQ(t.lex(), "\xC3\xA9");
+    l.next();
+    t = l.next();
+    EXPECT_TRUE(t.raw());
+    EXPECT_EQ(t.lex(), "\xC3\xA9");
+    EXPECT_EQ(l.next().type(), Token::Type::End);
+}
+
+TEST_F(LexerDeathTest, utf8_invalid_in_litteral) {
+    Lexer l("\"\xC3\x28\"");
+    EXPECT_DEATH(l.next(), "error");
+}
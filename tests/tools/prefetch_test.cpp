@@ -0,0 +1,96 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include "tests/temp_dir.hpp"
+#include "tools/prefetch.hpp"
+
+class PrefetchTest : public ::testing::TestWithParam<bool> {
+  protected:
+    std::string write(const std::string &name, const std::string &content) {
+        std::string path = dir + "/" + name;
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+        return path;
+    }
+
+    TempDir tmp{"prefetch_test"};
+    std::string dir = tmp.path();
+};
+
+TEST_P(PrefetchTest, batch) {
+    // More files than fit in one round of the ring
+    std::vector<std::string> paths;
+    for (int i = 0; i < 70; ++i) {
+        paths.push_back(write("prefetch_" + std::to_string(i) + ".txt", std::string(static_cast<size_t>(i) * 1000, 'a') + std::to_string(i)));
+    }
+    paths.push_back(dir + "/prefetch_missing.txt");
+
+    FileCache cache;
+    {
+        Prefetcher p(cache, 4, GetParam());
+        p.prefetch(paths);
+        p.wait();
+    }
+    EXPECT_EQ(cache.size(), 70);
+    for (int i = 0; i < 70; ++i) {
+        FileCache::Content c = cache.find(paths[static_cast<size_t>(i)]);
+        ASSERT_NE(c, nullptr);
+        EXPECT_EQ(c->text, std::string(static_cast<size_t>(i) * 1000, 'a') + std::to_string(i));
+    }
+    EXPECT_EQ(cache.find(dir + "/prefetch_missing.txt"), nullptr);
+
+    // The stamps taken while prefetching validate the entries
+    size_t misses = cache.misses();
+    EXPECT_NE(cache.read(paths[3]), nullptr);
+    EXPECT_EQ(cache.misses(), misses);
+}
+
+TEST_P(PrefetchTest, read_once) {
+    std::string a = write("prefetch_a.txt", "int a;");
+    FileCache cache;
+    Prefetcher p(cache, 2, GetParam());
+    p.prefetch({a});
+    p.wait();
+    FileCache::Content c = cache.find(a);
+    ASSERT_NE(c, nullptr);
+
+    write("prefetch_a.txt", "int b;");
+    p.prefetch({a, a});
+    p.wait();
+    EXPECT_EQ(cache.find(a), c);
+}
+
+TEST_P(PrefetchTest, empty_file) {
+    std::string a = write("prefetch_empty.txt", "");
+    FileCache cache;
+    Prefetcher p(cache, 2, GetParam());
+    p.prefetch({a});
+    p.wait();
+    FileCache::Content c = cache.find(a);
+    ASSERT_NE(c, nullptr);
+    EXPECT_EQ(c->text, "");
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, PrefetchTest, ::testing::Values(true, false));
+
+TEST(Prefetch, fallback) {
+    FileCache cache;
+    Prefetcher p(cache, 2, false);
+    EXPECT_EQ(p.backend(), Prefetcher::Backend::Threads);
+}
+
+TEST(Prefetch, quoted_includes) {
+    std::string source = "#include \"a.h\"\n"
+                         "  #  include   \"sub/b.h\" // comment\n"
+                         "#include <vector>\n"
+                         "#include \"/abs/c.h\"\n"
+                         "int x; #include \"no.h\"\n"
+                         "#define include \"no.h\"\n"
+                         "#include \"\"\n"
+                         "#include \"last.h\"";
+    EXPECT_EQ(quoted_includes(source, "dir"), (std::vector<std::string>{"dir/a.h", "dir/sub/b.h", "/abs/c.h", "dir/last.h"}));
+    EXPECT_EQ(quoted_includes("#include \"a.h\"\n", ""), std::vector<std::string>{"a.h"});
+    EXPECT_TRUE(quoted_includes("", "dir").empty());
+}
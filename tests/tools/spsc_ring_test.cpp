@@ -0,0 +1,124 @@
+#include <numeric>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "tools/error.hpp"
+#include "tools/pipeline.hpp"
+#include "tools/spsc_ring.hpp"
+
+class SpscRingTest : public ::testing::Test {};
+
+TEST_F(SpscRingTest, capacity_power_of_two) {
+    SpscRing<int> r(5);
+    EXPECT_EQ(r.capacity(), 8u);
+}
+
+TEST_F(SpscRingTest, full) {
+    SpscRing<int> r(4);
+    std::vector<int> in{1, 2, 3, 4, 5, 6};
+    EXPECT_EQ(r.try_push(in.begin(), in.end()), 4u);
+    EXPECT_EQ(r.try_push(in.begin() + 4, in.end()), 0u);
+
+    std::vector<int> out;
+    EXPECT_EQ(r.try_pop(out, 3), 3u);
+    EXPECT_EQ(r.try_push(in.begin() + 4, in.end()), 2u);
+    EXPECT_EQ(r.try_pop(out, 10), 3u);
+    EXPECT_EQ(out, in);
+    EXPECT_EQ(r.try_pop(out, 10), 0u);
+}
+
+TEST_F(SpscRingTest, closed) {
+    SpscRing<int> r(4);
+    r.push(7);
+    r.close();
+    std::vector<int> out;
+    EXPECT_EQ(r.pop(out, 4), 1u);
+    EXPECT_EQ(r.pop(out, 4), 0u);
+    EXPECT_EQ(out, std::vector<int>{7});
+}
+
+TEST_F(SpscRingTest, closed_by_consumer) {
+    SpscRing<int> r(4);
+    std::vector<int> in{1, 2, 3, 4, 5, 6};
+    r.close();
+    EXPECT_FALSE(r.push(in.begin(), in.end()));
+}
+
+TEST_F(SpscRingTest, threads) {
+    constexpr int n = 100000;
+    SpscRing<int> r(64);
+    std::thread producer([&r]() {
+        std::vector<int> v(n);
+        std::iota(v.begin(), v.end(), 0);
+        for (size_t i = 0; i < v.size(); i += 100) {
+            r.push(v.begin() + static_cast<long>(i), v.begin() + static_cast<long>(std::min(i + 100, v.size())));
+        }
+        r.close();
+    });
+
+    std::vector<int> out;
+    while (r.pop(out, 32) != 0) {
+    }
+    producer.join();
+
+    ASSERT_EQ(out.size(), static_cast<size_t>(n));
+    for (int i = 0; i < n; ++i) {
+        ASSERT_EQ(out[static_cast<size_t>(i)], i);
+    }
+}
+
+TEST_F(SpscRingTest, lex_pipelined) {
+    std::string s;
+    for (int i = 0; i < 1000; ++i) {
+        s += "int a" + std::to_string(i) + " = u8\"x\" <=> b[6];\n";
+    }
+
+    std::vector<Token> expected;
+    Lexer l(s);
+    do {
+        expected.push_back(l.next());
+    } while (!expected.back().is(Token::Type::End));
+
+    std::vector<Token> got;
+    lex_pipelined(s, [&got](Token &t) { got.push_back(std::move(t)); }, 16);
+
+    ASSERT_EQ(got.size(), expected.size());
+    for (size_t i = 0; i < got.size(); ++i) {
+        EXPECT_EQ(got[i].type(), expected[i].type());
+        EXPECT_EQ(got[i].lex(), expected[i].lex());
+        EXPECT_EQ(got[i].prefix(), expected[i].prefix());
+    }
+}
+
+TEST_F(SpscRingTest, lex_pipelined_fatal) {
+    // The tokens before the error are consumed, then the error is raised on this thread
+    std::vector<Token> got;
+    {
+        ThrowOnFatal guard;
+        EXPECT_THROW(lex_pipelined("a b \\", [&got](Token &t) { got.push_back(std::move(t)); }), FatalError);
+    }
+    ASSERT_EQ(got.size(), 4);
+    EXPECT_EQ(got[2].lex(), "b");
+
+    EXPECT_DEATH(lex_pipelined("a \\", [](Token &) {}), "stray");
+}
+
+TEST_F(SpscRingTest, lex_pipelined_consumer_throws) {
+    // The lexer is ahead by at most the ring, it stops and is joined
+    std::string s;
+    for (int i = 0; i < 10000; ++i) {
+        s += "a ";
+    }
+    size_t n = 0;
+    EXPECT_THROW(lex_pipelined(
+                     s,
+                     [&n](Token &) {
+                         if (++n == 100) {
+                             throw std::runtime_error("consumer");
+                         }
+                     },
+                     64),
+                 std::runtime_error);
+    EXPECT_EQ(n, 100);
+}
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+
+#include "tools/lexer.hpp"
+#include "tools/stats.hpp"
+
+class StatsTest : public ::testing::Test {
+  protected:
+    void SetUp() override { Stats::instance().reset(); }
+    void TearDown() override { Stats::instance().trace(false); }
+};
+
+TEST_F(StatsTest, counters) {
+    Stats &s = Stats::instance();
+    s.count(Counter::BytesRead, 10);
+    s.count(Counter::BytesRead);
+    EXPECT_EQ(s.counter(Counter::BytesRead), 11);
+    EXPECT_EQ(s.counter(Counter::Diagnostics), 0);
+    s.reset();
+    EXPECT_EQ(s.counter(Counter::BytesRead), 0);
+}
+
+TEST_F(StatsTest, threads) {
+    // The counts of the threads are added up, those which exited included
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([]() noexcept {
+            for (int j = 0; j < 1000; ++j) {
+                Stats::instance().count(Counter::BytesRead, 2);
+            }
+            ScopedTimer timer(Phase::Parse);
+        });
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    Stats::instance().count(Counter::BytesRead);
+    EXPECT_EQ(Stats::instance().counter(Counter::BytesRead), 8001);
+    EXPECT_EQ(Stats::instance().time(Phase::Parse).calls, 4);
+}
+
+#if XCOMP_STATS
+static void lex_all(const std::string &s) {
+    Lexer l(s);
+    while (!l.next().is(Token::Type::End)) {
+    }
+}
+
+TEST_F(StatsTest, lexer_accounting) {
+    lex_all("int a = 1;");
+    Stats &s = Stats::instance();
+    EXPECT_EQ(s.counter(Counter::BytesRead), 10);
+    EXPECT_EQ(s.tokens(static_cast<size_t>(Token::Type::Identifier)), 2);
+    EXPECT_EQ(s.tokens(static_cast<size_t>(Token::Type::Space)), 3);
+    EXPECT_EQ(s.tokens(static_cast<size_t>(Token::Type::Number)), 1);
+    EXPECT_EQ(s.tokens(static_cast<size_t>(Token::Type::End)), 1);
+}
+
+TEST_F(StatsTest, diagnostics) {
+    lex_all("a @ b");
+    EXPECT_EQ(Stats::instance().counter(Counter::Diagnostics), 1);
+}
+
+TEST_F(StatsTest, timer) {
+    {
+        STATS_TIMER(Phase::Lex);
+        lex_all("int a;");
+    }
+    {
+        STATS_TIMER(Phase::Lex);
+    }
+    Stats::Time t = Stats::instance().time(Phase::Lex);
+    EXPECT_EQ(t.calls, 2);
+    EXPECT_EQ(Stats::instance().time(Phase::Parse).calls, 0);
+}
+#endif
+
+TEST_F(StatsTest, table) {
+    {
+        ScopedTimer timer(Phase::Escape);
+    }
+    std::ostringstream os;
+    Stats::instance().print_table(os);
+    std::string s = os.str();
+    EXPECT_NE(s.find("escape"), std::string::npos);
+    EXPECT_NE(s.find("bytes read"), std::string::npos);
+    EXPECT_NE(s.find("tokens Identifier"), std::string::npos);
+}
+
+TEST_F(StatsTest, trace) {
+    {
+        ScopedTimer timer(Phase::Parse); // not traced
+    }
+    Stats::instance().trace(true);
+    {
+        ScopedTimer timer(Phase::Read);
+    }
+    {
+        ScopedTimer timer(Phase::Lex);
+    }
+    std::ostringstream os;
+    Stats::instance().write_trace(os);
+    std::string s = os.str();
+    EXPECT_EQ(s.rfind("{\"traceEvents\":[{\"name\":\"read\",\"cat\":\"xcomp\",\"ph\":\"X\",", 0), 0);
+    EXPECT_NE(s.find("},{\"name\":\"lex\""), std::string::npos);
+    EXPECT_EQ(s.find("\"parse\""), std::string::npos);
+    EXPECT_NE(s.find("\"otherData\":{\"bytes read\":0,\"diagnostics\":0}}"), std::string::npos);
+}
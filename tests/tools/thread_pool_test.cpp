@@ -0,0 +1,59 @@
+#include <atomic>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "tools/thread_pool.hpp"
+
+class ThreadPoolTest : public ::testing::Test {};
+
+TEST_F(ThreadPoolTest, runs_every_task) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+    std::vector<int> done(1000, 0);
+    for (size_t i = 0; i < size(done); ++i) {
+        pool.submit([&done, i]() noexcept { done[i] = 1; });
+    }
+    pool.wait();
+    EXPECT_EQ(std::count(done.begin(), done.end(), 1), 1000);
+}
+
+TEST_F(ThreadPoolTest, nested_submit) {
+    ThreadPool pool(3);
+    std::atomic<int> n{0};
+    for (int i = 0; i < 10; ++i) {
+        pool.submit([&pool, &n]() noexcept {
+            for (int j = 0; j < 10; ++j) {
+                pool.submit([&n]() noexcept { ++n; });
+            }
+        });
+    }
+    pool.wait();
+    EXPECT_EQ(n.load(), 100);
+}
+
+TEST_F(ThreadPoolTest, wait_twice) {
+    ThreadPool pool(2);
+    std::atomic<int> n{0};
+    pool.submit([&n]() noexcept { ++n; });
+    pool.wait();
+    pool.submit([&n]() noexcept { ++n; });
+    pool.wait();
+    EXPECT_EQ(n.load(), 2);
+}
+
+TEST_F(ThreadPoolTest, destructor_waits) {
+    std::atomic<int> n{0};
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < 50; ++i) {
+            pool.submit([&n]() noexcept { ++n; });
+        }
+    }
+    EXPECT_EQ(n.load(), 50);
+}
+
+TEST_F(ThreadPoolTest, default_size) {
+    ThreadPool pool;
+    EXPECT_GE(pool.size(), 1);
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include "tools/token_stream.hpp"
+
+class TokenStreamTest : public ::testing::Test {};
+
+TEST_F(TokenStreamTest, range_for) {
+    Lexer l("int a;");
+    std::vector<Token::Type> types;
+    for (const Token &t : l) {
+        types.push_back(t.type());
+    }
+    EXPECT_EQ(types, (std::vector<Token::Type>{Token::Type::Identifier, Token::Type::Space, Token::Type::Identifier,
+                                               Token::Type::OpOrPunctuator}));
+}
+
+TEST_F(TokenStreamTest, range_empty) {
+    Lexer l("");
+    EXPECT_TRUE(l.begin() == l.end());
+}
+
+TEST_F(TokenStreamTest, iterator) {
+    Lexer l("a+b");
+    auto it = l.begin();
+    EXPECT_EQ(it->lex(), "a");
+    ++it;
+    EXPECT_EQ((*it).lex(), "+");
+    it++;
+    EXPECT_EQ(it->lex(), "b");
+    ++it;
+    EXPECT_TRUE(it == l.end());
+}
+
+TEST_F(TokenStreamTest, peek) {
+    Lexer l("a+b");
+    TokenStream s(l);
+    EXPECT_EQ(s.peek(2).lex(), "b");
+    EXPECT_EQ(s.peek(0).lex(), "a");
+    EXPECT_EQ(s.peek(3).type(), Token::Type::End);
+    EXPECT_EQ(s.get().lex(), "a");
+    EXPECT_EQ(s.peek().lex(), "+");
+    EXPECT_EQ(s.get().lex(), "+");
+    EXPECT_EQ(s.get().lex(), "b");
+}
+
+TEST_F(TokenStreamTest, past_end) {
+    Lexer l("a");
+    TokenStream<Lexer, 2> s(l);
+    EXPECT_EQ(s.get().lex(), "a");
+    EXPECT_EQ(s.peek(1).type(), Token::Type::End);
+    EXPECT_EQ(s.get().type(), Token::Type::End);
+    EXPECT_EQ(s.get().type(), Token::Type::End);
+    EXPECT_EQ(s.peek(1).type(), Token::Type::End);
+}
+
+TEST_F(TokenStreamTest, window_wraps) {
+    std::string src;
+    for (int i = 0; i < 100; ++i) {
+        src += "a" + std::to_string(i) + " ";
+    }
+    Lexer l(src);
+    TokenStream<Lexer, 3> s(l);
+    for (int i = 0; i < 100; ++i) {
+        if (i + 1 < 100) {
+            EXPECT_EQ(s.peek(2).lex(), "a" + std::to_string(i + 1));
+        } else {
+            EXPECT_EQ(s.peek(2).type(), Token::Type::End);
+        }
+        EXPECT_EQ(s.get().lex(), "a" + std::to_string(i));
+        EXPECT_EQ(s.get().type(), Token::Type::Space);
+    }
+    EXPECT_EQ(s.get().type(), Token::Type::End);
+}
+
+TEST_F(TokenStreamTest, language) {
+    // "::" is one token in C++ and two ':' in C
+    BasicLexer<C17> l("a::b");
+    TokenStream s(l);
+    EXPECT_EQ(s.peek(1).lex(), ":");
+    EXPECT_EQ(s.peek(2).lex(), ":");
+    EXPECT_EQ(s.peek(3).lex(), "b");
+}
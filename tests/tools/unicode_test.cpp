@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include "tools/unicode.hpp"
+
+class UnicodeTest : public ::testing::Test {};
+
+TEST_F(UnicodeTest, is_ascii) {
+    EXPECT_TRUE(is_ascii(""));
+    EXPECT_TRUE(is_ascii("int main() { return 0; }\n"));
+    std::string s(100, 'a');
+    EXPECT_TRUE(is_ascii(s));
+    for (size_t i : {0, 7, 8, 15, 16, 17, 63, 99}) {
+        std::string t = s;
+        t[i] = '\x80';
+        EXPECT_FALSE(is_ascii(t)) << i;
+    }
+}
+
+TEST_F(UnicodeTest, decode) {
+    char32_t c;
+    size_t len;
+    EXPECT_TRUE(utf8_decode("a", 0, c, len));
+    EXPECT_EQ(c, U'a');
+    EXPECT_EQ(len, 1u);
+    EXPECT_TRUE(utf8_decode("x\xC3\xA9", 1, c, len));
+    EXPECT_EQ(c, U'é');
+    EXPECT_EQ(len, 2u);
+    EXPECT_TRUE(utf8_decode("\xE2\x82\xAC", 0, c, len));
+    EXPECT_EQ(c, U'€');
+    EXPECT_TRUE(utf8_decode("\xF0\x9F\xA6\x96", 0, c, len));
+    EXPECT_EQ(c, U'\U0001F996');
+    EXPECT_EQ(len, 4u);
+}
+
+TEST_F(UnicodeTest, encode) {
+    char u[4];
+    for (char32_t c : {U'a', U'\x7F', U'\x80', U'é', U'\x7FF', U'\x800', U'€', U'\xFFFF', U'\U00010000', U'\U0001F996', U'\U0010FFFF'}) {
+        size_t n = utf8_encode(c, u);
+        char32_t d;
+        size_t len;
+        EXPECT_TRUE(utf8_decode(std::string_view(u, n), 0, d, len)) << c;
+        EXPECT_EQ(d, c);
+        EXPECT_EQ(len, n);
+    }
+    EXPECT_EQ(std::string_view(u, utf8_encode(U'€', u)), "\xE2\x82\xAC");
+    EXPECT_FALSE(is_valid_ucs(0xD800));
+    EXPECT_FALSE(is_valid_ucs(0x110000));
+}
+
+class GenerateTest : public testing::TestWithParam<std::string> {};
+
+const std::vector<std::string> invalid_utf8{"\x80",         "\xC0\x80",     "\xC3",         "\xC3\x28",         "\xE0\x80\x80",
+                                            "\xED\xA0\x80", "\xE2\x82",     "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xFF"};
+
+TEST_P(GenerateTest, invalid) {
+    char32_t c;
+    size_t len;
+    EXPECT_FALSE(utf8_decode(GetParam(), 0, c, len));
+    EXPECT_EQ(len, 0u);
+    std::string s = std::string(20, 'a') + GetParam() + "b";
+    EXPECT_EQ(utf8_validate(s), 20u);
+}
+
+INSTANTIATE_TEST_SUITE_P(invalid_utf8, GenerateTest, testing::ValuesIn(invalid_utf8));
+
+TEST_F(UnicodeTest, validate) {
+    EXPECT_EQ(utf8_validate(""), std::string_view::npos);
+    EXPECT_EQ(utf8_validate("caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\xA6\x96 0123456789abcdef"), std::string_view::npos);
+}
+
+TEST_F(UnicodeTest, xid) {
+    EXPECT_TRUE(is_xid_start(U'a'));
+    EXPECT_FALSE(is_xid_start(U'_'));
+    EXPECT_FALSE(is_xid_start(U'1'));
+    EXPECT_TRUE(is_xid_continue(U'1'));
+    EXPECT_TRUE(is_xid_start(U'é'));    // é
+    EXPECT_TRUE(is_xid_start(U'λ'));    // λ
+    EXPECT_TRUE(is_xid_start(U'中'));    // 中
+    EXPECT_FALSE(is_xid_start(U'́'));   // combining acute accent
+    EXPECT_TRUE(is_xid_continue(U'́'));
+    EXPECT_FALSE(is_xid_start(U'€'));   // €
+    EXPECT_FALSE(is_xid_continue(U'€'));
+    EXPECT_FALSE(is_xid_start(U'\U0001F996')); // emoji
+    EXPECT_TRUE(is_xid_start(U'\U00020000'));
+    EXPECT_FALSE(is_xid_continue(0x10FFFF));
+}
@@ -0,0 +1,224 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "tests/temp_dir.hpp"
+#include "xcomp/driver.hpp"
+
+class DriverTest : public ::testing::Test {
+  protected:
+    std::string file(const std::string &content) {
+        std::string path = dir + "/driver_test_" + std::to_string(files++) + ".cpp";
+        std::ofstream(path) << content;
+        return path;
+    }
+
+    TempDir tmp{"driver_test"};
+    std::string dir = tmp.path();
+    size_t files = 0;
+};
+
+TEST_F(DriverTest, options) {
+    Options o = parse_options({"-j", "4", "a.cpp", "-v", "b.cpp", "-ftime-report", "-ftrace=t.json"});
+    EXPECT_EQ(o.jobs, 4);
+    EXPECT_TRUE(o.verbose);
+    EXPECT_TRUE(o.time_report);
+    EXPECT_EQ(o.trace, "t.json");
+    EXPECT_EQ(o.inputs, (std::vector<std::string>{"a.cpp", "b.cpp"}));
+
+    EXPECT_EQ(parse_options({"-j8", "a.cpp"}).jobs, 8);
+    EXPECT_EQ(parse_options({"a.cpp"}).jobs, 1);
+    EXPECT_FALSE(parse_options({"a.cpp"}).standard);
+    EXPECT_EQ(parse_options({"-std=c11", "a.cpp"}).standard, Standard::C11);
+    EXPECT_EQ(parse_options({"-std=c++17", "a.cpp"}).standard, Standard::Cxx17);
+}
+
+TEST_F(DriverTest, bad_options) {
+    EXPECT_DEATH(parse_options({"-j"}), "missing argument to '-j'");
+    EXPECT_DEATH(parse_options({"-j0", "a.cpp"}), "invalid -j argument '0'");
+    EXPECT_DEATH(parse_options({"-jx", "a.cpp"}), "invalid -j argument 'x'");
+    EXPECT_DEATH(parse_options({"-q", "a.cpp"}), "unrecognized command-line option '-q'");
+    EXPECT_DEATH(parse_options({"-std=c++98", "a.cpp"}), "unrecognized command-line option '-std=c\\+\\+98'");
+    EXPECT_DEATH(parse_options({"-v"}), "no input files");
+}
+
+TEST_F(DriverTest, compile_file) {
+    Shared shared;
+    FileResult r = compile_file(file("int a = 'b';\nconst char *s = \"x\\ty\";\n"), shared);
+    EXPECT_TRUE(r.ok);
+    EXPECT_EQ(r.litterals, 2);
+    EXPECT_EQ(r.diagnostics, "");
+    EXPECT_EQ(shared.identifiers.size(), 5); // int a const char s
+    EXPECT_EQ(r.identifiers, 5);
+
+    r = compile_file(file("int a, b = a;\nint c = b + a;\n"), shared);
+    EXPECT_EQ(r.identifiers, 4);
+    EXPECT_EQ(shared.identifiers.size(), 7);
+}
+
+TEST_F(DriverTest, identifiers_within_budget) {
+    std::string many;
+    for (int i = 0; i < 100; ++i) {
+        many += "int a" + std::to_string(i) + ";\n";
+    }
+    std::string a = file(many);
+    std::string b = file("int b;\n");
+    Shared shared(4 << 10);
+    std::ostringstream out;
+    std::ostringstream err;
+    EXPECT_EQ(run(parse_options({"-v", a}), shared, out, err), EXIT_SUCCESS);
+    EXPECT_EQ(shared.identifiers.size(), 101u);
+    EXPECT_GT(shared.identifiers.bytes() + shared.files.bytes(), 4u << 10);
+
+    // Over budget: the identifiers of the previous run are dropped
+    EXPECT_EQ(run(parse_options({"-v", b}), shared, out, err), EXIT_SUCCESS);
+    EXPECT_EQ(shared.identifiers.size(), 2u);
+    EXPECT_EQ(out.str(), a + ": 500 tokens, 0 litterals, 101 identifiers\n" + b + ": 5 tokens, 0 litterals, 2 identifiers\n");
+}
+
+TEST_F(DriverTest, standard) {
+    // A raw string in C++, R then a string with a bad escape sequence in C
+    std::string path = file("const char *s = R\"(\\q)\";\n");
+    Shared shared;
+    EXPECT_TRUE(compile_file(path, shared).ok);
+    EXPECT_FALSE(compile_file(path, shared, nullptr, Standard::C17).ok);
+    EXPECT_TRUE(compile_file(path, shared, nullptr, Standard::Cxx17).ok);
+    EXPECT_EQ(shared.result_hits, 0u);
+
+    EXPECT_EQ(standard_of_path("a.c"), Standard::C17);
+    EXPECT_EQ(standard_of_path("a.cc"), Standard::Cxx20);
+}
+
+TEST_F(DriverTest, formatting_changes) {
+    std::string path = file("int a = b+c;\n");
+    Shared shared;
+    FileResult r = compile_file(path, shared);
+    EXPECT_TRUE(r.ok);
+
+    // Same tokens: the result of the previous content is reused
+    std::ofstream(path) << "int  a =\n    b + c ;\n";
+    FileResult f = compile_file(path, shared);
+    EXPECT_TRUE(f.ok);
+    EXPECT_EQ(f.fingerprint, r.fingerprint);
+    EXPECT_EQ(shared.result_hits, 0u);
+    EXPECT_EQ(shared.fingerprint_hits, 1u);
+
+    std::ofstream(path) << "int a = b + d;\n";
+    FileResult d = compile_file(path, shared);
+    EXPECT_TRUE(d.ok);
+    EXPECT_NE(d.fingerprint, r.fingerprint);
+    EXPECT_EQ(shared.fingerprint_hits, 1u);
+}
+
+TEST_F(DriverTest, hash_collisions) {
+    std::string path = file("int a = b+c;\n");
+    Shared shared;
+    FileResult r = compile_file(path, shared);
+    ASSERT_TRUE(r.ok);
+
+    // Another content with the same hash and the same fingerprint: its result is not reused
+    auto other = std::make_shared<SourceFile>();
+    other->text = "int a = b-c;\n";
+    other->hash = shared.files.read(path)->hash;
+    FileResult wrong = r;
+    wrong.diagnostics = "wrong\n";
+    shared.results.insert(FileCache::key(path), {other, Standard::Cxx20, false, wrong});
+    FileResult f = compile_file(path, shared);
+    EXPECT_TRUE(f.ok);
+    EXPECT_EQ(f.diagnostics, "");
+    EXPECT_EQ(shared.result_hits, 0u);
+    EXPECT_EQ(shared.fingerprint_hits, 0u);
+
+    // The same content read again
+    EXPECT_EQ(compile_file(path, shared).diagnostics, "");
+    EXPECT_EQ(shared.result_hits, 1u);
+}
+
+TEST_F(DriverTest, results_not_kept) {
+    std::string path = file("int a;\n");
+    Shared shared(SIZE_MAX, false);
+    EXPECT_TRUE(compile_file(path, shared).ok);
+    EXPECT_TRUE(compile_file(path, shared, nullptr, {}, true).ok);
+    EXPECT_EQ(shared.results.size(), 0u);
+    EXPECT_EQ(shared.files.size(), 1u);
+}
+
+TEST_F(DriverTest, preprocess) {
+    std::string path = file("int  a = '\\n';\n\n  b\n");
+    Options o = parse_options({"-E", path, path});
+    EXPECT_TRUE(o.preprocess);
+    std::ostringstream out;
+    std::ostringstream err;
+    EXPECT_EQ(run(o, out, err), 0);
+    std::string expected = "# 1 \"" + path + "\"\nint a = '\\n';\n\nb\n";
+    EXPECT_EQ(out.str(), expected + expected);
+    EXPECT_EQ(err.str(), "");
+}
+
+TEST_F(DriverTest, preprocess_spelling) {
+    std::string path = file("a\n");
+    std::string spelled = dir + "/./" + std::filesystem::path(path).filename().string();
+    Shared shared;
+    EXPECT_EQ(compile_file(path, shared, nullptr, {}, true).preprocessed, "# 1 \"" + path + "\"\na\n");
+    // Same file, the output names it as spelled
+    EXPECT_EQ(compile_file(spelled, shared, nullptr, {}, true).preprocessed, "# 1 \"" + spelled + "\"\na\n");
+    EXPECT_EQ(shared.result_hits, 0u);
+    EXPECT_EQ(compile_file(path, shared, nullptr, {}, true).preprocessed, "# 1 \"" + path + "\"\na\n");
+    EXPECT_EQ(shared.result_hits, 1u);
+}
+
+TEST_F(DriverTest, includes_are_prefetched) {
+    std::string header = file("int h;\n");
+    std::string source = file("#include \"" + header + "\"\nint a;\n");
+    Shared shared;
+    {
+        Prefetcher prefetcher(shared.files);
+        EXPECT_TRUE(compile_file(source, shared, &prefetcher).ok);
+    }
+    FileCache::Content c = shared.files.find(header);
+    ASSERT_NE(c, nullptr);
+    EXPECT_EQ(c->text, "int h;\n");
+}
+
+TEST_F(DriverTest, compile_error) {
+    Shared shared;
+    FileResult r = compile_file(file("char c = '\\q';"), shared);
+    EXPECT_FALSE(r.ok);
+    EXPECT_NE(r.diagnostics.find("bad escape sequence"), std::string::npos);
+
+    r = compile_file(dir + "/driver_test_missing.cpp", shared);
+    EXPECT_FALSE(r.ok);
+    EXPECT_NE(r.diagnostics.find(dir + "/driver_test_missing.cpp: No such file or directory"), std::string::npos);
+}
+
+TEST_F(DriverTest, deterministic_output) {
+    Options o;
+    o.verbose = true;
+    for (int i = 0; i < 20; ++i) {
+        std::string content;
+        for (int j = 0; j <= i; ++j) {
+            content += "int v" + std::to_string(j) + " = " + std::to_string(j) + ";\n";
+        }
+        if (i % 7 == 3) {
+            content += "char c = '\\q';\n";
+        }
+        o.inputs.push_back(file(content));
+    }
+
+    std::ostringstream out1, err1;
+    o.jobs = 1;
+    EXPECT_EQ(run(o, out1, err1), EXIT_FAILURE);
+
+    for (int k = 0; k < 3; ++k) {
+        std::ostringstream out4, err4;
+        o.jobs = 4;
+        EXPECT_EQ(run(o, out4, err4), EXIT_FAILURE);
+        EXPECT_EQ(out4.str(), out1.str());
+        EXPECT_EQ(err4.str(), err1.str());
+    }
+    EXPECT_NE(out1.str().find(dir + "/driver_test_0.cpp: 9 tokens, 0 litterals, 2 identifiers\n"), std::string::npos);
+    EXPECT_NE(err1.str().find(dir + "/driver_test_3.cpp: bad escape sequence"), std::string::npos);
+}
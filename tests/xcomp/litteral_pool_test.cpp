@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include "xcomp/litteral_pool.hpp"
+#include "xcomp/string.hpp"
+
+class LitteralPoolTest : public ::testing::Test {
+  protected:
+    LitteralPool::Id add(const std::string &prefix, const std::string &lex) {
+        Token t(Token::Type::StringLitteral, lex);
+        t.prefix(prefix);
+        convert_escape_sequence(t);
+        LitteralPool::Id id = pool.add(t);
+        EXPECT_EQ(t.litteral_id(), id);
+        return id;
+    }
+
+    LitteralPool pool;
+};
+
+TEST_F(LitteralPoolTest, encoding_of) {
+    EXPECT_EQ(encoding_of(""), Encoding::Utf8);
+    EXPECT_EQ(encoding_of("u8"), Encoding::Utf8);
+    EXPECT_EQ(encoding_of("u"), Encoding::Utf16);
+    EXPECT_EQ(encoding_of("U"), Encoding::Utf32);
+    EXPECT_EQ(encoding_of("L"), Encoding::Utf32);
+}
+
+TEST_F(LitteralPoolTest, utf8) {
+    auto id = add("", "a\\u20AC");
+    EXPECT_EQ(pool.bytes(id), std::string_view("a\xE2\x82\xAC", 5));
+    EXPECT_EQ(pool.entry(id).encoding, Encoding::Utf8);
+}
+
+TEST_F(LitteralPoolTest, numeric_escapes) {
+    // Bytes in a narrow or u8 litteral, only universal character names are UTF-8 encoded
+    EXPECT_EQ(pool.bytes(add("", "\\xff")), std::string_view("\xFF", 2));
+    EXPECT_EQ(pool.bytes(add("u8", "\\377\\u00FF")), std::string_view("\xFF\xC3\xBF", 4));
+    // Code points in the others
+    EXPECT_EQ(pool.bytes(add("u", "\\xff")), std::string_view("\xFF\0\0", 4));
+}
+
+TEST_F(LitteralPoolTest, utf16) {
+    auto id = add("u", "a\\u20AC\\U0001F996");
+    EXPECT_EQ(pool.bytes(id), std::string_view("a\0\xAC\x20\x3E\xD8\x96\xDD\0\0", 10));
+    EXPECT_EQ(pool.entry(id).offset % 2, 0u);
+}
+
+TEST_F(LitteralPoolTest, utf32) {
+    add("", "x");
+    auto id = add("U", "\\U0001F996");
+    EXPECT_EQ(pool.bytes(id), std::string_view("\x96\xF9\x01\0\0\0\0\0", 8));
+    EXPECT_EQ(pool.entry(id).offset % 4, 0u);
+    EXPECT_EQ(add("L", "\\U0001F996"), id);
+}
+
+TEST_F(LitteralPoolTest, deduplication) {
+    auto a = add("", "hello");
+    auto b = add("u8", "hel\\x6co");
+    auto c = add("u", "hello");
+    auto d = add("", "hello!");
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, c);
+    EXPECT_NE(a, d);
+    EXPECT_EQ(pool.size(), 3u);
+
+    size_t before = pool.data().size();
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(add("u", "hello"), c);
+    }
+    EXPECT_EQ(pool.data().size(), before);
+}
+
+TEST_F(LitteralPoolTest, empty) {
+    auto id = add("U", "");
+    EXPECT_EQ(pool.entry(id).size, 4u);
+    EXPECT_NE(add("u", ""), id);
+}
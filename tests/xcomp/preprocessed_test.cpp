@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include "xcomp/preprocessed.hpp"
+
+static std::string preprocess(const std::string &source, Standard standard = Standard::Cxx20) {
+    std::string out;
+    PreprocessedWriter w(out);
+    w.begin_file("a.cpp");
+    with_lexer(standard, source, std::pmr::get_default_resource(), LexerEngine::Dfa, [&w](auto &l) {
+        for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+            w.write(t);
+        }
+    });
+    w.end_file();
+    return out;
+}
+
+TEST(PreprocessedTest, spacing) {
+    EXPECT_EQ(preprocess(""), "# 1 \"a.cpp\"\n");
+    EXPECT_EQ(preprocess("int  a\t=\v1 ;"), "# 1 \"a.cpp\"\nint a = 1 ;\n");
+    EXPECT_EQ(preprocess("    f(a,b) ;   \n"), "# 1 \"a.cpp\"\nf(a,b) ;\n");
+    EXPECT_EQ(preprocess("a+++b"), "# 1 \"a.cpp\"\na+++b\n");
+}
+
+TEST(PreprocessedTest, lines) {
+    EXPECT_EQ(preprocess("a\n\n\nb\n"), "# 1 \"a.cpp\"\na\n\n\nb\n");
+    EXPECT_EQ(preprocess("\n  \n\na"), "# 1 \"a.cpp\"\n\n\n\na\n");
+    // 8 blank lines are kept, 9 are a line marker
+    EXPECT_EQ(preprocess("a" + std::string(9, '\n') + "b"), "# 1 \"a.cpp\"\na" + std::string(9, '\n') + "b\n");
+    EXPECT_EQ(preprocess("a" + std::string(10, '\n') + "b\nc"), "# 1 \"a.cpp\"\na\n# 11 \"a.cpp\"\nb\nc\n");
+}
+
+TEST(PreprocessedTest, raw_string_lines) {
+    // The marker after the gap has the line of b in the input
+    std::string source = "a = R\"(1\n2\n3)\";" + std::string(10, '\n') + "b";
+    EXPECT_EQ(preprocess(source), "# 1 \"a.cpp\"\na = R\"(1\n2\n3)\";\n# 13 \"a.cpp\"\nb\n");
+    EXPECT_EQ(preprocess("R\"(\n)\"\nb"), "# 1 \"a.cpp\"\nR\"(\n)\"\nb\n");
+}
+
+TEST(PreprocessedTest, marker_path) {
+    std::string out;
+    PreprocessedWriter w(out);
+    w.begin_file("a \"b\"\\c\n.cpp");
+    w.end_file();
+    EXPECT_EQ(out, "# 1 \"a \\\"b\\\"\\\\c\\012.cpp\"\n");
+}
+
+TEST(PreprocessedTest, spelling) {
+    EXPECT_EQ(preprocess("u8\"a\\n\" L'\\x41' \"\\\\\""), "# 1 \"a.cpp\"\nu8\"a\\n\" L'\\x41' \"\\\\\"\n");
+    EXPECT_EQ(preprocess("R\"(a\\n)\" uR\"d(x)\" )d\""), "# 1 \"a.cpp\"\nR\"(a\\n)\" uR\"x(x)\" )x\"\n");
+    // Alternative tokens are written as the token they stand for
+    EXPECT_EQ(preprocess("a<:1:> %:define"), "# 1 \"a.cpp\"\na[1] #define\n");
+}
+
+TEST(PreprocessedTest, raw_string_delimiters) {
+    // Every run of 'x' up to the 16 characters limit ends the string: another character is used
+    std::string content = ")\"";
+    for (size_t n = 1; n <= 16; ++n) {
+        content += ")" + std::string(n, 'x') + "\"";
+    }
+    Token t(Token::Type::StringLitteral, content);
+    t.raw(true);
+    std::string out;
+    append_spelling(out, t);
+    EXPECT_EQ(out, "R\"y(" + content + ")y\"");
+    EXPECT_EQ(preprocess("R\"abcdefghijklmnop(" + content + ")abcdefghijklmnop\""), "# 1 \"a.cpp\"\n" + out + "\n");
+
+    // Every delimiter of one character ends the string: two of them are used
+    content = ")\"";
+    for (char c : std::string_view("xyzabcdefghijklmnopqrstuvwABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_")) {
+        content += std::string(")") + c + "\"";
+    }
+    Token u(Token::Type::StringLitteral, content);
+    u.raw(true);
+    out.clear();
+    append_spelling(out, u);
+    EXPECT_EQ(out, "R\"xx(" + content + ")xx\"");
+}
+
+TEST(PreprocessedTest, relexes_to_the_same_tokens) {
+    std::string source = "#include \"x.h\"\nint main() {\n\treturn a->*b <=> R\"q(\"))q\" + 'c';\n}\n";
+    std::string once = preprocess(source);
+    EXPECT_EQ(preprocess(once.substr(once.find('\n') + 1)), once);
+}
+
+TEST(PreprocessedTest, type_names) {
+    std::ostringstream os;
+    os << Token::Type::CharLitteral << ' ' << Token::Type::Unexpected;
+    EXPECT_EQ(os.str(), "CharLitteral Unexpected");
+}
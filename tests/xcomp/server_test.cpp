@@ -0,0 +1,161 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "tests/temp_dir.hpp"
+#include "tools/error.hpp"
+#include "xcomp/driver.hpp"
+#include "xcomp/server.hpp"
+
+class ServerTest : public ::testing::Test {
+  protected:
+    std::string write(const std::string &name, const std::string &content) {
+        std::string path = dir + "/" + name;
+        std::ofstream(path, std::ios::trunc) << content;
+        return path;
+    }
+
+    /**
+     * Forward `args`, retrying while the daemon is not listening yet
+     */
+    int request(const std::vector<std::string> &args, std::string &out, std::string &err) {
+        for (int i = 0;; ++i) {
+            std::ostringstream o;
+            std::ostringstream e;
+            try {
+                ThrowOnFatal guard;
+                int status = forward(socket, args, o, e);
+                out = o.str();
+                err = e.str();
+                return status;
+            } catch (const FatalError &) {
+                if (i == 200) {
+                    throw;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+    }
+
+    TempDir tmp{"server_test"}; // the files and the socket
+    std::string dir = tmp.path();
+    std::string socket = dir + "/server_test.sock";
+};
+
+TEST_F(ServerTest, requests) {
+    std::string a = write("server_test_a.cpp", "int a = 1;\n");
+    std::string b = write("server_test_b.cpp", "char c = '\\q';\n");
+
+    std::thread daemon([this]() { serve(socket, 1 << 20); });
+
+    std::string out;
+    std::string err;
+    EXPECT_EQ(request({"-v", "-j2", a, b}, out, err), EXIT_FAILURE);
+    std::ostringstream direct_out;
+    std::ostringstream direct_err;
+    Options o = parse_options({"-v", "-j2", a, b});
+    EXPECT_EQ(run(o, direct_out, direct_err), EXIT_FAILURE);
+    EXPECT_EQ(out, direct_out.str());
+    EXPECT_EQ(err, direct_err.str());
+
+    // Unchanged file: answered from the daemon caches
+    EXPECT_EQ(request({"-v", a}, out, err), EXIT_SUCCESS);
+    EXPECT_EQ(out, a + ": 9 tokens, 0 litterals, 2 identifiers\n");
+
+    write("server_test_a.cpp", "int a = 1 + 2;\n");
+    EXPECT_EQ(request({"-v", a}, out, err), EXIT_SUCCESS);
+    EXPECT_EQ(out, a + ": 13 tokens, 0 litterals, 2 identifiers\n");
+
+    EXPECT_EQ(request({"-q"}, out, err), EXIT_FAILURE);
+    EXPECT_NE(err.find("unrecognized command-line option '-q'"), std::string::npos);
+
+    EXPECT_EQ(request({"--shutdown"}, out, err), EXIT_SUCCESS);
+    daemon.join();
+    EXPECT_FALSE(std::ifstream(socket).good());
+}
+
+TEST_F(ServerTest, results_are_reused) {
+    std::string a = write("server_test_c.cpp", "int c;\n");
+    Shared shared;
+    std::ostringstream out;
+    std::ostringstream err;
+    Options o = parse_options({a});
+    run(o, shared, out, err);
+    EXPECT_EQ(shared.result_hits, 0);
+    run(o, shared, out, err);
+    EXPECT_EQ(shared.result_hits, 1);
+    EXPECT_EQ(shared.files.hits(), 1);
+
+    write("server_test_c.cpp", "int cc;\n");
+    run(o, shared, out, err);
+    EXPECT_EQ(shared.result_hits, 1);
+}
+
+TEST_F(ServerTest, results_by_absolute_path) {
+    std::string a = write("server_test_d.cpp", "int d;\n");
+    Shared shared;
+    std::ostringstream out;
+    std::ostringstream err;
+    run(parse_options({a}), shared, out, err);
+    run(parse_options({dir + "/./server_test_d.cpp"}), shared, out, err);
+    EXPECT_EQ(shared.result_hits, 1);
+    EXPECT_EQ(shared.results.size(), 1);
+}
+
+TEST_F(ServerTest, results_within_budget) {
+    // The -E output of every file is kept with its result
+    std::vector<std::string> args{"-E"};
+    for (int i = 0; i < 16; ++i) {
+        args.push_back(write("server_test_e" + std::to_string(i) + ".cpp", "int " + std::string(1000, 'e') + ";\n"));
+    }
+    constexpr size_t budget = 24 << 10;
+    Shared shared(budget);
+    std::ostringstream out;
+    std::ostringstream err;
+    EXPECT_EQ(run(parse_options(args), shared, out, err), EXIT_SUCCESS);
+    EXPECT_LE(shared.files.bytes() + shared.results.bytes(), budget);
+    EXPECT_GT(shared.results.size(), 0);
+    EXPECT_LT(shared.results.size(), 16);
+}
+
+TEST_F(ServerTest, oversized_request) {
+    std::thread daemon([this]() { serve(socket, 1 << 20); });
+    std::string out;
+    std::string err;
+    EXPECT_EQ(request({std::string(1 << 17, 'a')}, out, err), EXIT_FAILURE);
+    EXPECT_EQ(err, "error: request too large\n");
+    EXPECT_EQ(request({"--shutdown"}, out, err), EXIT_SUCCESS);
+    daemon.join();
+}
+
+TEST_F(ServerTest, no_daemon) { EXPECT_DEATH(forward(dir + "/server_test_none.sock", {"a.cpp"}, std::cout, std::cerr), "cannot connect to"); }
+
+TEST_F(ServerTest, not_a_socket) {
+    write("server_test.sock", "not a socket\n");
+    EXPECT_DEATH(serve(socket, 1 << 20), "exists and is not a socket");
+    std::ifstream in(socket);
+    std::string content;
+    std::getline(in, content);
+    EXPECT_EQ(content, "not a socket");
+}
+
+TEST_F(ServerTest, one_daemon_per_socket) {
+    std::string a = write("server_test_a.cpp", "int a;\n");
+    std::thread daemon([this]() { serve(socket, 1 << 20); });
+    std::string out;
+    std::string err;
+    EXPECT_EQ(request({a}, out, err), EXIT_SUCCESS); // the daemon is listening
+    EXPECT_EQ(std::filesystem::status(socket).permissions() & std::filesystem::perms::all,
+              std::filesystem::perms::owner_read | std::filesystem::perms::owner_write);
+    {
+        ThrowOnFatal guard;
+        EXPECT_THROW(serve(socket, 1 << 20), FatalError);
+    }
+    EXPECT_EQ(request({"--shutdown"}, out, err), EXIT_SUCCESS);
+    daemon.join();
+}
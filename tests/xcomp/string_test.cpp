@@ -1,7 +1,9 @@
 #include <clocale>
+#include <sstream>
 
 #include <gtest/gtest.h>
 
+#include "tools/thread_pool.hpp"
 #include "xcomp/string.hpp"
 
 class SequenceTest : public ::testing::Test {};
@@ -12,6 +14,12 @@ TEST_F(SequenceTest, ignore) {
     EXPECT_EQ(t.lex(), "45");
 }
 
+TEST_F(SequenceTest, octal_stops_after_3_digits) {
+    Token t(Token::Type::StringLitteral, "\\1234");
+    convert_escape_sequence(t);
+    EXPECT_EQ(t.lex(), "S4");
+}
+
 class GenerateTest : public testing::TestWithParam<std::string> {};
 
 const std::vector<std::string> prefix{"", "u8", "u", "U", "L"};
@@ -45,6 +53,19 @@ TEST_P(GenerateDeathTest, bad_sequence) {
 
 INSTANTIATE_TEST_SUITE_P(bad_sequence, GenerateDeathTest, testing::Combine(testing::ValuesIn(bad_sequence), testing::ValuesIn(prefix)));
 
+// Sequences cut short used to read past the end of the lexeme, or make std::stol throw
+TEST(SequenceDeathTest, truncated) {
+    const std::pair<std::string, std::string> cases[] = {{"\\x", "no following hex digits"},
+                                                         {"\\u12", "incomplete universal character name"},
+                                                         {"\\U0001F", "incomplete universal character name"},
+                                                         {"a\\", "bad escape sequence"},
+                                                         {"", "empty character litteral"}};
+    for (const auto &[lexeme, message] : cases) {
+        Token t(lexeme.empty() ? Token::Type::CharLitteral : Token::Type::StringLitteral, lexeme);
+        EXPECT_DEATH(convert_escape_sequence(t), message) << lexeme;
+    }
+}
+
 class GenerateDeathTest2 : public testing::TestWithParam<int> {};
 
 const std::vector<std::string> prefi{"", "u8", "u", "U", "L", "u8"};
@@ -79,3 +100,229 @@ TEST_P(GenerateTest3, StringLitteral_prefix) {
 }
 
 INSTANTIATE_TEST_SUITE_P(prefix2, GenerateTest3, testing::ValuesIn(prefix2));
+
+class BatchTest : public ::testing::Test {
+  protected:
+    static std::vector<Token> tokens(size_t n) {
+        std::vector<Token> v;
+        for (size_t i = 0; i < n; ++i) {
+            v.emplace_back(Token::Type::Identifier, "x");
+            Token s(Token::Type::StringLitteral, StringLitteral[i % size(StringLitteral)]);
+            s.prefix(prefix2[i % size(prefix2)]);
+            v.push_back(s);
+            v.emplace_back(Token::Type::CharLitteral, CharLitteral[i % size(CharLitteral)]);
+        }
+        return v;
+    }
+};
+
+using BatchDeathTest = BatchTest;
+
+TEST_F(BatchTest, same_as_serial) {
+    std::vector<Token> v = tokens(1000);
+    ThreadPool pool(4);
+    for (unsigned jobs : {1u, 3u, 8u}) {
+        for (ThreadPool *p : {static_cast<ThreadPool *>(nullptr), &pool}) {
+            ConvertedLitterals c = convert_escape_sequences(v, jobs, p);
+            for (size_t i = 0; i < size(v); ++i) {
+                if (v[i].is(Token::Type::Identifier)) {
+                    EXPECT_FALSE(c.has(i));
+                    continue;
+                }
+                Token t = v[i];
+                convert_escape_sequence(t);
+                ASSERT_TRUE(c.has(i));
+                EXPECT_EQ(c[i], t.lex());
+            }
+        }
+    }
+}
+
+TEST_F(BatchTest, from_pool_tasks) {
+    // Every worker converting at once: the callers convert their own chunks instead of waiting on the queued ones
+    std::vector<Token> v = tokens(300);
+    std::string expected = convert_escape_sequences(v, 1).arena();
+    ThreadPool pool(2);
+    std::vector<std::string> got(8);
+    for (size_t i = 0; i < size(got); ++i) {
+        pool.submit([&v, &pool, &got, i]() noexcept { got[i] = convert_escape_sequences(v, 8, &pool).arena(); });
+    }
+    pool.wait();
+    for (const std::string &g : got) {
+        EXPECT_EQ(g, expected);
+    }
+}
+
+TEST_F(BatchTest, contiguous) {
+    std::vector<Token> v = tokens(100);
+    ThreadPool pool(4);
+    ConvertedLitterals c = convert_escape_sequences(v, 4, &pool);
+    size_t total = 0;
+    for (size_t i = 0; i < size(v); ++i) {
+        if (c.has(i)) {
+            EXPECT_EQ(c[i].data(), c.arena().data() + total);
+            total += size(c[i]);
+        }
+    }
+    EXPECT_EQ(total, size(c.arena()));
+}
+
+TEST_F(BatchTest, empty) {
+    ConvertedLitterals c = convert_escape_sequences({}, 4);
+    EXPECT_TRUE(c.arena().empty());
+    EXPECT_FALSE(c.has(0));
+}
+
+TEST_F(BatchTest, raw_strings_are_copied) {
+    std::vector<Token> v;
+    Lexer l("R\"(\\d+)\" R\"x(\\n)x\"");
+    for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+        v.push_back(std::move(t));
+    }
+    ConvertedLitterals c = convert_escape_sequences(v, 1);
+    ASSERT_TRUE(c.has(0));
+    EXPECT_EQ(c[0], "\\d+");
+    ASSERT_TRUE(c.has(2));
+    EXPECT_EQ(c[2], "\\n");
+}
+
+TEST_F(BatchDeathTest, first_error_in_token_order) {
+    std::vector<Token> v = tokens(1000);
+    v[100] = Token(Token::Type::StringLitteral, "\\q");
+    v[2000] = Token(Token::Type::StringLitteral, "\\uD800");
+    EXPECT_DEATH(convert_escape_sequences(v, 4), "bad escape sequence");
+    EXPECT_DEATH(
+        {
+            ThreadPool pool(4);
+            convert_escape_sequences(v, 4, &pool);
+        },
+        "bad escape sequence");
+}
+
+/**
+ * Litterals of `source` lexed with decoding, or the fatal error which stopped the lexer
+ */
+static std::vector<std::string> decoded_litterals(const std::string &source) {
+    std::ostringstream os;
+    DiagnosticsTo to(os);
+    ThrowOnFatal guard;
+    std::vector<std::string> v;
+    try {
+        Lexer l(source);
+        l.decode_litterals(true);
+        for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+            if (t.is_one_of(Token::Type::CharLitteral, Token::Type::StringLitteral)) {
+                EXPECT_TRUE(t.decoded());
+                v.emplace_back(t.lex());
+            }
+        }
+    } catch (const FatalError &e) {
+        v.push_back(std::string("fatal: ") + e.what());
+    }
+    return v;
+}
+
+TEST_P(GenerateTest3, fused_decoding) {
+    for (size_t i = 0; i < size(StringLitteral); ++i) {
+        EXPECT_EQ(decoded_litterals(GetParam() + '"' + StringLitteral[i] + '"'), std::vector<std::string>{StringLitteral_real[i]});
+    }
+    for (size_t i = 0; i < size(CharLitteral); ++i) {
+        EXPECT_EQ(decoded_litterals(GetParam() + '\'' + CharLitteral[i] + '\''), std::vector<std::string>{CharLitteral_real[i]});
+    }
+}
+
+TEST(FusedDecodingTest, same_as_convert_escape_sequence) {
+    std::string source;
+    for (size_t i = 0; i < 200; ++i) {
+        source += prefix2[i % size(prefix2)] + '"' + StringLitteral[i % size(StringLitteral)] + "\" caf\xC3\xA9 ";
+        source += '\'' + CharLitteral[i % size(CharLitteral)] + "' R\"(\\n)\" x;\n";
+    }
+    source += "\"\\1234\" u8\"\\1234\" L\"\\0101\"\n";
+    source += "\"\\xff\\200\" u8\"\\xC3\\xA9\" u\"\\xff\" '\\377'\n";
+
+    Lexer two_pass(source);
+    Lexer fused(source);
+    fused.decode_litterals(true);
+    for (Token t = two_pass.next(), u = fused.next(); !t.is(Token::Type::End); t = two_pass.next(), u = fused.next()) {
+        ASSERT_EQ(t.type(), u.type());
+        if (!t.raw()) {
+            convert_escape_sequence(t);
+        }
+        EXPECT_EQ(t.lex(), u.lex());
+        EXPECT_EQ(t.prefix(), u.prefix());
+    }
+}
+
+TEST(FusedDecodingTest, errors) {
+    auto error = [](const std::string &source) { return decoded_litterals(source).back(); };
+    EXPECT_EQ(error("'ab'"), "fatal: multicharacter literal are not supported");
+    EXPECT_EQ(error("'\\n\\n'"), "fatal: multicharacter literal are not supported");
+    EXPECT_EQ(error("''"), "fatal: empty character litteral");
+    EXPECT_EQ(error("\"\\x\""), "fatal: \\x used with no following hex digits");
+    EXPECT_EQ(error("\"\\x123\""), "fatal: hex escape sequence out of range");
+    EXPECT_EQ(error("u\"\\x12345\""), "fatal: hex escape sequence out of range");
+    EXPECT_EQ(error("U\"\\x12345678\""), "fatal: invalid unicode sequence");
+    EXPECT_EQ(error("u8'\\777'"), "fatal: octal escape sequence out of range");
+    EXPECT_EQ(error("\"\\400\""), "fatal: octal escape sequence out of range");
+    EXPECT_EQ(error("\"\\uD800\""), "fatal: invalid unicode sequence");
+    EXPECT_EQ(error("\"\\U00110000\""), "fatal: invalid unicode sequence");
+    EXPECT_EQ(error("\"\\q\""), "fatal: bad escape sequence");
+    // Octal escapes have at most 3 digits
+    EXPECT_EQ(decoded_litterals("\"\\1234\""), std::vector<std::string>{"S4"});
+    EXPECT_EQ(decoded_litterals("R\"(\\q)\""), std::vector<std::string>{"\\q"});
+    // Numeric escapes are bytes in a narrow litteral, code points in a wide one
+    EXPECT_EQ(decoded_litterals("\"\\xff\\377\" u8\"\\xC3\" u\"\\xff\""), (std::vector<std::string>{"\xFF\xFF", "\xC3", "\xC3\xBF"}));
+}
+
+static std::vector<Token> lex(const std::string &source, bool decode) {
+    std::vector<Token> v;
+    Lexer l(source);
+    l.decode_litterals(decode);
+    for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+        v.push_back(t);
+    }
+    return v;
+}
+
+class ConcatenationTest : public testing::TestWithParam<bool> {};
+
+TEST_P(ConcatenationTest, adjacent) {
+    std::vector<Token> v = lex("x = \"abc\" \"d\\101f\"\n\tu8\"ghi\" R\"(\\n)\"; 'c' \"j\" y \"k\";", GetParam());
+    concatenate_litterals(v);
+    std::ostringstream os;
+    for (const Token &t : v) {
+        os << t.prefix() << '|' << t.lex() << '|';
+    }
+    EXPECT_EQ(os.str(), "|x|| ||=|| |u8|abcdAfghi\\n||;|| ||c|| ||j|| ||y|| ||k||;|");
+}
+
+TEST_P(ConcatenationTest, prefix) {
+    for (auto [source, expected] : std::vector<std::pair<std::string, std::string>>{
+             {"\"a\" \"b\"", ""}, {"U\"a\" \"b\"", "U"}, {"\"a\" L\"b\" \"c\"", "L"}, {"u\"a\" u\"b\"", "u"}}) {
+        std::vector<Token> v = lex(source, GetParam());
+        concatenate_litterals(v);
+        ASSERT_EQ(size(v), 1u) << source;
+        EXPECT_EQ(v[0].prefix(), expected) << source;
+        EXPECT_TRUE(v[0].decoded());
+    }
+}
+
+TEST_P(ConcatenationTest, many_pieces) {
+    std::string source;
+    std::string expected;
+    for (size_t i = 0; i < 20000; ++i) {
+        source += "\"line " + std::to_string(i) + "\\n\"\n";
+        expected += "line " + std::to_string(i) + "\n";
+    }
+    std::vector<Token> v = lex(source, GetParam());
+    concatenate_litterals(v);
+    ASSERT_EQ(size(v), 2u); // the last newline is not between litterals
+    EXPECT_EQ(v[0].lex(), expected);
+}
+
+INSTANTIATE_TEST_SUITE_P(decode, ConcatenationTest, testing::Bool());
+
+TEST(ConcatenationDeathTest, different_prefixes) {
+    std::vector<Token> v = lex("u8\"a\" \"b\" u\"c\"", true);
+    EXPECT_DEATH(concatenate_litterals(v), "different encoding prefixes u8 and u");
+}
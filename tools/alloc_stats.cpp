@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iterator>
+#include <malloc.h>
+#include <new>
+
+#include "alloc_stats.hpp"
+
+static_assert(std::size(alloc_category_names) == static_cast<size_t>(AllocCategory::Count));
+
+AllocStats &AllocStats::instance() noexcept {
+    // Constant initialized: usable from operator new before any constructor has run
+    static AllocStats s;
+    return s;
+}
+
+AllocStats::Counts AllocStats::counts(AllocCategory c) const noexcept {
+    size_t i = static_cast<size_t>(c);
+    return Counts{m_allocations[i].load(std::memory_order_relaxed), m_bytes[i].load(std::memory_order_relaxed)};
+}
+
+AllocStats::Counts AllocStats::total() const noexcept {
+    Counts t;
+    for (size_t i = 0; i < categories; ++i) {
+        t.allocations += m_allocations[i].load(std::memory_order_relaxed);
+        t.bytes += m_bytes[i].load(std::memory_order_relaxed);
+    }
+    return t;
+}
+
+void AllocStats::on_alloc(size_t bytes) noexcept {
+    size_t c = static_cast<size_t>(current_alloc_category);
+    m_allocations[c].fetch_add(1, std::memory_order_relaxed);
+    m_bytes[c].fetch_add(bytes, std::memory_order_relaxed);
+
+    uint64_t live = m_live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    std::atomic<uint64_t> &peak = m_peak[static_cast<size_t>(current_phase)];
+    uint64_t p = peak.load(std::memory_order_relaxed);
+    while (p < live && !peak.compare_exchange_weak(p, live, std::memory_order_relaxed)) {
+    }
+}
+
+void AllocStats::on_free(size_t bytes) noexcept { m_live.fetch_sub(bytes, std::memory_order_relaxed); }
+
+void AllocStats::reset() noexcept {
+    for (size_t i = 0; i < categories; ++i) {
+        m_allocations[i].store(0, std::memory_order_relaxed);
+        m_bytes[i].store(0, std::memory_order_relaxed);
+    }
+    for (std::atomic<uint64_t> &p : m_peak) {
+        p.store(0, std::memory_order_relaxed);
+    }
+}
+
+void AllocStats::print_table(std::ostream &os) const {
+    os << std::left << std::setw(28) << "allocations" << std::right << std::setw(12) << "count" << std::setw(14) << "bytes" << '\n';
+    for (size_t i = 0; i < categories; ++i) {
+        Counts c = counts(static_cast<AllocCategory>(i));
+        os << std::left << std::setw(28) << alloc_category_names[i] << std::right << std::setw(12) << c.allocations << std::setw(14) << c.bytes
+           << '\n';
+    }
+
+    os << '\n' << std::left << std::setw(28) << "peak live bytes" << '\n';
+    for (size_t i = 0; i < phases; ++i) {
+        uint64_t peak = m_peak[i].load(std::memory_order_relaxed);
+        os << std::left << std::setw(28) << phase_name(static_cast<Phase>(i)) << std::right << std::setw(12) << peak << '\n';
+    }
+}
+
+#if XCOMP_ALLOC_STATS
+// Replacement of the global allocation functions, the other forms forward to these
+// https://timsong-cpp.github.io/cppwp/new.delete.single
+
+void *operator new(size_t n) {
+    void *p = std::malloc(n == 0 ? 1 : n);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    AllocStats::instance().on_alloc(malloc_usable_size(p));
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    if (p != nullptr) {
+        AllocStats::instance().on_free(malloc_usable_size(p));
+        std::free(p);
+    }
+}
+
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+
+// std::pmr::new_delete_resource() goes through the aligned forms
+
+void *operator new(size_t n, std::align_val_t a) {
+    void *p = nullptr;
+    size_t alignment = std::max(static_cast<size_t>(a), sizeof(void *));
+    if (posix_memalign(&p, alignment, n == 0 ? 1 : n) != 0) {
+        throw std::bad_alloc();
+    }
+    AllocStats::instance().on_alloc(malloc_usable_size(p));
+    return p;
+}
+
+void operator delete(void *p, std::align_val_t) noexcept { operator delete(p); }
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept { operator delete(p); }
+#endif
@@ -0,0 +1,99 @@
+#ifndef ALLOC_STATS_HPP
+#define ALLOC_STATS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+#include "stats.hpp"
+
+/**
+ * Opt-in allocation profiling, see the XCOMP_ALLOC_STATS CMake option
+ * When enabled, linking alloc_stats.cpp replaces the global operator new and delete
+ */
+#ifndef XCOMP_ALLOC_STATS
+#define XCOMP_ALLOC_STATS 0
+#endif
+
+enum class AllocCategory { Other, TokenLexeme, LitteralDecoding, OperatorTable, Diagnostics, Count };
+
+inline constexpr std::string_view alloc_category_names[] = {"other", "token lexemes", "litteral decoding", "operator tables", "diagnostics"};
+
+constexpr std::string_view alloc_category_name(AllocCategory c) noexcept { return alloc_category_names[static_cast<size_t>(c)]; }
+
+/**
+ * Innermost allocation category of the calling thread
+ */
+inline thread_local AllocCategory current_alloc_category = AllocCategory::Other;
+
+/**
+ * Allocations and bytes per category, live and peak live bytes per phase
+ * Bytes are the usable size reported by malloc, not the requested size
+ */
+class AllocStats {
+  public:
+    struct Counts {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+    };
+
+    [[gnu::const]] static AllocStats &instance() noexcept;
+
+    AllocStats(const AllocStats &) = delete;
+    AllocStats &operator=(const AllocStats &) = delete;
+
+    Counts counts(AllocCategory c) const noexcept;
+    Counts total() const noexcept;
+    uint64_t live_bytes() const noexcept { return m_live.load(std::memory_order_relaxed); }
+
+    /**
+     * Highest live byte count seen by an allocation made during `p`, Phase::Count for outside of any phase
+     */
+    uint64_t peak_bytes(Phase p) const noexcept { return m_peak[static_cast<size_t>(p)].load(std::memory_order_relaxed); }
+
+    void on_alloc(size_t bytes) noexcept;
+    void on_free(size_t bytes) noexcept;
+
+    /**
+     * Zero the counts and the peaks, live bytes are kept
+     */
+    void reset() noexcept;
+
+    void print_table(std::ostream &os) const;
+
+  private:
+    constexpr AllocStats() noexcept = default;
+
+    static constexpr size_t categories = static_cast<size_t>(AllocCategory::Count);
+    static constexpr size_t phases = static_cast<size_t>(Phase::Count) + 1;
+
+    std::atomic<uint64_t> m_allocations[categories] = {};
+    std::atomic<uint64_t> m_bytes[categories] = {};
+    std::atomic<uint64_t> m_live{0};
+    std::atomic<uint64_t> m_peak[phases] = {};
+};
+
+/**
+ * Charge the allocations of the enclosing scope to `c`
+ */
+class AllocScope {
+  public:
+    explicit AllocScope(AllocCategory c) noexcept : m_outer(current_alloc_category) { current_alloc_category = c; }
+    ~AllocScope() { current_alloc_category = m_outer; }
+
+    AllocScope(const AllocScope &) = delete;
+    AllocScope &operator=(const AllocScope &) = delete;
+
+  private:
+    AllocCategory m_outer;
+};
+
+#if XCOMP_ALLOC_STATS
+#define ALLOC_SCOPE(category) AllocScope STATS_CONCAT(alloc_scope_, __LINE__)(category)
+#else
+#define ALLOC_SCOPE(category) static_cast<void>(0)
+#endif
+
+#endif // !ALLOC_STATS_HPP
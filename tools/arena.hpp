@@ -0,0 +1,31 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory_resource>
+
+/**
+ * Monotonic memory for everything allocated while compiling one translation unit
+ * Nothing is freed one by one: reset() gives the whole arena back at once
+ */
+class Arena {
+  public:
+    explicit Arena(size_t initial_size = 64 * 1024, std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+        : m_resource(initial_size, upstream) {}
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    std::pmr::memory_resource *resource() noexcept { return &m_resource; }
+
+    /**
+     * Release all the memory of the translation unit
+     * Every token or string allocated from this arena is dangling afterwards
+     */
+    void reset() noexcept { m_resource.release(); }
+
+  private:
+    std::pmr::monotonic_buffer_resource m_resource;
+};
+
+#endif // !ARENA_HPP
@@ -2,37 +2,105 @@
 #define ERROR_HPP
 
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "alloc_stats.hpp"
+#include "stats.hpp"
 
 constexpr std::string_view normal = "\x1b[0m";
 constexpr std::string_view purple = "\x1b[1;35m";
 constexpr std::string_view red = "\x1b[1;31m";
 
 /**
- * Print args to stderr, then exit
+ * Thrown by fatal() instead of exiting, while a ThrowOnFatal is alive on the thread
+ */
+class FatalError : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Defined to 1 by the fuzz targets: fatal() always throws there, an input the compiler gives up on is not a crash
+ */
+#ifndef XCOMP_FUZZ
+#define XCOMP_FUZZ 0
+#endif
+
+inline thread_local int throw_on_fatal = XCOMP_FUZZ;
+
+/**
+ * Make fatal() throw a FatalError on this thread, so a worker can hand its error back
+ */
+class ThrowOnFatal {
+  public:
+    ThrowOnFatal() noexcept { ++throw_on_fatal; }
+    ~ThrowOnFatal() { --throw_on_fatal; }
+    ThrowOnFatal(const ThrowOnFatal &) = delete;
+    ThrowOnFatal &operator=(const ThrowOnFatal &) = delete;
+};
+
+inline thread_local std::ostream *diagnostics_stream = nullptr;
+
+/**
+ * Where diagnostics of this thread go, stderr by default
+ */
+inline std::ostream &diagnostics() { return diagnostics_stream ? *diagnostics_stream : std::cerr; }
+
+/**
+ * Send the diagnostics of this thread to `os`, so a worker can buffer them and keep the output in order
+ */
+class DiagnosticsTo {
+  public:
+    explicit DiagnosticsTo(std::ostream &os) noexcept : m_outer(diagnostics_stream) { diagnostics_stream = &os; }
+    ~DiagnosticsTo() { diagnostics_stream = m_outer; }
+    DiagnosticsTo(const DiagnosticsTo &) = delete;
+    DiagnosticsTo &operator=(const DiagnosticsTo &) = delete;
+
+  private:
+    std::ostream *m_outer;
+};
+
+/**
+ * Print args to diagnostics(), then exit
  */
 template <typename... T> [[noreturn]] void fatal(T... t) {
-    std::cerr << red << "error: " << normal;
-    (std::cerr << ... << t);
-    std::cerr << std::endl;
+    STATS_COUNT(Counter::Diagnostics, 1);
+    ALLOC_SCOPE(AllocCategory::Diagnostics);
+    if (throw_on_fatal != 0) {
+        std::ostringstream os;
+        (os << ... << t);
+        throw FatalError(os.str());
+    }
+    std::ostream &os = diagnostics();
+    os << red << "error: " << normal;
+    (os << ... << t);
+    os << std::endl;
     exit(EXIT_FAILURE);
 }
 
 /**
- * Print args to stderr
+ * Print args to diagnostics()
  */
 template <typename... T> void error(T... t) {
-    std::cerr << red << "error: " << normal;
-    (std::cerr << ... << t);
-    std::cerr << std::endl;
+    STATS_COUNT(Counter::Diagnostics, 1);
+    ALLOC_SCOPE(AllocCategory::Diagnostics);
+    std::ostream &os = diagnostics();
+    os << red << "error: " << normal;
+    (os << ... << t);
+    os << std::endl;
 }
 
 /**
- * Print args to stderr
+ * Print args to diagnostics()
  */
 template <typename... T> void warning(T... t) {
-    std::cerr << purple << "warning: " << normal;
-    (std::cerr << ... << t);
-    std::cerr << std::endl;
+    STATS_COUNT(Counter::Diagnostics, 1);
+    ALLOC_SCOPE(AllocCategory::Diagnostics);
+    std::ostream &os = diagnostics();
+    os << purple << "warning: " << normal;
+    (os << ... << t);
+    os << std::endl;
 }
 
 #endif
@@ -0,0 +1,162 @@
+#include <filesystem>
+#include <fstream>
+#include <sys/stat.h>
+
+#include "file_cache.hpp"
+#include "stats.hpp"
+
+bool read_file(const std::string &path, std::string &out) {
+    STATS_TIMER(Phase::Read);
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        return false;
+    }
+    f.seekg(0, std::ios::end);
+    std::streamoff n = f.tellg();
+    f.seekg(0, std::ios::beg);
+    out.resize(n > 0 ? static_cast<size_t>(n) : 0);
+    f.read(out.data(), static_cast<std::streamsize>(out.size()));
+    out.resize(static_cast<size_t>(f.gcount()));
+    return true;
+}
+
+uint64_t content_hash(std::string_view s) noexcept {
+    uint64_t h = 0xcbf29ce484222325;
+    for (char c : s) {
+        h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+    }
+    return h;
+}
+
+std::string FileCache::key(const std::string &path) {
+    std::error_code ec;
+    std::filesystem::path p = std::filesystem::absolute(path, ec);
+    return ec ? path : p.lexically_normal().string();
+}
+
+bool FileCache::stamp(const std::string &path, Stamp &s) noexcept {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+    s.inode = st.st_ino;
+    s.size = static_cast<uint64_t>(st.st_size);
+    s.mtime_ns = st.st_mtim.tv_sec * int64_t{1000000000} + st.st_mtim.tv_nsec;
+    return true;
+}
+
+void FileCache::touch(Entry &e) { m_lru.splice(m_lru.begin(), m_lru, e.lru); }
+
+FileCache::Content FileCache::store(const std::string &k, Content content, const Stamp &s) {
+    auto it = m_files.find(k);
+    if (it != m_files.end()) {
+        m_bytes -= it->second.content->text.size();
+        it->second.content = std::move(content);
+        it->second.stamp = s;
+        touch(it->second);
+    } else {
+        m_lru.push_front(k);
+        it = m_files.emplace(k, Entry{std::move(content), s, m_lru.begin()}).first;
+    }
+    m_bytes += it->second.content->text.size();
+    Content c = it->second.content;
+
+    // The entry just stored is at the front, it is only evicted if it is over budget by itself
+    while (m_bytes > m_budget && !m_lru.empty()) {
+        auto victim = m_files.find(m_lru.back());
+        m_bytes -= victim->second.content->text.size();
+        m_files.erase(victim);
+        m_lru.pop_back();
+    }
+    return c;
+}
+
+FileCache::Content FileCache::read(const std::string &path) {
+    std::string k = key(path);
+    Stamp s;
+    if (!stamp(path, s)) {
+        return nullptr;
+    }
+
+    Content old;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_files.find(k);
+        if (it != m_files.end()) {
+            if (it->second.stamp == s) {
+                ++m_hits;
+                touch(it->second);
+                return it->second.content;
+            }
+            old = it->second.content;
+        }
+        ++m_misses;
+    }
+
+    // Read without the lock, if two workers race on the same file the last store wins
+    auto f = std::make_shared<SourceFile>();
+    if (!read_file(path, f->text)) {
+        return nullptr;
+    }
+    f->hash = content_hash(f->text);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (old && old->hash == f->hash && old->text == f->text) {
+        return store(k, std::move(old), s); // touched but unchanged, keep what depends on the old content
+    }
+    return store(k, std::move(f), s);
+}
+
+FileCache::Content FileCache::find(const std::string &path) {
+    std::string k = key(path);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_files.find(k);
+    if (it == m_files.end()) {
+        return nullptr;
+    }
+    touch(it->second);
+    return it->second.content;
+}
+
+FileCache::Content FileCache::insert(const std::string &path, std::string text) {
+    Stamp s;
+    if (!stamp(path, s)) {
+        s = Stamp{}; // never matches a real file, the next read() checks the file again
+    }
+    return insert(path, std::move(text), s);
+}
+
+FileCache::Content FileCache::insert(const std::string &path, std::string text, const Stamp &s) {
+    auto f = std::make_shared<SourceFile>();
+    f->text = std::move(text);
+    f->hash = content_hash(f->text);
+
+    std::string k = key(path);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_files.find(k);
+    if (it != m_files.end() && (it->second.stamp == s || s == Stamp{})) {
+        touch(it->second);
+        return it->second.content;
+    }
+    return store(k, std::move(f), s);
+}
+
+size_t FileCache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_files.size();
+}
+
+size_t FileCache::bytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+size_t FileCache::hits() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+size_t FileCache::misses() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
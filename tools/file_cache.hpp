@@ -0,0 +1,111 @@
+#ifndef FILE_CACHE_HPP
+#define FILE_CACHE_HPP
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Content of a source file and its hash
+ */
+struct SourceFile {
+    std::string text;
+    uint64_t hash = 0;
+};
+
+/**
+ * Content of the source files, shared by every worker and, in daemon mode, by every request
+ *
+ * An entry is valid while the inode, size and modification time of its file are unchanged.
+ * When they change the file is read again; if its hash is the same, the old content is kept.
+ * Entries are evicted in LRU order once their total size exceeds the budget.
+ */
+class FileCache {
+  public:
+    using Content = std::shared_ptr<const SourceFile>;
+
+    /**
+     * What an entry is validated against
+     */
+    struct Stamp {
+        uint64_t inode = 0;
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+
+        bool operator==(const Stamp &o) const noexcept { return inode == o.inode && size == o.size && mtime_ns == o.mtime_ns; }
+    };
+
+    /**
+     * Stat `path`, return false if it does not exist
+     */
+    static bool stamp(const std::string &path, Stamp &s) noexcept;
+
+    /**
+     * Absolute path, so that requests from different directories share entries
+     */
+    static std::string key(const std::string &path);
+
+    explicit FileCache(size_t budget = SIZE_MAX) noexcept : m_budget(budget) {}
+
+    /**
+     * Return the content of `path`, reading it if it is absent or stale, nullptr if it cannot be read
+     */
+    Content read(const std::string &path);
+
+    /**
+     * Return the cached content of `path` without checking the file, nullptr if absent
+     */
+    Content find(const std::string &path);
+
+    /**
+     * Store content read by someone else, keep the existing one if `path` is already cached and up to date
+     */
+    Content insert(const std::string &path, std::string text);
+
+    /**
+     * Same, with the stamp taken by the caller before reading `text`
+     */
+    Content insert(const std::string &path, std::string text, const Stamp &s);
+
+    size_t size() const;
+    size_t bytes() const;
+    size_t hits() const;
+    size_t misses() const;
+
+  private:
+    struct Entry {
+        Content content;
+        Stamp stamp;
+        std::list<std::string>::iterator lru;
+    };
+
+    /**
+     * Store `content` for `k` and evict the oldest entries if over budget, m_mutex held
+     */
+    Content store(const std::string &k, Content content, const Stamp &s);
+    void touch(Entry &e);
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_files;
+    std::list<std::string> m_lru; // most recently used first
+    size_t m_budget;
+    size_t m_bytes = 0;
+    size_t m_hits = 0;
+    size_t m_misses = 0;
+};
+
+/**
+ * Read the whole file, return false if it cannot be opened
+ */
+bool read_file(const std::string &path, std::string &out);
+
+/**
+ * FNV-1a of `s`
+ */
+[[gnu::pure]] uint64_t content_hash(std::string_view s) noexcept;
+
+#endif // !FILE_CACHE_HPP
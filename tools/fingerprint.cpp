@@ -0,0 +1,12 @@
+#include "fingerprint.hpp"
+
+uint64_t fingerprint(Standard standard, std::string source, std::string *words) {
+    Fingerprint f(words);
+    with_lexer(standard, source, std::pmr::get_default_resource(), LexerEngine::Dfa, [&f](auto &l) {
+        l.decode_litterals(true);
+        for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+            f.add(t);
+        }
+    });
+    return f.value();
+}
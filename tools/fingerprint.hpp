@@ -0,0 +1,114 @@
+#ifndef FINGERPRINT_HPP
+#define FINGERPRINT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "language.hpp"
+#include "lexer.hpp"
+
+/**
+ * Streaming hash of a token stream, Space and Newline tokens are skipped outside of directives
+ * Reformatting a file (indentation, blank lines, spaces between tokens) does not change it, except where the
+ * preprocessor sees the difference: the '#' which starts a line and the Newline which ends it, and whether a space
+ * follows the name of a #define, which tells an object-like macro from a function-like one.
+ *
+ * add() is meant to be called on each token in the lexing loop, while the lexeme is hot:
+ * the lexeme is mixed 8 bytes at a time, with one multiply per word.
+ * With `words`, the words mixed are also appended to it: two token streams have the same words if and only if
+ * they hash the same tokens, which confirms two equal fingerprints.
+ */
+class Fingerprint {
+  public:
+    explicit Fingerprint(std::string *words = nullptr) noexcept : m_words(words) {}
+
+    void add(const Token &t) {
+        if (t.is(Token::Type::Newline)) {
+            if (m_directive != Directive::None) {
+                mix(directive_end);
+            }
+            m_directive = Directive::None;
+            m_line_start = true;
+            return;
+        }
+        if (t.is(Token::Type::Space)) {
+            if (m_directive == Directive::MacroName) {
+                mix(space_after_macro_name);
+                m_directive = Directive::Other;
+            }
+            return;
+        }
+        track_directive(t);
+        // The type and the lengths separate "ab" from "a" "b" and u8"a" from u8 "a"
+        std::string_view p = t.prefix();
+        std::string_view s = t.lex();
+        mix(static_cast<uint64_t>(t.type()) | uint64_t{t.raw()} << 8 | size(p) << 16 | size(s) << 32);
+        if (!p.empty()) {
+            bytes(p);
+        }
+        bytes(s);
+    }
+
+    uint64_t value() const noexcept { return m_h; }
+
+  private:
+    // Words which are not the header of a token: the raw byte of a header is 0 or 1
+    static constexpr uint64_t directive_start = 0xFF01;
+    static constexpr uint64_t directive_end = 0xFF02;
+    static constexpr uint64_t space_after_macro_name = 0xFF03;
+
+    // Where a token stands in a preprocessing directive
+    enum class Directive { None, Hash, Define, MacroName, Other };
+
+    void track_directive(const Token &t) {
+        if (m_line_start && t.is(Token::Type::PreprocessingOperator) && t.lex() == "#") {
+            mix(directive_start);
+            m_directive = Directive::Hash;
+        } else if (m_directive == Directive::Hash && t.is(Token::Type::Identifier) && t.lex() == "define") {
+            m_directive = Directive::Define;
+        } else if (m_directive == Directive::Define && t.is(Token::Type::Identifier)) {
+            m_directive = Directive::MacroName;
+        } else if (m_directive != Directive::None) {
+            m_directive = Directive::Other;
+        }
+        m_line_start = false;
+    }
+
+    void mix(uint64_t w) {
+        if (m_words) {
+            m_words->append(reinterpret_cast<const char *>(&w), sizeof(w));
+        }
+        m_h = (m_h ^ w) * 0x9e3779b97f4a7c15;
+        m_h ^= m_h >> 32;
+    }
+
+    void bytes(std::string_view s) {
+        const char *p = s.data();
+        size_t n = size(s);
+        for (; n >= 8; p += 8, n -= 8) {
+            uint64_t w;
+            std::memcpy(&w, p, 8);
+            mix(w);
+        }
+        if (n) {
+            uint64_t w = 0;
+            std::memcpy(&w, p, n);
+            mix(w);
+        }
+    }
+
+    uint64_t m_h = 0xcbf29ce484222325;
+    std::string *m_words;
+    Directive m_directive = Directive::None;
+    bool m_line_start = true;
+};
+
+/**
+ * Fingerprint of the tokens of `source` lexed as `standard`, litterals decoded as the driver does, its words appended to `words`
+ * Raise a fatal error if `source` cannot be lexed
+ */
+uint64_t fingerprint(Standard standard, std::string source, std::string *words = nullptr);
+
+#endif // !FINGERPRINT_HPP
@@ -0,0 +1,126 @@
+#ifndef INTERNER_HPP
+#define INTERNER_HPP
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Store each identifier once and give it a stable id
+ * Ids are handed out in insertion order, starting at 0
+ */
+class Interner {
+  public:
+    using Id = uint32_t;
+
+    Id intern(std::string_view s) {
+        auto it = m_ids.find(s);
+        if (it != m_ids.end()) {
+            return it->second;
+        }
+        Id id = static_cast<Id>(m_strings.size());
+        const std::string &stored = m_strings.emplace_back(s);
+        m_ids.emplace(stored, id);
+        m_bytes += s.size() + entry_bytes;
+        return id;
+    }
+
+    /**
+     * Forget every string, ids start again at 0
+     */
+    void clear() noexcept {
+        m_ids.clear();
+        m_strings.clear();
+        m_bytes = 0;
+    }
+
+    /**
+     * Return true and set `id` if `s` was already interned
+     */
+    bool find(std::string_view s, Id &id) const noexcept {
+        auto it = m_ids.find(s);
+        if (it == m_ids.end()) {
+            return false;
+        }
+        id = it->second;
+        return true;
+    }
+
+    std::string_view str(Id id) const noexcept { return m_strings[id]; }
+    size_t size() const noexcept { return m_strings.size(); }
+
+    /**
+     * Estimate of the memory used, strings and their map entries
+     */
+    size_t bytes() const noexcept { return m_bytes; }
+
+  private:
+    static constexpr size_t entry_bytes = sizeof(std::string) + sizeof(std::string_view) + sizeof(Id) + 2 * sizeof(void *);
+
+    std::deque<std::string> m_strings; // deque keeps the views used as keys valid
+    std::unordered_map<std::string_view, Id> m_ids;
+    size_t m_bytes = 0;
+};
+
+/**
+ * Interner shared by the workers of the driver
+ * Lookups of already interned strings only take the lock in shared mode
+ * Ids depend on the order in which threads intern, they must not leak into the output
+ */
+class SharedInterner {
+  public:
+    using Id = Interner::Id;
+
+    Id intern(std::string_view s) {
+        Id id;
+        {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            if (m_interner.find(s, id)) {
+                return id;
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        return m_interner.intern(s);
+    }
+
+    bool find(std::string_view s, Id &id) const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_interner.find(s, id);
+    }
+
+    /**
+     * The view stays valid until clear()
+     */
+    std::string_view str(Id id) const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_interner.str(id);
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_interner.size();
+    }
+
+    size_t bytes() const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_interner.bytes();
+    }
+
+    /**
+     * Forget every string, no id handed out before may be used after
+     */
+    void clear() {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_interner.clear();
+    }
+
+  private:
+    mutable std::shared_mutex m_mutex;
+    Interner m_interner;
+};
+
+#endif // !INTERNER_HPP
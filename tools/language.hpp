@@ -0,0 +1,75 @@
+#ifndef LANGUAGE_HPP
+#define LANGUAGE_HPP
+
+#include <string_view>
+#include <utility>
+
+/**
+ * Language and standard a file is lexed as
+ */
+enum class Standard { C11, C17, Cxx17, Cxx20 };
+
+/**
+ * True for the C++ standards, for code which is not templated on a Language
+ */
+constexpr bool is_cxx(Standard s) noexcept { return s == Standard::Cxx17 || s == Standard::Cxx20; }
+
+/**
+ * Compile time policy of the lexer for `S`, the lexical features of the other standards are compiled out
+ */
+template <Standard S> struct Language {
+    static constexpr Standard standard = S;
+    static constexpr bool cxx = is_cxx(S);
+
+    // R"d(...)d" https://timsong-cpp.github.io/cppwp/lex.string
+    static constexpr bool raw_strings = cxx;
+
+    // u8'c', C++17
+    static constexpr bool u8_char_litterals = cxx;
+
+    // '<' before "::" https://timsong-cpp.github.io/cppwp/lex.pptoken#4.2
+    static constexpr bool template_angle = cxx;
+
+    /**
+     * True if `spelling` is a punctuator of the language: C has no "::", ".*" and "->*", "<=>" is C++20
+     */
+    static constexpr bool has_punctuator(std::string_view spelling) noexcept {
+        if (spelling == "::" || spelling == ".*" || spelling == "->*") {
+            return cxx;
+        }
+        if (spelling == "<=>") {
+            return S == Standard::Cxx20;
+        }
+        return true;
+    }
+};
+
+using C11 = Language<Standard::C11>;
+using C17 = Language<Standard::C17>;
+using Cxx17 = Language<Standard::Cxx17>;
+using Cxx20 = Language<Standard::Cxx20>;
+
+/**
+ * Standard of -std=`name`: c11, c17, c++17 or c++20, false if unknown
+ */
+constexpr bool standard_of_name(std::string_view name, Standard &s) noexcept {
+    constexpr std::pair<std::string_view, Standard> names[] = {
+        {"c11", Standard::C11}, {"c17", Standard::C17}, {"c18", Standard::C17}, {"c++17", Standard::Cxx17}, {"c++20", Standard::Cxx20}};
+    for (const auto &[n, standard] : names) {
+        if (n == name) {
+            s = standard;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Standard of a file without -std: C17 for ".c" and ".h", C++20 otherwise
+ */
+constexpr Standard standard_of_path(std::string_view path) noexcept {
+    auto ends_with = [path](std::string_view e) { return path.size() >= e.size() && path.substr(path.size() - e.size()) == e; };
+    return ends_with(".c") || ends_with(".h") ? Standard::C17 : Standard::Cxx20;
+}
+
+#endif // !LANGUAGE_HPP
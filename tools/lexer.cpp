@@ -1,47 +1,118 @@
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <limits>
-#include <set>
 #include <vector>
 
 #include "lexer.hpp"
+#include "lexer_dfa.hpp"
 
 static bool is_digit(char c) noexcept { return c >= '0' && c <= '9'; }
 
-static bool is_non_digit(char c) noexcept {
-    constexpr std::string_view id("abcdefghijklmnopqrstuvwxyz"
-                                  "ABCDEFGHIJKLMNOPQRSTUVWXYZ_");
-    return id.find(c) != std::string::npos;
-}
+static bool is_non_digit(char c) noexcept { return char_classes[c] == CharClass::Letter || char_classes[c] == CharClass::Prefix; }
 
-static bool is_identifier_char(char c) noexcept { return is_digit(c) || is_non_digit(c); }
+static bool is_identifier_char(char c) noexcept { return is_identifier_class(char_classes[c]); }
 
 static bool is_quote(char c) { return c == '\'' || c == '"'; }
 
-Token Lexer::next() noexcept {
-    char c = peek();
-    switch (c) {
-    case '\0':
-        return atom(Token::Type::End);
-    case '\\':
-        fatal("stray '\\' in program");
+static bool is_utf8(char c) noexcept { return static_cast<unsigned char>(c) >= 0x80; }
+
+/**
+ * Return `c` as U+XXXX
+ */
+static std::string code_point_name(char32_t c) {
+    constexpr std::string_view hexa("0123456789ABCDEF");
+    std::string s;
+    for (; c != 0 || size(s) < 4; c >>= 4) {
+        s.insert(s.begin(), hexa[c & 0xF]);
+    }
+    return "U+" + s;
+}
+
+template <typename L> void BasicLexer<L>::check_encoding() const noexcept {
+    size_t i = utf8_validate(m_s);
+    if (i != std::string::npos) {
+        warning("invalid UTF-8 sequence at offset ", i);
+    }
+}
+
+template <typename L> bool BasicLexer<L>::skip_utf8() {
+    char32_t c;
+    size_t len;
+    if (!is_utf8(peek()) || !utf8_decode(m_s, m_beg, c, len)) {
+        return false;
+    }
+    m_beg += len;
+    return true;
+}
+
+template <typename L> Token BasicLexer<L>::stray() { fatal("stray '\\' in program"); }
+
+template <typename L> Token BasicLexer<L>::prefix_or_identifier() {
+    switch (peek()) {
     case 'u':
-        if (is_quote(peek(1)) || (peek(1) == 'R' && peek(2) == '"') || (peek(1) == '8' && is_quote(peek(2))) ||
-            (peek(1) == '8' && peek(2) == 'R' && peek(3) == '"')) {
+        if (is_quote(peek(1)) || (peek(1) == '8' && (peek(2) == '"' || (L::u8_char_litterals && peek(2) == '\'')))) {
             return prefix();
         }
+        if constexpr (L::raw_strings) {
+            if ((peek(1) == 'R' && peek(2) == '"') || (peek(1) == '8' && peek(2) == 'R' && peek(3) == '"')) {
+                return prefix();
+            }
+        }
         return identifier();
     case 'U':
     case 'L':
-        if (is_quote(peek(1)) || (peek(1) == 'R' && peek(2) == '"')) {
+        if (is_quote(peek(1)) || (L::raw_strings && peek(1) == 'R' && peek(2) == '"')) {
             return prefix();
         }
         return identifier();
     case 'R':
-        if (peek(1) == '"') {
+        if (L::raw_strings && peek(1) == '"') {
             return raw_string();
         }
         return identifier();
+    default:
+        return identifier();
+    }
+}
+
+template <typename L> Token BasicLexer<L>::unknown() {
+    char32_t u;
+    size_t len;
+    if (is_utf8(peek()) && utf8_decode(m_s, m_beg, u, len)) {
+        if (is_xid_start(u)) {
+            return identifier();
+        }
+        warning("unknown character ", code_point_name(u));
+        return atom(Token::Type::Unexpected, std::string_view(m_s).substr(m_beg, len));
+    }
+
+    warning("unknown char ", peek());
+    return atom(Token::Type::Unexpected);
+}
+
+template <typename L> Token BasicLexer<L>::dfa_token() {
+    using Handler = Token (BasicLexer::*)();
+    static constexpr Handler handlers[] = {&BasicLexer::end_token, &BasicLexer::space,      &BasicLexer::newline,
+                                           &BasicLexer::stray,     &BasicLexer::prefix_or_identifier, &BasicLexer::quote,
+                                           &BasicLexer::identifier, &BasicLexer::number,    &BasicLexer::punctuator,
+                                           &BasicLexer::unknown};
+    static_assert(std::size(handlers) == static_cast<size_t>(CharClass::Count));
+    return (this->*handlers[static_cast<size_t>(char_classes[peek()])])();
+}
+
+template <typename L> Token BasicLexer<L>::lex_token() {
+    char c = peek();
+    switch (c) {
+    case '\0':
+        return atom(Token::Type::End);
+    case '\\':
+        return stray();
+    case 'u':
+    case 'U':
+    case 'L':
+    case 'R':
+        return prefix_or_identifier();
     case ' ':
     case '\f':
     case '\v':
@@ -69,38 +140,30 @@ Token Lexer::next() noexcept {
     if (special.find(c) != std::string::npos) {
         return handle_special();
     }
-
-    warning("unknown char ", c);
-    return atom(Token::Type::Unexpected);
+    return unknown();
 }
 
-Token Lexer::get_operator(Token::Type t, const std::string &lex) {
-    const std::vector<std::string> alterative{"<%",  "%>",    "<:",     ":>",     "%:",    "%:%:",   "and", "bitor", "or",
-                                              "xor", "compl", "bitand", "and_eq", "or_eq", "xor_eq", "not", "not_eq"};
-    const std::vector<std::string> real{"{", "}", "[", "]", "#", "##", "&&", "|", "||", "^", "~", "&", "&=", "|=", "^=", "!", "!="};
+template <typename L> Token BasicLexer<L>::get_operator(Token::Type t, std::string_view lex) {
+    static constexpr std::string_view alterative[]{"<%",  "%>",    "<:",     ":>",     "%:",    "%:%:",   "and", "bitor", "or",
+                                                   "xor", "compl", "bitand", "and_eq", "or_eq", "xor_eq", "not", "not_eq"};
+    static constexpr std::string_view real[]{"{", "}", "[", "]", "#", "##", "&&", "|", "||", "^", "~", "&", "&=", "|=", "^=", "!", "!="};
     Token tok(atom(t, lex));
 
-    auto it = std::find(alterative.begin(), alterative.end(), lex);
-    if (it != alterative.end()) {
-        size_t i = static_cast<size_t>(std::distance(alterative.begin(), it));
-        tok.lex(real[i]);
+    auto it = std::find(std::begin(alterative), std::end(alterative), lex);
+    if (it != std::end(alterative)) {
+        tok.lex(real[std::distance(std::begin(alterative), it)]);
     }
+    tok.punctuator(punctuator_id(tok.lex()));
     return tok;
 }
 
-static bool in_vector(const std::string &s, const std::vector<std::string> &v) { return std::find(v.begin(), v.end(), s) != v.end(); }
+template <size_t N> static bool in_array(std::string_view s, const std::string_view (&a)[N]) { return std::find(a, a + N, s) != a + N; }
 
-Token Lexer::handle_special() noexcept {
-    std::string s(1, peek());
-    if (peek(1) != '\0') {
-        s += peek(1);
-        if (peek(2) != '\0') {
-            s += peek(2);
-            s += peek(3);
-        }
-    }
+template <typename L> Token BasicLexer<L>::handle_special() {
+    ALLOC_SCOPE(AllocCategory::OperatorTable);
+    std::string_view s = std::string_view(m_s).substr(m_beg, 4);
 
-    if (peek() == '<' && peek(1) == ':' && peek(2) == ':' && peek(3) != ':' && peek(3) != '>') {
+    if (L::template_angle && peek() == '<' && peek(1) == ':' && peek(2) == ':' && peek(3) != ':' && peek(3) != '>') {
         return get_operator(Token::Type::OpOrPunctuator, s.substr(0, 1));
     }
 
@@ -108,17 +171,17 @@ Token Lexer::handle_special() noexcept {
         return get_operator(Token::Type::PreprocessingOperator, s.substr(0, 4));
     }
 
-    const std::vector<std::string> t3{"...", "->*", "<=>", "<<=", ">>="};
-    if (in_vector(s.substr(0, 3), t3)) {
+    static constexpr std::string_view t3[]{"...", "->*", "<=>", "<<=", ">>="};
+    if (in_array(s.substr(0, 3), t3) && L::has_punctuator(s.substr(0, 3))) {
         return get_operator(Token::Type::OpOrPunctuator, s.substr(0, 3));
     }
 
     if (s.substr(0, 2) == "##" || s.substr(0, 2) == "%:") {
         return get_operator(Token::Type::PreprocessingOperator, s.substr(0, 2));
     }
-    const std::vector<std::string> t2{"<:", ":>", "<%", "%>", "::", ".*", "->", "+=", "-=", "*=", "/=", "%=", "^=",
-                                      "&=", "|=", "==", "!=", "<=", ">=", "&&", "||", "<<", ">>", "++", "--"};
-    if (in_vector(s.substr(0, 2), t2)) {
+    static constexpr std::string_view t2[]{"<:", ":>", "<%", "%>", "::", ".*", "->", "+=", "-=", "*=", "/=", "%=", "^=",
+                                           "&=", "|=", "==", "!=", "<=", ">=", "&&", "||", "<<", ">>", "++", "--"};
+    if (in_array(s.substr(0, 2), t2) && L::has_punctuator(s.substr(0, 2))) {
         return get_operator(Token::Type::OpOrPunctuator, s.substr(0, 2));
     }
 
@@ -128,12 +191,55 @@ Token Lexer::handle_special() noexcept {
     return get_operator(Token::Type::OpOrPunctuator, s.substr(0, 1));
 }
 
+template <typename L> Token BasicLexer<L>::punctuator() {
+    ALLOC_SCOPE(AllocCategory::OperatorTable);
+    // "<::" is '<' then "::" unless the next character is ':' or '>'
+    if constexpr (L::template_angle) {
+        if (peek() == '<' && peek(1) == ':' && peek(2) == ':' && peek(3) != ':' && peek(3) != '>') {
+            Token t = atom(Token::Type::OpOrPunctuator);
+            t.punctuator(punctuator_id("<"));
+            return t;
+        }
+    }
+
+    // The source is nul terminated and '\0' has no transition, the walk stops at the end of the buffer
+    const char *p = m_s.data() + m_beg;
+    int16_t match = -1;
+    size_t len = 0;
+    uint8_t state = 0;
+    constexpr const PunctuatorDfa &dfa = punctuator_dfa<L>;
+    for (size_t i = 0; (state = dfa.step(state, p[i])) != 0; ++i) {
+        if (dfa.accept[state] >= 0) {
+            match = dfa.accept[state];
+            len = i + 1;
+        }
+    }
+
+    // Every punctuator character is a punctuator by itself, there is always a match
+    const Punctuator &op = punctuators[match];
+    Token t(op.type, op.canonical, m_mr);
+    t.punctuator(match);
+    m_beg += len;
+    return t;
+}
+
 static constexpr std::string_view basic_source_character("abcdefghijklmnopqrstuvwxyz"
                                                          "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
                                                          "0123456789"
                                                          "_{}[]#()<>%:;.?*+-/^&|~!=,\\\"'"
                                                          " \t\v\f\n");
 
+// One lookup instead of a search of basic_source_character for each byte of a litteral
+static constexpr auto basic_source_table = [] {
+    std::array<bool, 256> t{};
+    for (char c : basic_source_character) {
+        t[static_cast<unsigned char>(c)] = true;
+    }
+    return t;
+}();
+
+static bool is_basic_source_character(char c) noexcept { return basic_source_table[static_cast<unsigned char>(c)]; }
+
 static bool is_octal(char c) { return c >= '0' && c <= '7'; }
 
 static bool is_hexa(char c) {
@@ -141,116 +247,209 @@ static bool is_hexa(char c) {
     return hexa.find(c) != std::string::npos;
 }
 
-std::string Lexer::escape_sequence() {
-    std::string s(1, get());
-    assert(s == "\\");
-
+template <typename L> void BasicLexer<L>::escape_sequence() {
+    size_t start = m_beg;
     char c = get();
+    assert(c == '\\');
+
+    c = get();
     if (c == 'x') {
-        s += 'x';
         while (is_hexa(peek())) {
-            s += get();
+            get();
         }
-        return s;
+        return;
     }
 
-    if (c == 'u') {
-        s += 'u';
-        while (size(s) < 4 + 2 && is_hexa(peek())) {
-            s += get();
+    if (c == 'u' || c == 'U') {
+        size_t digits = c == 'u' ? 4 : 8;
+        while (m_beg - start < digits + 2 && is_hexa(peek())) {
+            get();
         }
 
-        if (size(s) != 4 + 2) {
-            fatal("incomplete universal character name ", s);
+        if (m_beg - start != digits + 2) {
+            fatal("incomplete universal character name ", since(start));
         }
-        return s;
+        return;
     }
 
-    if (c == 'U') {
-        s += 'U';
-        while (size(s) < 8 + 2 && is_hexa(peek())) {
-            s += get();
+    if (is_octal(c)) {
+        while (m_beg - start < 3 + 1 && is_octal(peek())) {
+            get();
         }
+        return;
+    }
 
-        if (size(s) != 8 + 2) {
-            fatal("incomplete universal character name ", s);
+    constexpr std::string_view simple_escape_sequence_letter("'\"?\\abfnrtv");
+    if (simple_escape_sequence_letter.find(c) != std::string::npos) {
+        return;
+    }
+    fatal("bad escape sequence");
+}
+
+static uint32_t hexa_value(char c) noexcept {
+    return static_cast<uint32_t>(is_digit(c) ? c - '0' : (c | 0x20) - 'a' + 10);
+}
+
+/**
+ * Append the UTF-8 sequence of `c` to `out`
+ */
+static void append_ucs(std::pmr::string &out, uint32_t c) {
+    if (!is_valid_ucs(c)) {
+        fatal("invalid unicode sequence");
+    }
+    char u[4];
+    out.append(u, utf8_encode(c, u));
+}
+
+/**
+ * Append the value `n` of a numeric escape sequence: the byte itself for a narrow or u8 litteral, the code point otherwise
+ */
+static void append_numeric(std::pmr::string &out, std::string_view prefix, uint32_t n) {
+    if (prefix.empty() || prefix == "u8") {
+        out += static_cast<char>(n);
+        return;
+    }
+    append_ucs(out, n);
+}
+
+template <typename L> void BasicLexer<L>::decode_escape_sequence(std::string_view prefix, std::pmr::string &out) {
+    size_t start = m_beg;
+    char c = get();
+    assert(c == '\\');
+
+    c = get();
+    uint32_t n = 0;
+    if (c == 'x') {
+        while (is_hexa(peek())) {
+            n = n * 16 + hexa_value(get()); // wraps only when there are too many digits anyway
+        }
+        if (m_beg - start == 2) {
+            fatal("\\x used with no following hex digits");
+        }
+        if (is_too_long_for_prefix(prefix, m_beg - start - 2)) {
+            fatal("hex escape sequence out of range");
+        }
+        return append_numeric(out, prefix, n);
+    }
+
+    if (c == 'u' || c == 'U') {
+        size_t digits = c == 'u' ? 4 : 8;
+        while (m_beg - start < digits + 2 && is_hexa(peek())) {
+            n = n * 16 + hexa_value(get());
+        }
+
+        if (m_beg - start != digits + 2) {
+            fatal("incomplete universal character name ", since(start));
         }
-        return s;
+        return append_ucs(out, n);
     }
 
     if (is_octal(c)) {
-        s += c;
-        while (size(s) < 3 + 1 && is_octal(peek())) {
-            s += get();
+        n = static_cast<uint32_t>(c - '0');
+        while (m_beg - start < 3 + 1 && is_octal(peek())) {
+            n = n * 8 + static_cast<uint32_t>(get() - '0');
+        }
+        if ((prefix.empty() || prefix == "u8") && n > std::numeric_limits<unsigned char>::max()) {
+            fatal("octal escape sequence out of range");
         }
-        return s;
+        return append_numeric(out, prefix, n);
     }
 
     constexpr std::string_view simple_escape_sequence_letter("'\"?\\abfnrtv");
-    auto i = simple_escape_sequence_letter.find(c);
-    if (i != std::string::npos) {
-        s += c;
-        return s;
+    constexpr std::string_view simple_escaped_sequence_letter("\'\"\?\\\a\b\f\n\r\t\v");
+    size_t id = simple_escape_sequence_letter.find(c);
+    if (id != std::string::npos) {
+        out += simple_escaped_sequence_letter[id];
+        return;
     }
     fatal("bad escape sequence");
 }
 
-Token Lexer::prefix() {
+template <typename L> Token BasicLexer<L>::prefix() {
     char c = get();
     if (c == 'u' && peek() == '8') {
         get(); // '8'
         assert(is_quote(peek()) || (peek() == 'R' && peek(1) == '"'));
 
-        Token t(Token::Type::Unexpected);
-        if (peek() == 'R') {
-            t = raw_string();
-        } else {
-            t = get_litteral();
-        }
+        // Built in place: assigning into a token of another resource would copy the lexeme
+        Token t(peek() == 'R' ? raw_string() : get_litteral("u8"));
         t.prefix("u8");
         return t;
     }
 
-    std::set<char> prefix{'u', 'U', 'L'};
-    assert(prefix.count(c) != 0);
+    constexpr std::string_view prefix("uUL");
+    assert(prefix.find(c) != std::string::npos);
 
     if (peek() == 'R') {
         assert(peek(1) == '"');
         Token t(raw_string());
-        t.prefix(std::string(1, c));
+        t.prefix(std::string_view(&c, 1));
         return t;
     }
     assert(is_quote(peek()));
 
-    Token t(get_litteral());
-    t.prefix(std::string(1, c));
+    Token t(get_litteral(std::string_view(&c, 1)));
+    t.prefix(std::string_view(&c, 1));
     return t;
 }
 
-Token Lexer::get_litteral() {
+template <typename L> Token BasicLexer<L>::get_litteral(std::string_view prefix) {
     char q = get();
     assert(is_quote(q));
-    std::string ch;
+    size_t start = m_beg;
+
+    // When decoding, the text between escape sequences is copied by runs
+    std::pmr::string decoded(m_mr);
+    size_t run = start;
+    size_t chars = 0;
 
     char c = peek();
-    while (c != q && c != '\n' && basic_source_character.find(c) != std::string::npos) {
+    while (c != q && c != '\n') {
         if (c == '\\') {
-            ch += escape_sequence();
+            if (m_decode) {
+                decoded.append(m_s, run, m_beg - run);
+                decode_escape_sequence(prefix, decoded);
+                run = m_beg;
+                ++chars;
+            } else {
+                escape_sequence();
+            }
+        } else if (is_basic_source_character(c)) {
+            get();
+            ++chars;
+        } else if (size_t before = m_beg; skip_utf8()) {
+            chars += m_beg - before; // one char per byte, as convert_escape_sequence() does
         } else {
-            ch += get();
+            break;
         }
         c = peek();
     }
+    std::string_view ch = since(start);
 
     if (get() != q) {
         fatal("Unexpected char in char|string litteral, c=`", c, "'=0x", std::hex, static_cast<int>(c));
     }
 
-    if (q == '\'') {
-        return Token(Token::Type::CharLitteral, ch);
+    Token::Type type = q == '\'' ? Token::Type::CharLitteral : Token::Type::StringLitteral;
+    if (!m_decode) {
+        return Token(type, ch, m_mr);
+    }
+
+    if (type == Token::Type::CharLitteral && chars != 1) {
+        fatal(chars == 0 ? "empty character litteral" : "multicharacter literal are not supported");
+    }
+    if (run != start) {
+        decoded.append(m_s, run, m_beg - 1 - run);
+    }
+    // Without escape sequence, the source text is the content
+    Token t(type, m_mr);
+    if (run == start) {
+        t.lex(ch);
     } else {
-        return Token(Token::Type::StringLitteral, ch);
+        t.take_lex(std::move(decoded));
     }
+    t.decoded(true);
+    return t;
 }
 
 /**
@@ -258,43 +457,37 @@ Token Lexer::get_litteral() {
  */
 static bool is_d_char(char c) {
     constexpr std::string_view except(" ()\\\t\v\f\n");
-    return basic_source_character.find(c) != std::string::npos && except.find(c) == std::string::npos;
+    return is_basic_source_character(c) && except.find(c) == std::string::npos;
 }
 
-bool Lexer::is_r_char(char c, const std::string &d) const {
-    if (basic_source_character.find(c) == std::string::npos) {
+template <typename L> bool BasicLexer<L>::is_r_char(char c, std::string_view d) const {
+    if (!is_basic_source_character(c)) {
         return false;
     }
     if (c != ')') {
         return true;
     }
 
-    std::string d2;
-    size_t i(1);
-    while (size(d2) < size(d)) {
-        d2 += peek(i);
-        ++i;
-    }
-    if (d2 != d) {
-        return true;
-    }
-    return peek(i) != '"';
+    // )d" ends the string, compared in place: no copy of the delimiter and no read past the end of the source for each ')'
+    std::string_view rest = std::string_view(m_s).substr(m_beg + 1);
+    return size(rest) <= size(d) || rest.substr(0, size(d)) != d || rest[size(d)] != '"';
 }
 
 #define D_CHAR_SIZE_MAX 16
 
-Token Lexer::raw_string() {
+template <typename L> Token BasicLexer<L>::raw_string() {
     char tmp = get();
     assert(tmp == 'R');
     tmp = get();
     assert(tmp == '"');
 
-    std::string d;
-    while (size(d) < D_CHAR_SIZE_MAX && is_d_char(peek())) {
-        d += get();
+    size_t start = m_beg;
+    while (m_beg - start <= D_CHAR_SIZE_MAX && is_d_char(peek())) {
+        get();
     }
+    std::string_view d = since(start);
 
-    if (size(d) >= D_CHAR_SIZE_MAX) {
+    if (size(d) > D_CHAR_SIZE_MAX) {
         fatal("raw string delimiter longer than ", D_CHAR_SIZE_MAX, " characters");
     }
     if (size(d) > 0 && peek() != '(') {
@@ -302,46 +495,64 @@ Token Lexer::raw_string() {
     }
     get(); // '('
 
-    std::string r;
-    while (is_r_char(peek(), d)) {
-        r += get();
+    start = m_beg;
+    for (;;) {
+        if (is_r_char(peek(), d)) {
+            get();
+        } else if (!skip_utf8()) {
+            break;
+        }
     }
+    std::string_view r = since(start);
 
     if (get() != ')') {
         fatal("raw string missing terminating parenthese or bad delimiter");
     }
 
-    std::string d2;
-    while (size(d2) < size(d)) {
-        d2 += get();
-    }
-    assert(d2 == d);
+    start = m_beg;
+    m_beg += size(d);
+    assert(since(start) == d);
     tmp = get();
     assert(tmp == '"');
 
-    Token t(Token::Type::StringLitteral, r);
+    Token t(Token::Type::StringLitteral, r, m_mr);
     t.raw(true);
+    t.decoded(m_decode); // nothing to convert in a raw string
     return t;
 }
 
-Token Lexer::identifier() noexcept {
-    std::string s;
-    while (is_identifier_char(peek())) {
-        s += get();
+template <typename L> Token BasicLexer<L>::identifier() {
+    size_t start = m_beg;
+    for (;;) {
+        char32_t c;
+        size_t len;
+        if (is_identifier_char(peek())) {
+            get();
+        } else if (is_utf8(peek()) && utf8_decode(m_s, m_beg, c, len) && is_xid_continue(c)) {
+            m_beg += len;
+        } else {
+            break;
+        }
     }
-    return Token(Token::Type::Identifier, s);
+    return Token(Token::Type::Identifier, since(start), m_mr);
 }
 
-Token Lexer::number() noexcept {
-    std::string s;
+template <typename L> Token BasicLexer<L>::number() {
+    size_t start = m_beg;
     while (is_digit(peek())) {
-        s += get();
+        get();
     }
-    return Token(Token::Type::Number, s);
+    return Token(Token::Type::Number, since(start), m_mr);
 }
 
+template class BasicLexer<C11>;
+template class BasicLexer<C17>;
+template class BasicLexer<Cxx17>;
+template class BasicLexer<Cxx20>;
+
 std::ostream &operator<<(std::ostream &os, const Token::Type &kind) {
-    const std::vector<std::string> names{"CharLitteral",          "End",   "Identifier",     "Newline",   "Number", "OpOrPunctuator",
-                                         "PreprocessingOperator", "Space", "StringLitteral", "Unexpected"};
+    static constexpr std::string_view names[]{"CharLitteral",          "End",   "Identifier",     "Newline",   "Number", "OpOrPunctuator",
+                                              "PreprocessingOperator", "Space", "StringLitteral", "Unexpected"};
+    static_assert(std::size(names) == static_cast<size_t>(Token::Type::Unexpected) + 1);
     return os << names[static_cast<size_t>(kind)];
 }
@@ -1,10 +1,19 @@
 #ifndef LEXER_HPP
 #define LEXER_HPP
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 
+#include "alloc_stats.hpp"
 #include "error.hpp"
+#include "language.hpp"
+#include "unicode.hpp"
 
 class Token {
   public:
@@ -21,45 +30,195 @@ class Token {
         Unexpected,
     };
 
-    explicit Token(Type t) noexcept : m_type{t} {}
-    Token(Type t, const std::string s) noexcept : m_type{t}, m_lex(s) {}
+    /**
+     * The lexeme and the prefix are allocated from `mr`, copies of the token use the default resource
+     */
+    explicit Token(Type t, std::pmr::memory_resource *mr = std::pmr::get_default_resource()) noexcept
+        : m_type{t}, m_lex(mr), m_prefix(mr) {}
+    Token(Type t, std::string_view s, std::pmr::memory_resource *mr = std::pmr::get_default_resource()) noexcept
+        : m_type{t}, m_lex(s, mr), m_prefix(mr) {}
 
     Type type() const noexcept { return m_type; }
     void type(Type t) noexcept { m_type = t; }
 
-    std::string lex() const noexcept { return m_lex; }
-    void lex(std::string lex) noexcept { m_lex = std::move(lex); }
+    std::string_view lex() const noexcept { return m_lex; }
+    void lex(std::string_view lex) noexcept {
+        m_lex.clear();
+        m_lex.append(lex);
+    }
+    /**
+     * Take the buffer of `lex`, no copy if it uses the resource of the token
+     */
+    void take_lex(std::pmr::string &&lex) noexcept { m_lex = std::move(lex); }
 
-    std::string prefix() const noexcept { return m_prefix; }
-    void prefix(std::string prefix) noexcept { m_prefix = std::move(prefix); }
+    std::string_view prefix() const noexcept { return m_prefix; }
+    void prefix(std::string_view prefix) noexcept {
+        m_prefix.clear();
+        m_prefix.append(prefix);
+    }
+
+    std::pmr::memory_resource *resource() const noexcept { return m_lex.get_allocator().resource(); }
 
     bool raw() const noexcept { return m_raw; }
     void raw(bool raw) noexcept { m_raw = raw; }
 
+    /**
+     * True if the escape sequences of the litteral were converted by the lexer, see Lexer::decode_litterals()
+     */
+    bool decoded() const noexcept { return m_decoded; }
+    void decoded(bool decoded) noexcept { m_decoded = decoded; }
+
+    static constexpr uint32_t no_litteral = UINT32_MAX;
+
+    /**
+     * Id of the string litteral in the LitteralPool, no_litteral if not pooled
+     */
+    uint32_t litteral_id() const noexcept { return m_litteral_id; }
+    void litteral_id(uint32_t id) noexcept { m_litteral_id = id; }
+
+    static constexpr int16_t no_punctuator = -1;
+
+    /**
+     * Index of an OpOrPunctuator or PreprocessingOperator in `punctuators` (lexer_dfa.hpp), no_punctuator otherwise
+     * Alternative spellings have the index of the token they stand for
+     */
+    int16_t punctuator() const noexcept { return m_punctuator; }
+    void punctuator(int16_t id) noexcept { m_punctuator = id; }
+
     bool is(Type t) const noexcept { return m_type == t; }
 
     template <typename... T> bool is_one_of(T... t) const noexcept { return (is(t) || ...); }
 
   private:
     Type m_type;
-    std::string m_lex;
-    std::string m_prefix = "";
+    std::pmr::string m_lex;
+    std::pmr::string m_prefix;
     bool m_raw = false;
+    bool m_decoded = false;
+    uint32_t m_litteral_id = no_litteral;
+    int16_t m_punctuator = no_punctuator;
 };
 
 std::ostream &operator<<(std::ostream &os, const Token::Type &kind);
 
-class Lexer {
+/**
+ * How the first byte of a token selects what to read
+ * Dfa: character class table, jump table and punctuator DFA, see lexer_dfa.hpp
+ * Switch: the original switch and character tests, kept as the reference for the differential tests
+ */
+enum class LexerEngine { Dfa, Switch };
+
+/**
+ * Lexer of the language `L`, a Language<> policy: the branches of the features `L` does not have are compiled out
+ * It is instantiated in lexer.cpp for C11, C17, C++17 and C++20
+ */
+template <typename L> class BasicLexer {
   public:
-    explicit Lexer(std::string s) noexcept : m_s(s) {}
+    /**
+     * Input iterator over the tokens, the End token is not part of the range
+     */
+    class iterator {
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Token;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Token *;
+        using reference = const Token &;
 
-    Token next() noexcept;
+        iterator() noexcept = default;
+        explicit iterator(BasicLexer *l) : m_lexer(l), m_tok(Token::Type::End, l->m_mr) { ++*this; }
+
+        reference operator*() const noexcept { return m_tok; }
+        pointer operator->() const noexcept { return &m_tok; }
+
+        iterator &operator++() {
+            m_tok = m_lexer->next();
+            if (m_tok.is(Token::Type::End)) {
+                m_lexer = nullptr;
+            }
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        bool operator==(const iterator &o) const noexcept { return m_lexer == o.m_lexer; }
+        bool operator!=(const iterator &o) const noexcept { return m_lexer != o.m_lexer; }
+
+      private:
+        BasicLexer *m_lexer = nullptr;
+        Token m_tok{Token::Type::End};
+    };
+
+    using Language = L;
+    using Engine = LexerEngine;
+
+    /**
+     * The source is UTF-8, it is validated here unless it is plain ASCII
+     * Tokens are allocated from `mr`, typically the Arena of the translation unit
+     */
+    explicit BasicLexer(std::string s, std::pmr::memory_resource *mr = std::pmr::get_default_resource(), Engine engine = Engine::Dfa) noexcept
+        : m_owned(std::move(s)), m_s(m_owned), m_mr(mr), m_engine(engine) {
+        STATS_COUNT(Counter::BytesRead, size(m_s));
+        if (!is_ascii(m_s)) {
+            check_encoding();
+        }
+    }
+    explicit BasicLexer(const char *s, std::pmr::memory_resource *mr = std::pmr::get_default_resource(), Engine engine = Engine::Dfa) noexcept
+        : BasicLexer(std::string(s), mr, engine) {}
+
+    /**
+     * Same, but `s` is read in place instead of being copied: it must outlive the lexer
+     * s.data()[size(s)] must be readable and be '\0', as after the content of a std::string: the lexer reads
+     * one character past the end, and the punctuator walk stops on it.
+     */
+    explicit BasicLexer(std::string_view s, std::pmr::memory_resource *mr = std::pmr::get_default_resource(), Engine engine = Engine::Dfa) noexcept
+        : m_s(s), m_mr(mr), m_engine(engine) {
+        assert(s.data()[size(s)] == '\0');
+        STATS_COUNT(Counter::BytesRead, size(m_s));
+        if (!is_ascii(m_s)) {
+            check_encoding();
+        }
+    }
+
+    // m_s may point into m_owned
+    BasicLexer(const BasicLexer &) = delete;
+    BasicLexer &operator=(const BasicLexer &) = delete;
+
+    Token next() {
+        ALLOC_SCOPE(AllocCategory::TokenLexeme);
+        Token t = m_engine == Engine::Dfa ? dfa_token() : lex_token();
+        STATS_TOKEN(static_cast<size_t>(t.type()));
+        return t;
+    }
+
+    /**
+     * Convert the escape sequences of CharLitteral and StringLitteral while reading them, instead of
+     * leaving it to convert_escape_sequence(): the lexeme is the decoded content and the token is decoded()
+     */
+    void decode_litterals(bool on) noexcept { m_decode = on; }
+
+    iterator begin() { return iterator(this); }
+    iterator end() noexcept { return iterator(); }
 
   private:
     /**
-     * Read and return an escape sequence
+     * Warn about the first invalid UTF-8 sequence of the source
+     */
+    void check_encoding() const noexcept;
+
+    /**
+     * If a well-formed non-ASCII UTF-8 sequence starts at the current position, skip it and return true
+     */
+    bool skip_utf8();
+
+    /**
+     * Read an escape sequence
      */
-    std::string escape_sequence();
+    void escape_sequence();
+
+    /**
+     * Read an escape sequence and append its UTF-8 value to `out`, checking its range for `prefix`
+     */
+    void decode_escape_sequence(std::string_view prefix, std::pmr::string &out);
 
     /**
      * Read and return a string or char with its prefix
@@ -69,39 +228,78 @@ class Lexer {
     /**
      *  Read and return a CharLitteral or a StringLitteral (not raw) with it content
      */
-    Token get_litteral();
+    Token get_litteral(std::string_view prefix = {});
 
     /**
      * https://timsong-cpp.github.io/cppwp/lex#nt:r-char
      */
-    bool is_r_char(char c, const std::string &d) const;
+    bool is_r_char(char c, std::string_view d) const;
 
     /**
      * Read and return a StringLitteral which is a raw string
      */
     Token raw_string();
-    Token identifier() noexcept;
-    Token number() noexcept;
+
+    /**
+     * Read and return the next token, next() adds the accounting
+     */
+    Token lex_token();
+
+    /**
+     * Same as lex_token(), one table lookup and one indirect call select the handler
+     */
+    Token dfa_token();
+
+    // Handlers of the tokens starting with a given character class
+    Token end_token() noexcept { return atom(Token::Type::End); }
+    Token space() noexcept { return atom(Token::Type::Space); }
+    Token newline() noexcept { return atom(Token::Type::Newline); }
+    [[noreturn]] Token stray();
+
+    /**
+     * An encoding prefix, a raw string or an identifier starting with u, U, L or R
+     */
+    Token prefix_or_identifier();
+
+    Token quote() { return get_litteral(); }
+
+    /**
+     * A non-ASCII identifier or an Unexpected token
+     */
+    Token unknown();
+
+    Token identifier();
+    Token number();
 
     /**
      * If it's an alterative token, convert it
      * https://timsong-cpp.github.io/cppwp/lex#digraph-2
      */
-    Token get_operator(Token::Type t, const std::string &lex);
+    Token get_operator(Token::Type t, std::string_view lex);
 
     /**
      * Read and return an OpOrPunctuator
      */
-    Token handle_special() noexcept;
+    Token handle_special();
+
+    /**
+     * Same as handle_special(), longest match with the punctuator DFA
+     */
+    Token punctuator();
 
-    Token atom(Token::Type t) noexcept { return atom(t, std::string(1, peek())); }
-    Token atom(Token::Type t, const std::string &lex) noexcept {
-        Token tok(t, lex);
+    Token atom(Token::Type t) noexcept { return atom(t, std::string_view(m_s.data() + m_beg, 1)); }
+    Token atom(Token::Type t, std::string_view lex) noexcept {
+        Token tok(t, lex, m_mr);
         m_beg += size(lex);
         return tok;
     }
 
-    char peek(size_t i = 0) const noexcept {
+    /**
+     * Source text from `start` to the current position
+     */
+    std::string_view since(size_t start) const noexcept { return std::string_view(m_s).substr(start, m_beg - start); }
+
+    char peek(size_t i = 0) const {
         if (m_beg + i > size(m_s)) {
             fatal("Unexpected end of file");
         }
@@ -110,7 +308,40 @@ class Lexer {
     char get() noexcept { return m_s[m_beg++]; }
 
     size_t m_beg = 0;
-    std::string m_s;
+    std::string m_owned; // empty when the source is read in place
+    std::string_view m_s;
+    std::pmr::memory_resource *m_mr;
+    Engine m_engine;
+    bool m_decode = false;
 };
 
+extern template class BasicLexer<C11>;
+extern template class BasicLexer<C17>;
+extern template class BasicLexer<Cxx17>;
+extern template class BasicLexer<Cxx20>;
+
+using Lexer = BasicLexer<Cxx20>;
+
+/**
+ * Call `f` with a lexer of `s` for `standard`, the instantiation is selected once for the whole file
+ * The lexer reads `s` in place, which lives until `f` returns and is followed by a '\0', see BasicLexer(std::string_view)
+ */
+template <typename F>
+decltype(auto) with_lexer(Standard standard, std::string_view s, std::pmr::memory_resource *mr, LexerEngine engine, F &&f) {
+    if (standard == Standard::C11) {
+        BasicLexer<C11> l(s, mr, engine);
+        return f(l);
+    }
+    if (standard == Standard::C17) {
+        BasicLexer<C17> l(s, mr, engine);
+        return f(l);
+    }
+    if (standard == Standard::Cxx17) {
+        BasicLexer<Cxx17> l(s, mr, engine);
+        return f(l);
+    }
+    BasicLexer<Cxx20> l(s, mr, engine);
+    return f(l);
+}
+
 #endif // !LEXER_HPP
@@ -0,0 +1,162 @@
+#ifndef LEXER_DFA_HPP
+#define LEXER_DFA_HPP
+
+// Tables of the table-driven lexer engine, built at compile time from the lists below
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+#include "lexer.hpp"
+
+/**
+ * Class of a byte, the first byte of a token selects its handler by class
+ */
+enum class CharClass : uint8_t {
+    End,       // '\0'
+    Space,     // ' ' '\t' '\v' '\f'
+    Newline,   // '\n'
+    Stray,     // '\\'
+    Prefix,    // 'u' 'U' 'L' 'R': encoding prefix, raw string or identifier
+    Quote,     // '\'' '"'
+    Letter,    // the other nondigits
+    Digit,     // '0'-'9'
+    Punct,     // first byte of a preprocessing-op-or-punc
+    Other,     // everything else, UTF-8 included
+    Count,
+};
+
+inline constexpr std::string_view punctuator_chars("{}[]#()<>%:;.?*+-/^&|~!=,");
+
+struct CharClassTable {
+    CharClass of[256];
+
+    constexpr CharClass operator[](char c) const noexcept { return of[static_cast<unsigned char>(c)]; }
+};
+
+constexpr CharClassTable make_char_classes() noexcept {
+    CharClassTable t{};
+    for (CharClass &c : t.of) {
+        c = CharClass::Other;
+    }
+    auto set = [&t](std::string_view chars, CharClass c) {
+        for (char ch : chars) {
+            t.of[static_cast<unsigned char>(ch)] = c;
+        }
+    };
+    set("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_", CharClass::Letter);
+    set("uULR", CharClass::Prefix);
+    set("0123456789", CharClass::Digit);
+    set(" \t\v\f", CharClass::Space);
+    set(punctuator_chars, CharClass::Punct);
+    set("'\"", CharClass::Quote);
+    t.of[0] = CharClass::End;
+    t.of[static_cast<unsigned char>('\n')] = CharClass::Newline;
+    t.of[static_cast<unsigned char>('\\')] = CharClass::Stray;
+    return t;
+}
+
+inline constexpr CharClassTable char_classes = make_char_classes();
+
+/**
+ * True for the bytes which continue an ASCII identifier
+ */
+constexpr bool is_identifier_class(CharClass c) noexcept { return c == CharClass::Letter || c == CharClass::Prefix || c == CharClass::Digit; }
+
+/**
+ * Spelling, kind and canonical spelling of every preprocessing-op-or-punc which is not an identifier
+ * https://timsong-cpp.github.io/cppwp/lex.operators
+ */
+struct Punctuator {
+    std::string_view spelling;
+    Token::Type type;
+    std::string_view canonical; // alternative tokens are replaced by the token they stand for
+};
+
+inline constexpr Punctuator punctuators[] = {
+    {"{", Token::Type::OpOrPunctuator, "{"},    {"}", Token::Type::OpOrPunctuator, "}"},    {"[", Token::Type::OpOrPunctuator, "["},
+    {"]", Token::Type::OpOrPunctuator, "]"},    {"(", Token::Type::OpOrPunctuator, "("},    {")", Token::Type::OpOrPunctuator, ")"},
+    {"<", Token::Type::OpOrPunctuator, "<"},    {">", Token::Type::OpOrPunctuator, ">"},    {"%", Token::Type::OpOrPunctuator, "%"},
+    {":", Token::Type::OpOrPunctuator, ":"},    {";", Token::Type::OpOrPunctuator, ";"},    {".", Token::Type::OpOrPunctuator, "."},
+    {"?", Token::Type::OpOrPunctuator, "?"},    {"*", Token::Type::OpOrPunctuator, "*"},    {"+", Token::Type::OpOrPunctuator, "+"},
+    {"-", Token::Type::OpOrPunctuator, "-"},    {"/", Token::Type::OpOrPunctuator, "/"},    {"^", Token::Type::OpOrPunctuator, "^"},
+    {"&", Token::Type::OpOrPunctuator, "&"},    {"|", Token::Type::OpOrPunctuator, "|"},    {"~", Token::Type::OpOrPunctuator, "~"},
+    {"!", Token::Type::OpOrPunctuator, "!"},    {"=", Token::Type::OpOrPunctuator, "="},    {",", Token::Type::OpOrPunctuator, ","},
+    {"<:", Token::Type::OpOrPunctuator, "["},   {":>", Token::Type::OpOrPunctuator, "]"},   {"<%", Token::Type::OpOrPunctuator, "{"},
+    {"%>", Token::Type::OpOrPunctuator, "}"},   {"::", Token::Type::OpOrPunctuator, "::"},  {".*", Token::Type::OpOrPunctuator, ".*"},
+    {"->", Token::Type::OpOrPunctuator, "->"},  {"+=", Token::Type::OpOrPunctuator, "+="},  {"-=", Token::Type::OpOrPunctuator, "-="},
+    {"*=", Token::Type::OpOrPunctuator, "*="},  {"/=", Token::Type::OpOrPunctuator, "/="},  {"%=", Token::Type::OpOrPunctuator, "%="},
+    {"^=", Token::Type::OpOrPunctuator, "^="},  {"&=", Token::Type::OpOrPunctuator, "&="},  {"|=", Token::Type::OpOrPunctuator, "|="},
+    {"==", Token::Type::OpOrPunctuator, "=="},  {"!=", Token::Type::OpOrPunctuator, "!="},  {"<=", Token::Type::OpOrPunctuator, "<="},
+    {">=", Token::Type::OpOrPunctuator, ">="},  {"&&", Token::Type::OpOrPunctuator, "&&"},  {"||", Token::Type::OpOrPunctuator, "||"},
+    {"<<", Token::Type::OpOrPunctuator, "<<"},  {">>", Token::Type::OpOrPunctuator, ">>"},  {"++", Token::Type::OpOrPunctuator, "++"},
+    {"--", Token::Type::OpOrPunctuator, "--"},  {"...", Token::Type::OpOrPunctuator, "..."}, {"->*", Token::Type::OpOrPunctuator, "->*"},
+    {"<=>", Token::Type::OpOrPunctuator, "<=>"}, {"<<=", Token::Type::OpOrPunctuator, "<<="}, {">>=", Token::Type::OpOrPunctuator, ">>="},
+    {"#", Token::Type::PreprocessingOperator, "#"}, {"##", Token::Type::PreprocessingOperator, "##"},
+    {"%:", Token::Type::PreprocessingOperator, "#"}, {"%:%:", Token::Type::PreprocessingOperator, "##"},
+};
+
+/**
+ * Index of `spelling` in `punctuators`, usable as a case label
+ */
+constexpr int16_t punctuator_id(std::string_view spelling) {
+    for (size_t i = 0; i < std::size(punctuators); ++i) {
+        if (punctuators[i].spelling == spelling) {
+            return static_cast<int16_t>(i);
+        }
+    }
+    throw "not a punctuator"; // compile time error in constant expressions
+}
+
+/**
+ * Trie of the punctuators as a DFA, the lexer follows it for the longest match
+ * State 0 is the start state, a transition to 0 means no transition
+ */
+struct PunctuatorDfa {
+    static constexpr size_t columns = std::size(punctuator_chars) + 1; // column 0 for every other byte
+    static constexpr size_t max_states = 64;
+
+    uint8_t column[256];
+    uint8_t next[max_states][columns];
+    int16_t accept[max_states]; // index in punctuators of the canonical spelling, -1 if the state is only a prefix
+    size_t states;
+
+    constexpr uint8_t step(uint8_t state, char c) const noexcept { return next[state][column[static_cast<unsigned char>(c)]]; }
+};
+
+/**
+ * DFA of the punctuators of the language `L`
+ */
+template <typename L> constexpr PunctuatorDfa make_punctuator_dfa() {
+    PunctuatorDfa d{};
+    for (size_t i = 0; i < std::size(punctuator_chars); ++i) {
+        d.column[static_cast<unsigned char>(punctuator_chars[i])] = static_cast<uint8_t>(i + 1);
+    }
+    for (int16_t &a : d.accept) {
+        a = -1;
+    }
+    d.states = 1;
+    for (size_t p = 0; p < std::size(punctuators); ++p) {
+        if (!L::has_punctuator(punctuators[p].spelling)) {
+            continue;
+        }
+        uint8_t s = 0;
+        for (char c : punctuators[p].spelling) {
+            uint8_t &n = d.next[s][d.column[static_cast<unsigned char>(c)]];
+            if (n == 0) {
+                if (d.states == PunctuatorDfa::max_states) {
+                    throw "too many punctuator states"; // compile time error
+                }
+                n = static_cast<uint8_t>(d.states++);
+            }
+            s = n;
+        }
+        d.accept[s] = punctuator_id(punctuators[p].canonical);
+    }
+    return d;
+}
+
+template <typename L> inline constexpr PunctuatorDfa punctuator_dfa = make_punctuator_dfa<L>();
+
+#endif // !LEXER_DFA_HPP
@@ -0,0 +1,83 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "error.hpp"
+#include "lexer.hpp"
+#include "spsc_ring.hpp"
+#include "stats.hpp"
+
+/**
+ * Lex `source` on a second thread and give each token to `consume` on the calling thread
+ * The lexer runs at most `capacity` tokens ahead of the consumer, the End token is consumed last
+ * A fatal error of the lexer is raised on the calling thread, once the tokens before it are consumed. If `consume` throws,
+ * the lexer stops and is joined before the exception leaves.
+ */
+template <typename F> void lex_pipelined(std::string source, F consume, size_t capacity = 4096) {
+    constexpr size_t batch_size = 64;
+    SpscRing<Token> ring(capacity < batch_size ? batch_size : capacity);
+    std::exception_ptr error; // of the producer, read once it is joined
+
+    std::thread producer([&ring, &error, s = std::move(source)]() mutable noexcept {
+        std::vector<Token> batch;
+        try {
+            ThrowOnFatal guard; // exiting is up to the calling thread
+            STATS_TIMER(Phase::Lex);
+            Lexer l(std::move(s));
+            batch.reserve(batch_size);
+            bool end = false;
+            while (!end) {
+                batch.push_back(l.next());
+                end = batch.back().is(Token::Type::End);
+                if (end || size(batch) == batch_size) {
+                    if (ring.closed() || !ring.push(batch.begin(), batch.end())) {
+                        break; // the consumer gave up
+                    }
+                    batch.clear();
+                }
+            }
+        } catch (...) {
+            error = std::current_exception();
+            ring.push(batch.begin(), batch.end()); // the tokens before the error
+        }
+        ring.close();
+    });
+
+    {
+        // Also on unwinding: a thread still joinable when destroyed terminates the process
+        struct Join {
+            SpscRing<Token> &ring;
+            std::thread &thread;
+            ~Join() {
+                ring.close();
+                thread.join();
+            }
+        } join{ring, producer};
+
+        std::vector<Token> batch;
+        batch.reserve(batch_size);
+        while (ring.pop(batch, batch_size) != 0) {
+            for (Token &t : batch) {
+                consume(t);
+            }
+            batch.clear();
+        }
+    }
+
+    if (error) {
+        try {
+            std::rethrow_exception(error);
+        } catch (const FatalError &e) {
+            if (throw_on_fatal != 0) {
+                throw;
+            }
+            fatal(e.what()); // as if the lexer had run on this thread
+        }
+    }
+}
+
+#endif // !PIPELINE_HPP
@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef LINUX
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "prefetch.hpp"
+#include "stats.hpp"
+
+#ifdef LINUX
+
+/**
+ * Minimal io_uring: the raw syscalls and the two mapped rings, no liburing needed
+ * Used by a single thread at a time
+ */
+class Prefetcher::Ring {
+  public:
+    static constexpr unsigned entries = 64;
+
+    /**
+     * Set up a ring, nullptr if the kernel refuses
+     */
+    static std::unique_ptr<Ring> open() {
+        io_uring_params p{};
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+        if (fd < 0) {
+            return nullptr;
+        }
+        std::unique_ptr<Ring> r(new Ring(fd));
+        if (!r->map(p)) {
+            return nullptr;
+        }
+        return r;
+    }
+
+    ~Ring() {
+        if (m_sqes) {
+            munmap(m_sqes, m_sqes_size);
+        }
+        if (m_cq_map != MAP_FAILED && m_cq_map != m_sq_map) {
+            munmap(m_cq_map, m_cq_size);
+        }
+        if (m_sq_map != MAP_FAILED) {
+            munmap(m_sq_map, m_sq_size);
+        }
+        close(m_fd);
+    }
+
+    Ring(const Ring &) = delete;
+    Ring &operator=(const Ring &) = delete;
+
+    /**
+     * True once a submission failed: completions may still be pending, the ring must not be used anymore
+     */
+    bool broken() const noexcept { return m_broken; }
+
+    /**
+     * Next free submission entry, cleared, at most `entries` between two run()
+     */
+    io_uring_sqe *sqe() noexcept {
+        unsigned i = (*m_sq_tail + m_queued++) & *m_sq_mask;
+        m_sq_array[i] = i;
+        m_sqes[i] = io_uring_sqe{};
+        return &m_sqes[i];
+    }
+
+    /**
+     * Submit the queued entries and wait for as many completions, `f` is called with each of them
+     * Return false if the kernel rejected the submission: the entries it did not take are withdrawn, and the ones it took
+     * are waited for, since their completions write into the buffers of the caller. See drained().
+     */
+    template <typename F> bool run(F f) {
+        unsigned expected = m_queued;
+        __atomic_store_n(m_sq_tail, *m_sq_tail + m_queued, __ATOMIC_RELEASE);
+        m_queued = 0;
+
+        unsigned to_submit = expected;
+        unsigned done = 0;
+        while (true) {
+            done += reap(f);
+            if (done == expected) {
+                return true;
+            }
+            long n = syscall(__NR_io_uring_enter, m_fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (n < 0 && errno != EINTR && errno != EAGAIN) {
+                break;
+            }
+            if (n > 0) {
+                to_submit -= std::min(to_submit, static_cast<unsigned>(n));
+            }
+        }
+
+        m_broken = true;
+        // Without SQPOLL the kernel only reads the submission queue in io_uring_enter(), what it left there can be taken back
+        unsigned head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+        expected -= *m_sq_tail - head;
+        __atomic_store_n(m_sq_tail, head, __ATOMIC_RELEASE);
+        while (done < expected) {
+            done += reap(f);
+            if (done == expected) {
+                break;
+            }
+            long n = syscall(__NR_io_uring_enter, m_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (n < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                m_drained = false;
+                break;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * False if a failed run() could not wait for all its completions: the kernel may still write into the buffers of its entries
+     */
+    bool drained() const noexcept { return m_drained; }
+
+  private:
+    explicit Ring(int fd) noexcept : m_fd(fd) {}
+
+    /**
+     * Call `f` with the completions available, return their number
+     */
+    template <typename F> unsigned reap(F &f) {
+        unsigned head = *m_cq_head;
+        unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+        unsigned n = tail - head;
+        for (; head != tail; ++head) {
+            f(m_cqes[head & *m_cq_mask]);
+        }
+        __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+        return n;
+    }
+
+    template <typename T> static T *at(void *map, unsigned offset) noexcept { return static_cast<T *>(static_cast<void *>(static_cast<char *>(map) + offset)); }
+
+    bool map(const io_uring_params &p) {
+        m_sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        m_cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+        }
+
+        m_sq_map = mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        if (m_sq_map == MAP_FAILED) {
+            return false;
+        }
+        m_cq_map = single ? m_sq_map : mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        if (m_cq_map == MAP_FAILED) {
+            return false;
+        }
+        m_sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+        m_sqes = static_cast<io_uring_sqe *>(sqes);
+
+        m_sq_head = at<unsigned>(m_sq_map, p.sq_off.head);
+        m_sq_tail = at<unsigned>(m_sq_map, p.sq_off.tail);
+        m_sq_mask = at<unsigned>(m_sq_map, p.sq_off.ring_mask);
+        m_sq_array = at<unsigned>(m_sq_map, p.sq_off.array);
+        m_cq_head = at<unsigned>(m_cq_map, p.cq_off.head);
+        m_cq_tail = at<unsigned>(m_cq_map, p.cq_off.tail);
+        m_cq_mask = at<unsigned>(m_cq_map, p.cq_off.ring_mask);
+        m_cqes = at<io_uring_cqe>(m_cq_map, p.cq_off.cqes);
+        return true;
+    }
+
+    int m_fd;
+    void *m_sq_map = MAP_FAILED;
+    void *m_cq_map = MAP_FAILED;
+    io_uring_sqe *m_sqes = nullptr;
+    size_t m_sq_size = 0;
+    size_t m_cq_size = 0;
+    size_t m_sqes_size = 0;
+
+    unsigned *m_sq_head = nullptr;
+    unsigned *m_sq_tail = nullptr;
+    unsigned *m_sq_mask = nullptr;
+    unsigned *m_sq_array = nullptr;
+    unsigned *m_cq_head = nullptr;
+    unsigned *m_cq_tail = nullptr;
+    unsigned *m_cq_mask = nullptr;
+    io_uring_cqe *m_cqes = nullptr;
+    unsigned m_queued = 0;
+    bool m_broken = false;
+    bool m_drained = true;
+};
+
+namespace {
+
+/**
+ * One file of an io_uring batch
+ */
+struct Pending {
+    std::string path; // a copy, the kernel reads it until the open and statx complete
+    int fd = -1;
+    struct statx stx {};
+    bool stat_ok = false;
+    std::string text;
+    size_t done = 0;
+    bool failed = false;
+};
+
+} // namespace
+
+/**
+ * Three rounds per batch: open and statx every file, read them all until complete, then close
+ * Any file the ring cannot handle is read again the blocking way, so a batch never loses a file
+ */
+void Prefetcher::read_batch(const std::vector<std::string> &paths) {
+    STATS_TIMER(Phase::Read);
+    // Two entries per file in the first round
+    for (size_t first = 0; first < size(paths); first += Ring::entries / 2) {
+        size_t n = std::min<size_t>(Ring::entries / 2, size(paths) - first);
+        if (m_ring->broken()) {
+            for (size_t i = 0; i < n; ++i) {
+                m_cache.read(paths[first + i]);
+            }
+            continue;
+        }
+        std::vector<Pending> files(n);
+
+        for (size_t i = 0; i < n; ++i) {
+            Pending &p = files[i];
+            p.path = paths[first + i];
+
+            io_uring_sqe *open_op = m_ring->sqe();
+            open_op->opcode = IORING_OP_OPENAT;
+            open_op->fd = AT_FDCWD;
+            open_op->addr = reinterpret_cast<uintptr_t>(p.path.c_str());
+            open_op->open_flags = O_RDONLY | O_CLOEXEC;
+            open_op->user_data = 2 * i;
+
+            io_uring_sqe *statx_op = m_ring->sqe();
+            statx_op->opcode = IORING_OP_STATX;
+            statx_op->fd = AT_FDCWD;
+            statx_op->addr = reinterpret_cast<uintptr_t>(p.path.c_str());
+            statx_op->len = STATX_INO | STATX_SIZE | STATX_MTIME | STATX_TYPE;
+            statx_op->off = reinterpret_cast<uintptr_t>(&p.stx);
+            statx_op->user_data = 2 * i + 1;
+        }
+        bool ok = m_ring->run([&files](const io_uring_cqe &c) noexcept {
+            Pending &p = files[c.user_data / 2];
+            if (c.user_data % 2 == 0) {
+                p.fd = c.res;
+            } else {
+                p.stat_ok = c.res == 0;
+            }
+        });
+
+        for (Pending &p : files) {
+            if (p.fd < 0 || !p.stat_ok || !S_ISREG(p.stx.stx_mode)) {
+                p.failed = true;
+            } else {
+                p.text.resize(p.stx.stx_size);
+            }
+        }
+
+        // Short reads are resubmitted for the remaining bytes until every file is complete
+        for (bool reading = ok; reading;) {
+            reading = false;
+            for (size_t i = 0; i < n; ++i) {
+                Pending &p = files[i];
+                if (p.failed || p.done == size(p.text)) {
+                    continue;
+                }
+                io_uring_sqe *read_op = m_ring->sqe();
+                read_op->opcode = IORING_OP_READ;
+                read_op->fd = p.fd;
+                read_op->addr = reinterpret_cast<uintptr_t>(p.text.data() + p.done);
+                read_op->len = static_cast<uint32_t>(std::min<size_t>(size(p.text) - p.done, 1u << 30));
+                read_op->off = p.done;
+                read_op->user_data = i;
+                reading = true;
+            }
+            if (reading && !m_ring->run([&files](const io_uring_cqe &c) noexcept {
+                    Pending &p = files[c.user_data];
+                    if (c.res < 0) {
+                        p.failed = true;
+                    } else if (c.res == 0) {
+                        p.text.resize(p.done); // truncated since statx
+                    } else {
+                        p.done += static_cast<size_t>(c.res);
+                    }
+                })) {
+                ok = false;
+                break;
+            }
+        }
+
+        for (Pending &p : files) {
+            if (p.fd >= 0) {
+                close(p.fd);
+            }
+            if (!ok || p.failed) {
+                m_cache.read(p.path);
+                continue;
+            }
+            FileCache::Stamp s;
+            s.inode = p.stx.stx_ino;
+            s.size = p.stx.stx_size;
+            s.mtime_ns = p.stx.stx_mtime.tv_sec * int64_t{1000000000} + p.stx.stx_mtime.tv_nsec;
+            STATS_COUNT(Counter::BytesRead, size(p.text));
+            m_cache.insert(p.path, std::move(p.text), s);
+        }
+        if (!m_ring->drained()) {
+            // Entries still in flight may write into the paths, statx and buffers of the batch: it is never freed, and the
+            // fds of the opens which complete late are lost
+            static_cast<void>(new std::vector<Pending>(std::move(files)));
+        }
+    }
+}
+
+#else
+
+class Prefetcher::Ring {
+  public:
+    static std::unique_ptr<Ring> open() { return nullptr; }
+};
+
+void Prefetcher::read_batch(const std::vector<std::string> &paths) {
+    for (const std::string &p : paths) {
+        m_cache.read(p);
+    }
+}
+
+#endif
+
+Prefetcher::Prefetcher(FileCache &cache, unsigned threads, bool io_uring)
+    : m_cache(cache), m_ring(io_uring ? Ring::open() : nullptr), m_pool(m_ring ? 1 : std::max(threads, 1u)) {}
+
+Prefetcher::~Prefetcher() { m_pool.wait(); }
+
+void Prefetcher::prefetch(const std::vector<std::string> &paths) {
+    std::vector<std::string> batch;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const std::string &p : paths) {
+            if (m_seen.insert(p).second && !m_cache.find(p)) {
+                batch.push_back(p);
+            }
+        }
+    }
+    if (batch.empty()) {
+        return;
+    }
+
+    if (m_ring) {
+        // One I/O thread owns the ring, batches queue up behind each other
+        m_pool.submit([this, batch = std::move(batch)]() noexcept { read_batch(batch); });
+    } else {
+        for (std::string &p : batch) {
+            m_pool.submit([this, p = std::move(p)]() noexcept { m_cache.read(p); });
+        }
+    }
+}
+
+std::vector<std::string> quoted_includes(std::string_view source, const std::string &dir) {
+    std::vector<std::string> files;
+    size_t pos = 0;
+    while (pos < size(source)) {
+        size_t eol = source.find('\n', pos);
+        std::string_view line = source.substr(pos, eol == std::string_view::npos ? std::string_view::npos : eol - pos);
+        pos = eol == std::string_view::npos ? size(source) : eol + 1;
+
+        size_t i = line.find_first_not_of(" \t");
+        if (i == std::string_view::npos || line[i] != '#') {
+            continue;
+        }
+        i = line.find_first_not_of(" \t", i + 1);
+        if (i == std::string_view::npos || line.compare(i, 7, "include") != 0) {
+            continue;
+        }
+        i = line.find_first_not_of(" \t", i + 7);
+        if (i == std::string_view::npos || line[i] != '"') {
+            continue;
+        }
+        size_t end = line.find('"', i + 1);
+        if (end == std::string_view::npos || end == i + 1) {
+            continue;
+        }
+        std::string_view name = line.substr(i + 1, end - i - 1);
+        files.push_back(name[0] == '/' || dir.empty() ? std::string(name) : dir + '/' + std::string(name));
+    }
+    return files;
+}
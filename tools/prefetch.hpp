@@ -0,0 +1,67 @@
+#ifndef PREFETCH_HPP
+#define PREFETCH_HPP
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "file_cache.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * Read files ahead of their use into a FileCache, so that the workers find them there instead of blocking on the disk
+ *
+ * With io_uring the opens, statx and reads of a whole batch are submitted at once from a single I/O thread.
+ * Where io_uring is not available (old kernel, seccomp, not Linux) each file is a blocking read on a small thread pool.
+ */
+class Prefetcher {
+  public:
+    enum class Backend { IoUring, Threads };
+
+    /**
+     * `threads` is the size of the fallback pool, `io_uring` false forces the fallback
+     */
+    explicit Prefetcher(FileCache &cache, unsigned threads = 4, bool io_uring = true);
+
+    /**
+     * Wait for the reads in flight
+     */
+    ~Prefetcher();
+
+    Prefetcher(const Prefetcher &) = delete;
+    Prefetcher &operator=(const Prefetcher &) = delete;
+
+    Backend backend() const noexcept { return m_ring ? Backend::IoUring : Backend::Threads; }
+
+    /**
+     * Queue the reads of `paths` and return, every path is read at most once per Prefetcher
+     */
+    void prefetch(const std::vector<std::string> &paths);
+
+    /**
+     * Block until every queued file is in the cache or known to be unreadable
+     */
+    void wait() { m_pool.wait(); }
+
+  private:
+    class Ring;
+
+    void read_batch(const std::vector<std::string> &paths);
+
+    FileCache &m_cache;
+    std::unique_ptr<Ring> m_ring;
+    std::mutex m_mutex;
+    std::unordered_set<std::string> m_seen;
+    ThreadPool m_pool;
+};
+
+/**
+ * Files named by the `#include "..."` directives of `source`, relative to `dir`
+ * A quick scan of the directive lines, used to guess what the preprocessor will ask for next
+ */
+std::vector<std::string> quoted_includes(std::string_view source, const std::string &dir);
+
+#endif // !PREFETCH_HPP
@@ -0,0 +1,129 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <thread>
+#include <vector>
+
+/**
+ * Bounded lock-free ring for exactly one producer thread and one consumer thread
+ * Both sides move items in batches: one acquire to see the other side, one release to publish
+ */
+template <typename T> class SpscRing {
+  public:
+    /**
+     * `capacity` is rounded up to a power of two, it bounds the memory held by the ring
+     */
+    explicit SpscRing(size_t capacity) : m_slots(round_up(capacity)), m_mask(m_slots.size() - 1) {}
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    size_t capacity() const noexcept { return m_slots.size(); }
+
+    /**
+     * Producer side: move as many items of [first, last) as there is room for, return the count
+     */
+    template <typename It> size_t try_push(It first, It last) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t room = capacity() - (head - m_tail_cache);
+        if (room < static_cast<size_t>(last - first)) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            room = capacity() - (head - m_tail_cache);
+        }
+
+        size_t n = 0;
+        for (; first != last && n < room; ++first, ++n) {
+            m_slots[(head + n) & m_mask].emplace(std::move(*first));
+        }
+        m_head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    /**
+     * Producer side: block until every item of [first, last) is in the ring
+     * Return false if the ring is closed while full: the consumer gave up, see close()
+     */
+    template <typename It> bool push(It first, It last) {
+        while (first != last) {
+            size_t n = try_push(first, last);
+            if (n == 0) {
+                if (m_closed.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                std::this_thread::yield(); // full, wait for the consumer
+            }
+            first += static_cast<typename std::iterator_traits<It>::difference_type>(n);
+        }
+        return true;
+    }
+
+    bool push(T v) { return push(&v, &v + 1); }
+
+    /**
+     * Producer side: no more items will be pushed
+     * Consumer side: no more items will be popped, a producer blocked in push() returns
+     */
+    void close() noexcept { m_closed.store(true, std::memory_order_release); }
+    bool closed() const noexcept { return m_closed.load(std::memory_order_acquire); }
+
+    /**
+     * Consumer side: append up to `max` items to `out`, return the count
+     */
+    size_t try_pop(std::vector<T> &out, size_t max) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (m_head_cache - tail < max) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+        }
+
+        size_t n = std::min(max, m_head_cache - tail);
+        for (size_t i = 0; i < n; ++i) {
+            std::optional<T> &slot = m_slots[(tail + i) & m_mask];
+            out.push_back(std::move(*slot));
+            slot.reset();
+        }
+        m_tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    /**
+     * Consumer side: block until at least one item is available
+     * Return 0 only once the producer has closed the ring and it is drained
+     */
+    size_t pop(std::vector<T> &out, size_t max) {
+        for (;;) {
+            // Read the flag first: items pushed before close() are then visible to try_pop
+            bool closed = m_closed.load(std::memory_order_acquire);
+            size_t n = try_pop(out, max);
+            if (n != 0 || closed) {
+                return n;
+            }
+            std::this_thread::yield(); // empty, wait for the producer
+        }
+    }
+
+  private:
+    static size_t round_up(size_t n) noexcept {
+        size_t p = 1;
+        while (p < n) {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    std::vector<std::optional<T>> m_slots;
+    const size_t m_mask;
+
+    // Each side owns one cache line: its index and its cached copy of the other index
+    alignas(64) std::atomic<size_t> m_head{0};
+    size_t m_tail_cache = 0;
+    alignas(64) std::atomic<size_t> m_tail{0};
+    size_t m_head_cache = 0;
+    alignas(64) std::atomic<bool> m_closed{false};
+};
+
+#endif // !SPSC_RING_HPP
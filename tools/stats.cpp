@@ -0,0 +1,113 @@
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <string_view>
+
+#include "lexer.hpp"
+#include "stats.hpp"
+
+static constexpr std::string_view counter_names[] = {"bytes read", "diagnostics"};
+
+static_assert(std::size(phase_names) == static_cast<size_t>(Phase::Count));
+static_assert(std::size(counter_names) == static_cast<size_t>(Counter::Count));
+static_assert(static_cast<size_t>(Token::Type::Unexpected) < Stats::token_kinds);
+
+/**
+ * Small id of the calling thread, stable for its lifetime, used as trace tid
+ */
+static size_t thread_index() noexcept {
+    static std::atomic<size_t> next{0};
+    thread_local size_t i = next.fetch_add(1, std::memory_order_relaxed);
+    return i;
+}
+
+uint64_t Stats::total_locked(size_t slot) const noexcept {
+    uint64_t n = m_retired.slots[slot].load(std::memory_order_relaxed);
+    for (const Local *l : m_locals) {
+        n += l->slots[slot].load(std::memory_order_relaxed);
+    }
+    return n;
+}
+
+uint64_t Stats::total(size_t slot) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return total_locked(slot);
+}
+
+Stats::Time Stats::time(Phase p) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t i = time_slot(p);
+    return Time{total_locked(i), total_locked(i + 1), total_locked(i + 2)};
+}
+
+void Stats::record(Phase p, uint64_t start_ns, uint64_t wall_ns, uint64_t cpu_ns) {
+    Local &l = local();
+    size_t i = time_slot(p);
+    add(l.slots[i], wall_ns);
+    add(l.slots[i + 1], cpu_ns);
+    add(l.slots[i + 2], 1);
+    if (m_tracing.load(std::memory_order_relaxed)) {
+        size_t tid = thread_index();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_events.push_back(Event{p, start_ns, wall_ns, tid});
+    }
+}
+
+static double ms(uint64_t ns) noexcept { return static_cast<double>(ns) / 1e6; }
+
+void Stats::print_table(std::ostream &os) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    os << std::left << std::setw(28) << "phase" << std::right << std::setw(12) << "wall (ms)" << std::setw(12) << "cpu (ms)"
+       << std::setw(10) << "calls" << '\n';
+    os << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < std::size(phase_names); ++i) {
+        size_t t = time_slot(static_cast<Phase>(i));
+        os << std::left << std::setw(28) << phase_names[i] << std::right << std::setw(12) << ms(total_locked(t)) << std::setw(12)
+           << ms(total_locked(t + 1)) << std::setw(10) << total_locked(t + 2) << '\n';
+    }
+
+    os << '\n' << std::left << std::setw(28) << "counter" << std::right << std::setw(12) << "value" << '\n';
+    for (size_t i = 0; i < std::size(counter_names); ++i) {
+        os << std::left << std::setw(28) << counter_names[i] << std::right << std::setw(12) << total_locked(counter_slot(static_cast<Counter>(i)))
+           << '\n';
+    }
+    for (size_t k = 0; k <= static_cast<size_t>(Token::Type::Unexpected); ++k) {
+        std::ostringstream name;
+        name << "tokens " << static_cast<Token::Type>(k);
+        os << std::left << std::setw(28) << name.str() << std::right << std::setw(12) << total_locked(token_slot(k)) << '\n';
+    }
+}
+
+void Stats::write_trace(std::ostream &os) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    os << "{\"traceEvents\":[";
+    const char *sep = "";
+    for (const Event &e : m_events) {
+        // Complete events, timestamps in microseconds since the last reset
+        uint64_t ts = e.start_ns > m_origin ? e.start_ns - m_origin : 0;
+        os << sep << "{\"name\":\"" << phase_names[index(e.phase)] << "\",\"cat\":\"xcomp\",\"ph\":\"X\",\"ts\":" << ts / 1000
+           << ",\"dur\":" << e.wall_ns / 1000 << ",\"pid\":1,\"tid\":" << e.thread << '}';
+        sep = ",";
+    }
+    os << "],\"otherData\":{";
+    sep = "";
+    for (size_t i = 0; i < std::size(counter_names); ++i) {
+        os << sep << '"' << counter_names[i] << "\":" << total_locked(counter_slot(static_cast<Counter>(i)));
+        sep = ",";
+    }
+    os << "}}\n";
+}
+
+void Stats::reset() noexcept {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (std::atomic<uint64_t> &slot : m_retired.slots) {
+        slot.store(0, std::memory_order_relaxed);
+    }
+    for (Local *l : m_locals) {
+        for (std::atomic<uint64_t> &slot : l->slots) {
+            slot.store(0, std::memory_order_relaxed);
+        }
+    }
+    m_events.clear();
+    m_origin = now_ns();
+}
@@ -0,0 +1,201 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+/**
+ * Compile-time switch of the instrumentation, see the XCOMP_STATS CMake option
+ * With 0 the STATS_* hooks compile to nothing, the Stats API stays available
+ */
+#ifndef XCOMP_STATS
+#define XCOMP_STATS 1
+#endif
+
+enum class Phase { Read, Lex, Escape, Preprocess, Parse, Emit, Count };
+
+inline constexpr std::string_view phase_names[] = {"read", "lex", "escape", "preprocess", "parse", "emit"};
+
+constexpr std::string_view phase_name(Phase p) noexcept { return p == Phase::Count ? "none" : phase_names[static_cast<size_t>(p)]; }
+
+/**
+ * Innermost timed phase of the calling thread, Phase::Count outside of any
+ */
+inline thread_local Phase current_phase = Phase::Count;
+
+enum class Counter { BytesRead, Diagnostics, Count };
+
+/**
+ * Process wide timers and counters, in the spirit of gcc -ftime-report
+ * Each thread counts in its own slots without lock nor shared cache line, the readers add up the slots of every thread.
+ * Timed scopes are kept for write_trace() only while tracing is on, see trace().
+ */
+class Stats {
+  public:
+    static constexpr size_t token_kinds = 16;
+
+    static Stats &instance() noexcept {
+        static Stats s;
+        return s;
+    }
+
+    Stats(const Stats &) = delete;
+    Stats &operator=(const Stats &) = delete;
+
+    void count(Counter c, uint64_t n = 1) noexcept { add(local().slots[counter_slot(c)], n); }
+    void count_token(size_t kind) noexcept { add(local().slots[token_slot(kind)], 1); }
+
+    uint64_t counter(Counter c) const { return total(counter_slot(c)); }
+    uint64_t tokens(size_t kind) const { return total(token_slot(kind)); }
+
+    struct Time {
+        uint64_t wall_ns = 0;
+        uint64_t cpu_ns = 0;
+        uint64_t calls = 0;
+    };
+    Time time(Phase p) const;
+
+    /**
+     * Account one scope of `p` which started at `start_ns` on the steady clock
+     */
+    void record(Phase p, uint64_t start_ns, uint64_t wall_ns, uint64_t cpu_ns);
+
+    /**
+     * Keep the timed scopes from now on for write_trace(), off by default
+     */
+    void trace(bool on) noexcept { m_tracing.store(on, std::memory_order_relaxed); }
+
+    /**
+     * Print a -ftime-report like table: phases, then counters, then tokens per kind
+     */
+    void print_table(std::ostream &os) const;
+
+    /**
+     * Write every timed scope as Chrome trace_event JSON, to be opened in chrome://tracing or Perfetto
+     */
+    void write_trace(std::ostream &os) const;
+
+    void reset() noexcept;
+
+    static uint64_t now_ns() noexcept {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    /**
+     * CPU time of the calling thread
+     */
+    static uint64_t cpu_ns() noexcept {
+        timespec ts{};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+  private:
+    Stats() noexcept : m_origin(now_ns()) {}
+
+    static constexpr size_t index(Counter c) noexcept { return static_cast<size_t>(c); }
+    static constexpr size_t index(Phase p) noexcept { return static_cast<size_t>(p); }
+
+    // Slots: the counters, the tokens per kind, then wall time, CPU time and calls of each phase
+    static constexpr size_t counter_slot(Counter c) noexcept { return index(c); }
+    static constexpr size_t token_slot(size_t kind) noexcept { return index(Counter::Count) + kind; }
+    static constexpr size_t time_slot(Phase p) noexcept { return index(Counter::Count) + token_kinds + 3 * index(p); }
+    static constexpr size_t slot_count = static_cast<size_t>(Counter::Count) + token_kinds + 3 * static_cast<size_t>(Phase::Count);
+
+    struct Slots {
+        std::atomic<uint64_t> slots[slot_count] = {};
+    };
+
+    /**
+     * Slots of one thread, registered while the thread lives then added to m_retired
+     */
+    struct Local : Slots {
+        Local() {
+            Stats &s = instance();
+            std::lock_guard<std::mutex> lock(s.m_mutex);
+            s.m_locals.push_back(this);
+        }
+        ~Local() {
+            Stats &s = instance();
+            std::lock_guard<std::mutex> lock(s.m_mutex);
+            for (size_t i = 0; i < slot_count; ++i) {
+                add(s.m_retired.slots[i], slots[i].load(std::memory_order_relaxed));
+            }
+            s.m_locals.erase(std::find(s.m_locals.begin(), s.m_locals.end(), this));
+        }
+        Local(const Local &) = delete;
+        Local &operator=(const Local &) = delete;
+    };
+
+    static Local &local() noexcept {
+        thread_local Local l;
+        return l;
+    }
+
+    /**
+     * Only the owning thread writes its slots: a plain add, atomic so that the readers see whole values
+     */
+    static void add(std::atomic<uint64_t> &slot, uint64_t n) noexcept { slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+    uint64_t total(size_t slot) const;
+    uint64_t total_locked(size_t slot) const noexcept;
+
+    struct Event {
+        Phase phase;
+        uint64_t start_ns;
+        uint64_t wall_ns;
+        size_t thread;
+    };
+
+    mutable std::mutex m_mutex;
+    std::vector<Local *> m_locals;
+    Slots m_retired; // of the threads which exited
+    std::atomic<bool> m_tracing{false};
+    std::vector<Event> m_events;
+    uint64_t m_origin;
+};
+
+/**
+ * Time the enclosing scope as phase `p`
+ */
+class ScopedTimer {
+  public:
+    explicit ScopedTimer(Phase p) noexcept : m_phase(p), m_outer(current_phase), m_wall(Stats::now_ns()), m_cpu(Stats::cpu_ns()) {
+        current_phase = p;
+    }
+    ~ScopedTimer() {
+        Stats::instance().record(m_phase, m_wall, Stats::now_ns() - m_wall, Stats::cpu_ns() - m_cpu);
+        current_phase = m_outer;
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+  private:
+    Phase m_phase;
+    Phase m_outer;
+    uint64_t m_wall;
+    uint64_t m_cpu;
+};
+
+#define STATS_CONCAT_(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT_(a, b)
+
+#if XCOMP_STATS
+#define STATS_TIMER(phase) ScopedTimer STATS_CONCAT(stats_timer_, __LINE__)(phase)
+#define STATS_COUNT(counter, n) Stats::instance().count(counter, n)
+#define STATS_TOKEN(kind) Stats::instance().count_token(kind)
+#else
+#define STATS_TIMER(phase) static_cast<void>(0)
+#define STATS_COUNT(counter, n) static_cast<void>(0)
+#define STATS_TOKEN(kind) static_cast<void>(0)
+#endif
+
+#endif // !STATS_HPP
@@ -0,0 +1,100 @@
+#include <algorithm>
+
+#include "thread_pool.hpp"
+
+// Pool and index of the worker running on this thread, if any
+static thread_local const ThreadPool *current_pool = nullptr;
+static thread_local size_t current_worker = 0;
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        m_threads.emplace_back([this, i]() { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_work.notify_all();
+    for (std::thread &t : m_threads) {
+        t.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> f) {
+    size_t q = current_pool == this ? current_worker : m_next.fetch_add(1, std::memory_order_relaxed) % size();
+    {
+        // Counted first, so a worker never sees a task which is not accounted for yet
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_queued;
+        ++m_pending;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+        m_queues[q]->tasks.push_back(std::move(f));
+    }
+    m_work.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return m_pending == 0; });
+}
+
+bool ThreadPool::pop(size_t self, std::function<void()> &f) {
+    {
+        Queue &q = *m_queues[self];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            f = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < size(); ++i) {
+        Queue &q = *m_queues[(self + i) % size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            f = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(size_t self) {
+    current_pool = this;
+    current_worker = self;
+    std::function<void()> f;
+    for (;;) {
+        if (pop(self, f)) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_queued;
+            }
+            f();
+            f = nullptr;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_pending == 0) {
+                m_idle.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_work.wait(lock, [this]() { return m_stop || m_queued != 0; });
+        if (m_stop && m_queued == 0) {
+            return;
+        }
+    }
+}
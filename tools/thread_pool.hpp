@@ -0,0 +1,71 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of workers, each with its own task deque
+ * A worker takes its newest task first and, when it runs dry, steals the oldest task of another worker
+ * Tasks must not throw
+ */
+class ThreadPool {
+  public:
+    /**
+     * `threads` workers, 0 for one per hardware thread
+     */
+    explicit ThreadPool(unsigned threads = 0);
+
+    /**
+     * Wait for every task, then join the workers
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t size() const noexcept { return m_threads.size(); }
+
+    /**
+     * Queue `f` on the calling worker, or on the next worker in turn when called from outside the pool
+     */
+    void submit(std::function<void()> f);
+
+    /**
+     * Block until every submitted task, including the ones they submitted, has finished
+     */
+    void wait();
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(size_t self);
+
+    /**
+     * Take a task from the back of queue `self` or from the front of another queue
+     */
+    bool pop(size_t self, std::function<void()> &f);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<size_t> m_next{0};
+
+    std::mutex m_mutex;
+    std::condition_variable m_work;
+    std::condition_variable m_idle;
+    size_t m_queued = 0;  // in a queue, guarded by m_mutex
+    size_t m_pending = 0; // submitted and not finished, guarded by m_mutex
+    bool m_stop = false;
+};
+
+#endif // !THREAD_POOL_HPP
@@ -0,0 +1,61 @@
+#ifndef TOKEN_STREAM_HPP
+#define TOKEN_STREAM_HPP
+
+#include <array>
+#include <cassert>
+#include <optional>
+
+#include "lexer.hpp"
+
+/**
+ * Lex on demand with up to N tokens of lookahead, from a BasicLexer of any language
+ * Only the lookahead window is kept in memory, whatever the size of the file
+ */
+template <typename L, size_t N = 4> class TokenStream {
+  public:
+    explicit TokenStream(L &l) noexcept : m_lexer(l) {}
+
+    /**
+     * Return the k-th token after the current one without consuming it
+     * Past the end of the file, End is returned
+     */
+    const Token &peek(size_t k = 0) {
+        assert(k < N);
+        while (m_size <= k) {
+            fill();
+        }
+        return *m_buf[(m_head + k) % N];
+    }
+
+    /**
+     * Consume and return the current token
+     */
+    Token get() {
+        peek();
+        Token t = std::move(*m_buf[m_head]);
+        m_buf[m_head].reset();
+        m_head = (m_head + 1) % N;
+        --m_size;
+        return t;
+    }
+
+  private:
+    void fill() {
+        std::optional<Token> &slot = m_buf[(m_head + m_size) % N];
+        if (m_end) {
+            slot.emplace(Token::Type::End);
+        } else {
+            slot.emplace(m_lexer.next());
+            m_end = slot->is(Token::Type::End);
+        }
+        ++m_size;
+    }
+
+    L &m_lexer;
+    std::array<std::optional<Token>, N> m_buf;
+    size_t m_head = 0;
+    size_t m_size = 0;
+    bool m_end = false;
+};
+
+#endif // !TOKEN_STREAM_HPP
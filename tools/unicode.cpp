@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "unicode.hpp"
+#include "unicode_tables.hpp"
+
+/**
+ * Return the size of the leading ASCII run of `s`
+ * 16 bytes are checked at once with SSE2, 8 bytes otherwise
+ */
+static size_t ascii_prefix(std::string_view s) noexcept {
+    const char *p = s.data();
+    size_t n = size(s);
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= n; i += 16) {
+        __m128i v;
+        std::memcpy(&v, p + i, sizeof(v)); // unaligned load
+        if (_mm_movemask_epi8(v) != 0) {
+            break;
+        }
+    }
+#endif
+    for (; i + 8 <= n; i += 8) {
+        uint64_t v;
+        std::memcpy(&v, p + i, sizeof(v));
+        if ((v & 0x8080808080808080) != 0) {
+            break;
+        }
+    }
+    while (i < n && static_cast<unsigned char>(p[i]) < 0x80) {
+        ++i;
+    }
+    return i;
+}
+
+bool is_ascii(std::string_view s) noexcept { return ascii_prefix(s) == size(s); }
+
+bool utf8_decode(std::string_view s, size_t i, char32_t &c, size_t &len) noexcept {
+    len = 0;
+    auto byte = [&s](size_t j) { return j < size(s) ? static_cast<unsigned char>(s[j]) : 0u; };
+    unsigned b0 = byte(i);
+
+    size_t n;
+    unsigned lo = 0x80; // bounds of the second byte, table 3-7
+    unsigned hi = 0xBF;
+    if (b0 < 0x80) {
+        c = b0;
+        len = 1;
+        return true;
+    } else if (b0 >= 0xC2 && b0 <= 0xDF) {
+        n = 2;
+        c = b0 & 0x1F;
+    } else if (b0 >= 0xE0 && b0 <= 0xEF) {
+        n = 3;
+        c = b0 & 0x0F;
+        lo = b0 == 0xE0 ? 0xA0 : 0x80;
+        hi = b0 == 0xED ? 0x9F : 0xBF;
+    } else if (b0 >= 0xF0 && b0 <= 0xF4) {
+        n = 4;
+        c = b0 & 0x07;
+        lo = b0 == 0xF0 ? 0x90 : 0x80;
+        hi = b0 == 0xF4 ? 0x8F : 0xBF;
+    } else {
+        return false;
+    }
+
+    for (size_t k = 1; k < n; ++k) {
+        unsigned b = byte(i + k);
+        if (k == 1 ? (b < lo || b > hi) : (b < 0x80 || b > 0xBF)) {
+            return false;
+        }
+        c = (c << 6) | (b & 0x3F);
+    }
+    len = n;
+    return true;
+}
+
+size_t utf8_encode(char32_t c, char (&out)[4]) noexcept {
+    if (c <= 0x7F) {
+        out[0] = static_cast<char>(c);
+        return 1;
+    }
+    size_t n = c <= 0x7FF ? 2 : c <= 0xFFFF ? 3 : 4;
+    for (size_t i = n - 1; i > 0; --i) {
+        out[i] = static_cast<char>(0x80 | (c & 0x3F));
+        c >>= 6;
+    }
+    constexpr unsigned char lead[] = {0, 0, 0xC0, 0xE0, 0xF0};
+    out[0] = static_cast<char>(lead[n] | c);
+    return n;
+}
+
+bool is_too_long_for_prefix(std::string_view prefix, size_t digits) noexcept {
+    return ((prefix == "" || prefix == "u8") && digits > 2) || (prefix == "u" && digits > 4) || ((prefix == "U" || prefix == "L") && digits > 8);
+}
+
+size_t utf8_validate(std::string_view s) noexcept {
+    size_t i = 0;
+    while (i < size(s)) {
+        i += ascii_prefix(s.substr(i));
+        // Decode the non-ASCII run one sequence at a time, until the next ASCII byte
+        while (i < size(s) && static_cast<unsigned char>(s[i]) >= 0x80) {
+            char32_t c;
+            size_t len;
+            if (!utf8_decode(s, i, c, len)) {
+                return i;
+            }
+            i += len;
+        }
+    }
+    return std::string_view::npos;
+}
+
+template <size_t N> [[gnu::pure]] static bool in_table(const CodePointRange (&table)[N], char32_t c) noexcept {
+    auto it = std::upper_bound(std::begin(table), std::end(table), c, [](char32_t v, const CodePointRange &r) { return v < r.first; });
+    return it != std::begin(table) && c <= std::prev(it)->last;
+}
+
+bool is_xid_start(char32_t c) noexcept {
+    if (c < 0x80) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+    return in_table(xid_start, c);
+}
+
+bool is_xid_continue(char32_t c) noexcept {
+    if (c < 0x80) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+    return in_table(xid_continue, c);
+}
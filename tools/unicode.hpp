@@ -0,0 +1,52 @@
+#ifndef UNICODE_HPP
+#define UNICODE_HPP
+
+#include <cstddef>
+#include <string_view>
+
+struct CodePointRange {
+    char32_t first;
+    char32_t last;
+};
+
+/**
+ * True if every byte of `s` is below 0x80
+ */
+[[gnu::pure]] bool is_ascii(std::string_view s) noexcept;
+
+/**
+ * Return the offset of the first byte which is not part of a well-formed UTF-8 sequence,
+ * or std::string_view::npos if `s` is valid UTF-8
+ * https://www.unicode.org/versions/Unicode14.0.0/ch03.pdf#G7404 (table 3-7)
+ */
+[[gnu::pure]] size_t utf8_validate(std::string_view s) noexcept;
+
+/**
+ * Decode the sequence starting at `s[i]` and set `len` to its size
+ * Return false and set `len` to 0 if it is not well-formed
+ */
+bool utf8_decode(std::string_view s, size_t i, char32_t &c, size_t &len) noexcept;
+
+/**
+ * https://timsong-cpp.github.io/cppwp/lex#charset-2
+ */
+constexpr bool is_valid_ucs(char32_t c) noexcept { return c <= 0x10FFFF && (c < 0xD800 || c > 0xDFFF); }
+
+/**
+ * Write the UTF-8 sequence of `c`, which must be valid, to `out` and return its size
+ * https://en.wikipedia.org/wiki/UTF-8#Encoding
+ */
+size_t utf8_encode(char32_t c, char (&out)[4]) noexcept;
+
+/**
+ * True if an hexadecimal escape sequence of `digits` digits is out of range for the encoding prefix
+ */
+[[gnu::pure]] bool is_too_long_for_prefix(std::string_view prefix, size_t digits) noexcept;
+
+/**
+ * https://timsong-cpp.github.io/cppwp/lex.name
+ */
+[[gnu::pure]] bool is_xid_start(char32_t c) noexcept;
+[[gnu::pure]] bool is_xid_continue(char32_t c) noexcept;
+
+#endif // !UNICODE_HPP
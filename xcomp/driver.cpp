@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+#include "tools/arena.hpp"
+#include "tools/error.hpp"
+#include "tools/fingerprint.hpp"
+#include "tools/lexer.hpp"
+#include "tools/prefetch.hpp"
+#include "tools/stats.hpp"
+#include "tools/thread_pool.hpp"
+
+#include "driver.hpp"
+#include "preprocessed.hpp"
+#include "string.hpp"
+
+/**
+ * Parse the N of `option` N, between 1 and `max`
+ */
+static unsigned number_of(const std::string &option, const std::string &s, unsigned max) {
+    if (s.empty() || size(s) > 9 || s.find_first_not_of("0123456789") != std::string::npos) {
+        fatal("invalid ", option, " argument '", s, "'");
+    }
+    unsigned long n = std::stoul(s);
+    if (n == 0 || n > max) {
+        fatal("invalid ", option, " argument '", s, "'");
+    }
+    return static_cast<unsigned>(n);
+}
+
+Options parse_options(const std::vector<std::string> &args) {
+    Options o;
+    for (size_t i = 0; i < size(args); ++i) {
+        const std::string &a = args[i];
+        if (a == "-j") {
+            if (i + 1 == size(args)) {
+                fatal("missing argument to '-j'");
+            }
+            o.jobs = number_of("-j", args[++i], 1024);
+        } else if (a.rfind("-j", 0) == 0) {
+            o.jobs = number_of("-j", a.substr(2), 1024);
+        } else if (a == "-E") {
+            o.preprocess = true;
+        } else if (a == "-v") {
+            o.verbose = true;
+        } else if (a == "-ftime-report") {
+            o.time_report = true;
+        } else if (a.rfind("-std=", 0) == 0) {
+            Standard standard;
+            if (!standard_of_name(a.substr(5), standard)) {
+                fatal("unrecognized command-line option '", a, "'");
+            }
+            o.standard = standard;
+        } else if (a.rfind("-ftrace=", 0) == 0) {
+            o.trace = a.substr(8);
+        } else if (a.rfind("--daemon=", 0) == 0) {
+            o.daemon = a.substr(9);
+        } else if (a.rfind("--connect=", 0) == 0) {
+            o.connect = a.substr(10);
+        } else if (a.rfind("--cache-budget=", 0) == 0) {
+            o.cache_budget = size_t{number_of("--cache-budget", a.substr(15), 1 << 20)} << 20;
+        } else if (a == "--shutdown") {
+            o.shutdown = true;
+        } else if (a.size() > 1 && a[0] == '-') {
+            fatal("unrecognized command-line option '", a, "'");
+        } else {
+            o.inputs.push_back(a);
+        }
+    }
+    if (o.inputs.empty() && o.daemon.empty() && o.connect.empty() && !o.shutdown) {
+        fatal("no input files");
+    }
+    return o;
+}
+
+const ResultCache::Entry *ResultCache::find(const std::string &key) {
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        return nullptr;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    return &it->second.entry;
+}
+
+void ResultCache::insert(const std::string &key, Entry e) {
+    // The source, the -E output and the diagnostics are most of an entry
+    size_t bytes = sizeof(Node) + 2 * key.size() + e.source->text.size() + e.result.diagnostics.size() + e.result.preprocessed.size();
+    auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        m_bytes -= it->second.bytes;
+        it->second.entry = std::move(e);
+        it->second.bytes = bytes;
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    } else {
+        m_lru.push_front(key);
+        m_entries.emplace(key, Node{std::move(e), bytes, m_lru.begin()});
+    }
+    m_bytes += bytes;
+}
+
+void ResultCache::evict_to(size_t bytes) {
+    while (m_bytes > bytes && !m_lru.empty()) {
+        auto victim = m_entries.find(m_lru.back());
+        m_bytes -= victim->second.bytes;
+        m_entries.erase(victim);
+        m_lru.pop_back();
+    }
+}
+
+/**
+ * True if `a` and `b` hold the same bytes, the file cache keeps the same content for a file touched but unchanged
+ */
+static bool same_content(const FileCache::Content &a, const FileCache::Content &b) noexcept {
+    return a == b || (a->hash == b->hash && a->text == b->text);
+}
+
+/**
+ * True if `tokens` are the tokens of `previous` but for the formatting, which confirms equal fingerprints
+ * `previous` is lexed again: this only runs when the fingerprints match.
+ */
+static bool same_tokens(Standard language, const std::vector<Token> &tokens, const std::string &previous) {
+    std::string words;
+    Fingerprint now(&words);
+    for (const Token &t : tokens) {
+        now.add(t);
+    }
+    std::string previous_words;
+    fingerprint(language, previous, &previous_words);
+    return words == previous_words;
+}
+
+FileResult compile_file(const std::string &path, Shared &shared, Prefetcher *prefetcher, std::optional<Standard> standard, bool preprocess) {
+    Standard language = standard ? *standard : standard_of_path(path);
+    FileResult r;
+    FileCache::Content source;
+    std::string key = FileCache::key(path); // the same file for requests from different directories
+    if (preprocess) {
+        key.append(1, '\0').append(path); // the line markers of -E name the file as spelled on the command line
+    }
+    std::ostringstream diag;
+    DiagnosticsTo to(diag);
+    ThrowOnFatal guard;
+    try {
+        source = shared.files.read(path);
+        if (!source) {
+            fatal(path, ": No such file or directory");
+        }
+        if (prefetcher) {
+            // The headers of this file are read while it is lexed
+            prefetcher->prefetch(quoted_includes(source->text, std::filesystem::path(path).parent_path().string()));
+        }
+        // Result of the previous content of the file, reused if only its formatting changed
+        std::optional<FileResult> previous;
+        FileCache::Content previous_source;
+        {
+            std::lock_guard<std::mutex> lock(shared.results_mutex);
+            const ResultCache::Entry *e = shared.results.find(key);
+            if (e && e->standard == language && e->preprocess == preprocess) {
+                if (same_content(e->source, source)) {
+                    ++shared.result_hits;
+                    return e->result;
+                }
+                if (!preprocess) {
+                    previous = e->result;
+                    previous_source = e->source;
+                }
+            }
+        }
+
+        if (preprocess) {
+            // Written as they are lexed, nothing is kept
+            STATS_TIMER(Phase::Lex);
+            r.preprocessed.reserve(size(source->text) + size(path) + 16);
+            PreprocessedWriter w(r.preprocessed);
+            w.begin_file(path);
+            with_lexer(language, source->text, std::pmr::get_default_resource(), LexerEngine::Dfa, [&](auto &l) {
+                for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+                    w.write(t);
+                    ++r.tokens;
+                }
+            });
+            w.end_file();
+        } else {
+            // Every allocation of the file goes to one arena, dropped in one go at the end
+            Arena arena;
+            std::vector<Token> tokens;
+            Fingerprint fingerprint;
+            std::pmr::unordered_set<SharedInterner::Id> seen(arena.resource()); // the identifiers of this file
+            {
+                STATS_TIMER(Phase::Lex);
+                with_lexer(language, source->text, arena.resource(), LexerEngine::Dfa, [&](auto &l) {
+                    l.decode_litterals(true); // concatenate_litterals() has nothing left to convert
+                    for (Token t = l.next(); !t.is(Token::Type::End); t = l.next()) {
+                        if (t.is(Token::Type::Identifier)) {
+                            r.identifiers += seen.insert(shared.identifiers.intern(t.lex())).second;
+                        } else if (t.is_one_of(Token::Type::CharLitteral, Token::Type::StringLitteral)) {
+                            ++r.litterals;
+                        }
+                        fingerprint.add(t);
+                        tokens.push_back(std::move(t));
+                    }
+                });
+            }
+            r.tokens = size(tokens);
+            r.fingerprint = fingerprint.value();
+
+            if (previous && previous->fingerprint == r.fingerprint && same_tokens(language, tokens, previous_source->text)) {
+                // Same tokens, the later phases would give the same result
+                r = *previous;
+                r.tokens = size(tokens);
+                std::lock_guard<std::mutex> lock(shared.results_mutex);
+                ++shared.fingerprint_hits;
+            } else {
+                concatenate_litterals(tokens);
+            }
+        }
+        r.ok = true;
+    } catch (const FatalError &e) {
+        error(path, ": ", e.what());
+    } catch (const std::exception &e) {
+        // Out of memory, a file too large for a string...: this file fails, not the whole run
+        error(path, ": ", e.what());
+    }
+    r.diagnostics = diag.str();
+
+    if (r.ok && shared.keep_results) {
+        size_t used = shared.files.bytes() + shared.identifiers.bytes();
+        std::lock_guard<std::mutex> lock(shared.results_mutex);
+        shared.results.insert(key, {std::move(source), language, preprocess, r});
+        shared.results.evict_to(shared.budget > used ? shared.budget - used : 0);
+    }
+    return r;
+}
+
+int run(const Options &options, std::ostream &out, std::ostream &err) {
+    Shared shared(SIZE_MAX, false);
+    return run(options, shared, out, err);
+}
+
+int run(const Options &options, Shared &shared, std::ostream &out, std::ostream &err) {
+    Stats::instance().trace(!options.trace.empty()); // the timed scopes are kept only for -ftrace
+    if (shared.files.bytes() + shared.identifiers.bytes() > shared.budget) {
+        shared.identifiers.clear(); // no worker is running, the ids of the previous runs are not used any more
+    }
+    std::vector<FileResult> results(size(options.inputs));
+    {
+        // The first `jobs` inputs are read by the workers right away, the ones queued behind them are read ahead
+        Prefetcher prefetcher(shared.files);
+        if (size(options.inputs) > options.jobs) {
+            prefetcher.prefetch({begin(options.inputs) + options.jobs, end(options.inputs)});
+        }
+
+        ThreadPool pool(std::min<unsigned>(options.jobs, static_cast<unsigned>(size(options.inputs))));
+        for (size_t i = 0; i < size(options.inputs); ++i) {
+            pool.submit([&options, &shared, &results, &prefetcher, i]() noexcept {
+                results[i] = compile_file(options.inputs[i], shared, &prefetcher, options.standard, options.preprocess);
+            });
+        }
+        pool.wait();
+    }
+
+    // Results are printed in input order, whatever order the workers finished in
+    int status = EXIT_SUCCESS;
+    for (size_t i = 0; i < size(results); ++i) {
+        const FileResult &r = results[i];
+        err << r.diagnostics;
+        out.write(r.preprocessed.data(), static_cast<std::streamsize>(size(r.preprocessed)));
+        if (!r.ok) {
+            status = EXIT_FAILURE;
+        } else if (options.verbose) {
+            out << options.inputs[i] << ": " << r.tokens << " tokens, " << r.litterals << " litterals, " << r.identifiers << " identifiers\n";
+        }
+    }
+
+    if (options.time_report) {
+        Stats::instance().print_table(err);
+    }
+    if (!options.trace.empty()) {
+        std::ofstream f(options.trace);
+        if (!f) {
+            fatal("cannot write ", options.trace);
+        }
+        Stats::instance().write_trace(f);
+    }
+    return status;
+}
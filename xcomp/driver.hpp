@@ -0,0 +1,129 @@
+#ifndef DRIVER_HPP
+#define DRIVER_HPP
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tools/file_cache.hpp"
+#include "tools/interner.hpp"
+#include "tools/language.hpp"
+#include "tools/prefetch.hpp"
+
+struct Options {
+    std::vector<std::string> inputs;
+    unsigned jobs = 1;
+    bool verbose = false;
+    bool time_report = false;
+    std::string trace; // -ftrace=<file>, empty for none
+    std::optional<Standard> standard; // -std=<name>, from the extension of each input if not set
+    bool preprocess = false;          // -E: write the tokens of every input to the output
+
+    std::string daemon;            // --daemon=<socket>: serve requests on this socket
+    std::string connect;           // --connect=<socket>: forward the command line to a daemon
+    size_t cache_budget = 1 << 30; // --cache-budget=<MiB>: memory kept by the daemon file cache and results
+    bool shutdown = false;         // --shutdown: stop the daemon
+};
+
+/**
+ * Parse the command line, arguments not starting with '-' are input files
+ */
+Options parse_options(const std::vector<std::string> &args);
+
+/**
+ * Outcome of one input, diagnostics included, printed in input order once every file is done
+ */
+struct FileResult {
+    bool ok = false;
+    size_t tokens = 0;
+    size_t litterals = 0;
+    size_t identifiers = 0; // distinct
+    std::string diagnostics;
+    std::string preprocessed; // with -E
+    uint64_t fingerprint = 0; // of the tokens, see Fingerprint, without -E
+};
+
+/**
+ * Result of each file for the content, the standard and the mode it was computed with, by absolute path
+ * With -E the path as spelled is part of the key, it is written in the output.
+ * The content is kept to check a hit byte for byte, and counted in the entry even if the file cache shares it.
+ * Entries are evicted in LRU order by evict_to(). Not thread safe, see Shared::results_mutex.
+ */
+class ResultCache {
+  public:
+    struct Entry {
+        FileCache::Content source;
+        Standard standard;
+        bool preprocess;
+        FileResult result;
+    };
+
+    /**
+     * Entry of `key`, now the most recently used, nullptr if absent
+     */
+    const Entry *find(const std::string &key);
+    void insert(const std::string &key, Entry e);
+
+    /**
+     * Evict the least recently used entries until at most `bytes` are kept
+     */
+    void evict_to(size_t bytes);
+
+    size_t size() const noexcept { return m_entries.size(); }
+    size_t bytes() const noexcept { return m_bytes; }
+
+  private:
+    struct Node {
+        Entry entry;
+        size_t bytes;
+        std::list<std::string>::iterator lru;
+    };
+
+    std::unordered_map<std::string, Node> m_entries;
+    std::list<std::string> m_lru; // most recently used first
+    size_t m_bytes = 0;
+};
+
+/**
+ * Caches shared by every file of an invocation, and kept across the requests of a daemon
+ * The file cache, the identifiers and the results share `budget`, the files have priority
+ * The identifiers are dropped between two runs once they are over their share, no id outlives a run.
+ * Without `keep_results`, for a one-shot run which never reads them back, the results are not cached.
+ */
+struct Shared {
+    explicit Shared(size_t cache_budget = SIZE_MAX, bool keep = true) : files(cache_budget), budget(cache_budget), keep_results(keep) {}
+
+    FileCache files;
+    SharedInterner identifiers;
+
+    std::mutex results_mutex;
+    ResultCache results;
+    size_t budget;
+    bool keep_results;
+    size_t result_hits = 0;
+    size_t fingerprint_hits = 0; // the content changed but not the tokens
+};
+
+/**
+ * Run the per-file pipeline on `path`: read, lex, convert escape sequences
+ * If only the formatting of the file changed since its cached result, the phases after lexing are skipped
+ * With `preprocess`, the tokens are written to FileResult::preprocessed instead of being converted
+ * The quoted includes of the file are handed to `prefetcher`, if any
+ * Without `standard`, the standard is chosen from the extension of `path`
+ */
+FileResult compile_file(const std::string &path, Shared &shared, Prefetcher *prefetcher = nullptr, std::optional<Standard> standard = {},
+                        bool preprocess = false);
+
+/**
+ * Compile every input on `options.jobs` workers, print the results in input order and return the exit status
+ */
+int run(const Options &options, Shared &shared, std::ostream &out, std::ostream &err);
+int run(const Options &options, std::ostream &out, std::ostream &err);
+
+#endif // !DRIVER_HPP
@@ -0,0 +1,98 @@
+#include <cassert>
+#include <functional>
+
+#include "tools/alloc_stats.hpp"
+#include "tools/error.hpp"
+#include "tools/unicode.hpp"
+
+#include "litteral_pool.hpp"
+
+Encoding encoding_of(std::string_view prefix) {
+    if (prefix == "" || prefix == "u8") {
+        return Encoding::Utf8;
+    }
+    if (prefix == "u") {
+        return Encoding::Utf16;
+    }
+    assert(prefix == "U" || prefix == "L");
+    return Encoding::Utf32;
+}
+
+/**
+ * Append the code unit `u` of `n` bytes in little-endian order
+ */
+static void put_unit(std::string &s, char32_t u, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        s += static_cast<char>((u >> (8 * i)) & 0xFF);
+    }
+}
+
+/**
+ * https://en.wikipedia.org/wiki/UTF-16#Code_points_from_U+010000_to_U+10FFFF
+ */
+static void put_utf16(std::string &s, char32_t c) {
+    if (c < 0x10000) {
+        put_unit(s, c, 2);
+        return;
+    }
+    c -= 0x10000;
+    put_unit(s, 0xD800 + (c >> 10), 2);
+    put_unit(s, 0xDC00 + (c & 0x3FF), 2);
+}
+
+LitteralPool::Id LitteralPool::add(Token &t) {
+    assert(t.is(Token::Type::StringLitteral));
+    Id id = add(t.lex(), encoding_of(t.prefix()));
+    t.litteral_id(id);
+    return id;
+}
+
+LitteralPool::Id LitteralPool::add(std::string_view utf8, Encoding e) {
+    ALLOC_SCOPE(AllocCategory::LitteralDecoding);
+    size_t unit = unit_size(e);
+    size_t old_size = m_data.size();
+    m_data.append((unit - old_size % unit) % unit, '\0');
+    size_t offset = m_data.size();
+
+    // Encode in place at the end of the buffer, it is dropped again if already pooled
+    if (e == Encoding::Utf8) {
+        m_data.append(utf8);
+    } else {
+        size_t i = 0;
+        while (i < utf8.size()) {
+            char32_t c;
+            size_t len;
+            if (!utf8_decode(utf8, i, c, len)) {
+                fatal("invalid UTF-8 in string litteral");
+            }
+            if (e == Encoding::Utf16) {
+                put_utf16(m_data, c);
+            } else {
+                put_unit(m_data, c, 4);
+            }
+            i += len;
+        }
+    }
+    put_unit(m_data, 0, unit);
+
+    if (m_entries.size() >= Token::no_litteral) {
+        fatal("too many string litterals");
+    }
+    Id id = static_cast<Id>(m_entries.size());
+    m_entries.push_back(Entry{offset, m_data.size() - offset, e});
+    auto [it, inserted] = m_index.insert(id);
+    if (!inserted) {
+        m_entries.pop_back();
+        m_data.resize(old_size);
+    }
+    return *it;
+}
+
+size_t LitteralPool::Hash::operator()(Id id) const noexcept {
+    const Entry &e = pool->m_entries[id];
+    return std::hash<std::string_view>{}(pool->bytes(id)) ^ static_cast<size_t>(e.encoding);
+}
+
+bool LitteralPool::Equal::operator()(Id a, Id b) const noexcept {
+    return pool->m_entries[a].encoding == pool->m_entries[b].encoding && pool->bytes(a) == pool->bytes(b);
+}
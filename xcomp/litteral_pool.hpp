@@ -0,0 +1,95 @@
+#ifndef LITTERAL_POOL_HPP
+#define LITTERAL_POOL_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "tools/lexer.hpp"
+
+/**
+ * Encoding of a string litteral in the object file
+ * https://timsong-cpp.github.io/cppwp/lex.string#tab:lex.string.literal
+ */
+enum class Encoding {
+    Utf8,  // "" and u8: char / char8_t
+    Utf16, // u: char16_t
+    Utf32, // U: char32_t, and L: wchar_t is UTF-32 on the linux target
+};
+
+[[gnu::pure]] Encoding encoding_of(std::string_view prefix);
+
+/**
+ * Size in bytes of one code unit of `e`
+ */
+constexpr size_t unit_size(Encoding e) noexcept {
+    if (e == Encoding::Utf16) {
+        return sizeof(char16_t);
+    }
+    if (e == Encoding::Utf32) {
+        return sizeof(char32_t);
+    }
+    return sizeof(char);
+}
+
+/**
+ * Store each distinct string litteral once, in its final encoding
+ * The storage is one contiguous little-endian buffer, ready to be emitted as .rodata
+ */
+class LitteralPool {
+  public:
+    using Id = uint32_t;
+
+    struct Entry {
+        size_t offset; // in data(), aligned on the code unit size
+        size_t size;   // in bytes, terminating null included
+        Encoding encoding;
+    };
+
+    LitteralPool() : m_index(0, Hash{this}, Equal{this}) {}
+    LitteralPool(const LitteralPool &) = delete;
+    LitteralPool &operator=(const LitteralPool &) = delete;
+
+    /**
+     * Intern the content of a StringLitteral already passed through convert_escape_sequence
+     * The pool id is also stored in the token
+     */
+    Id add(Token &t);
+
+    /**
+     * Intern `utf8` converted to `e`, return the id of an identical litteral if there is one
+     * With Encoding::Utf8 the bytes are stored as they are: the numeric escapes of a narrow litteral may not be UTF-8.
+     */
+    Id add(std::string_view utf8, Encoding e);
+
+    const Entry &entry(Id id) const noexcept { return m_entries[id]; }
+
+    /**
+     * Encoded bytes of a litteral, the view is valid until the next add()
+     */
+    std::string_view bytes(Id id) const noexcept { return std::string_view(m_data).substr(m_entries[id].offset, m_entries[id].size); }
+
+    /**
+     * Number of distinct litterals
+     */
+    size_t size() const noexcept { return m_entries.size(); }
+    const std::string &data() const noexcept { return m_data; }
+
+  private:
+    struct Hash {
+        const LitteralPool *pool;
+        size_t operator()(Id id) const noexcept;
+    };
+    struct Equal {
+        const LitteralPool *pool;
+        bool operator()(Id a, Id b) const noexcept;
+    };
+
+    std::string m_data;
+    std::vector<Entry> m_entries;
+    std::unordered_set<Id, Hash, Equal> m_index; // the keys live in m_data, no second copy
+};
+
+#endif // !LITTERAL_POOL_HPP
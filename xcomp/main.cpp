@@ -0,0 +1,27 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "tools/error.hpp"
+
+#include "driver.hpp"
+#include "server.hpp"
+
+int main(int argc, char **argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    Options o = parse_options(args);
+
+    if (!o.connect.empty()) {
+        auto is_connect = [](const std::string &a) { return a.rfind("--connect=", 0) == 0; };
+        args.erase(std::remove_if(args.begin(), args.end(), is_connect), args.end());
+        return forward(o.connect, args, std::cout, std::cerr);
+    }
+    if (!o.daemon.empty()) {
+        return serve(o.daemon, o.cache_budget);
+    }
+    if (o.shutdown) {
+        fatal("--shutdown requires --connect=<socket>");
+    }
+    return run(o, std::cout, std::cerr);
+}
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cassert>
+#include <unordered_set>
+#include <vector>
+
+#include "tools/error.hpp"
+
+#include "preprocessed.hpp"
+
+// https://gcc.gnu.org/onlinedocs/cpp/Preprocessor-Output.html
+static constexpr size_t max_blank_lines = 8;
+
+// https://timsong-cpp.github.io/cppwp/lex.string#nt:d-char-sequence
+static constexpr size_t max_delimiter = 16;
+static constexpr std::string_view delimiter_chars("xyzabcdefghijklmnopqrstuvwABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_");
+
+/**
+ * Shortest delimiter made of `delimiter_chars` for which ")delimiter\"" does not occur in `s`
+ * Each ')' rules out at most one delimiter, the one up to the next '"', so one is found among the first size(s) + 1.
+ */
+static std::string raw_delimiter(std::string_view s) {
+    std::unordered_set<std::string_view> taken;
+    for (size_t i = s.find(')'); i != std::string_view::npos; i = s.find(')', i + 1)) {
+        size_t quote = s.find('"', i + 1);
+        if (quote != std::string_view::npos && quote - i - 1 <= max_delimiter) {
+            taken.insert(s.substr(i + 1, quote - i - 1));
+        }
+    }
+    // Candidates by length, then in the order of delimiter_chars: "", "x", "y"... "_", "xx", "xy"...
+    std::string d;
+    std::vector<size_t> digits;
+    while (taken.count(d) != 0) {
+        size_t k = size(digits);
+        while (k > 0 && digits[k - 1] + 1 == size(delimiter_chars)) {
+            digits[--k] = 0;
+            d[k] = delimiter_chars[0];
+        }
+        if (k == 0) {
+            if (size(d) == max_delimiter) {
+                fatal("no raw string delimiter is left for a string of ", size(s), " bytes");
+            }
+            digits.insert(digits.begin(), 0);
+            d.insert(d.begin(), delimiter_chars[0]);
+        } else {
+            d[k - 1] = delimiter_chars[++digits[k - 1]];
+        }
+    }
+    return d;
+}
+
+void append_spelling(std::string &out, const Token &t) {
+    assert(!t.decoded());
+    if (t.is(Token::Type::CharLitteral)) {
+        out.append(t.prefix()).append(1, '\'').append(t.lex()).append(1, '\'');
+    } else if (t.is(Token::Type::StringLitteral) && !t.raw()) {
+        out.append(t.prefix()).append(1, '"').append(t.lex()).append(1, '"');
+    } else if (t.is(Token::Type::StringLitteral)) {
+        // The delimiter is not kept, the shortest one which does not end the string early will do
+        std::string d = raw_delimiter(t.lex());
+        out.append(t.prefix()).append("R\"").append(d).append(1, '(').append(t.lex()).append(1, ')').append(d).append(1, '"');
+    } else {
+        out.append(t.lex());
+    }
+}
+
+/**
+ * `path` between quotes, with '"' and '\\' escaped and the control characters as octal escapes, as cpp writes it
+ */
+static std::string quoted(std::string_view path) {
+    std::string q(1, '"');
+    for (char c : path) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            q += '\\';
+            q += c;
+        } else if (u < 0x20 || u == 0x7f) {
+            q += '\\';
+            q += static_cast<char>('0' + (u >> 6));
+            q += static_cast<char>('0' + ((u >> 3) & 7));
+            q += static_cast<char>('0' + (u & 7));
+        } else {
+            q += c;
+        }
+    }
+    q += '"';
+    return q;
+}
+
+void PreprocessedWriter::begin_file(std::string_view path) {
+    if (!m_line_start) {
+        m_out += '\n';
+    }
+    m_path = quoted(path);
+    m_line = 1;
+    m_out_line = 1;
+    m_line_start = true;
+    m_space = false;
+    m_out.append("# 1 ").append(m_path).append(1, '\n');
+}
+
+void PreprocessedWriter::sync_line() {
+    if (!m_line_start) {
+        m_out += '\n';
+        ++m_out_line;
+        m_line_start = true;
+    }
+    if (m_line - m_out_line > max_blank_lines) {
+        m_out.append("# ").append(std::to_string(m_line)).append(1, ' ').append(m_path).append(1, '\n');
+    } else {
+        m_out.append(m_line - m_out_line, '\n');
+    }
+    m_out_line = m_line;
+}
+
+void PreprocessedWriter::write(const Token &t) {
+    if (t.is(Token::Type::Newline)) {
+        ++m_line;
+        m_space = false;
+        return;
+    }
+    if (t.is(Token::Type::Space)) {
+        m_space = true;
+        return;
+    }
+    if (t.is(Token::Type::End)) {
+        return;
+    }
+
+    if (m_line != m_out_line) {
+        sync_line();
+    } else if (m_space && !m_line_start) {
+        m_out += ' ';
+    }
+    append_spelling(m_out, t);
+    if (t.raw()) {
+        // The lines of a raw string are in the input and in the output
+        size_t lines = static_cast<size_t>(std::count(t.lex().begin(), t.lex().end(), '\n'));
+        m_line += lines;
+        m_out_line += lines;
+    }
+    m_line_start = false;
+    m_space = false;
+}
+
+void PreprocessedWriter::end_file() {
+    if (!m_line_start) {
+        m_out += '\n';
+        m_line_start = true;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef PREPROCESSED_HPP
+#define PREPROCESSED_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "tools/lexer.hpp"
+
+/**
+ * Write a token stream back as source text, the output of -E
+ *
+ * Runs of spaces become one space and the indentation is dropped. Up to 8 blank lines are kept as they are,
+ * a longer gap is replaced by a line marker: # <line> "<file>". Tokens are appended to one string which
+ * is written out in a single call, there is no per token stream operation.
+ */
+class PreprocessedWriter {
+  public:
+    explicit PreprocessedWriter(std::string &out) noexcept : m_out(out) {}
+
+    /**
+     * Start the output of `path` with a line marker
+     */
+    void begin_file(std::string_view path);
+
+    /**
+     * Append `t`, which must not be decoded(): litterals are written with their source spelling
+     */
+    void write(const Token &t);
+
+    /**
+     * Terminate the last line
+     */
+    void end_file();
+
+  private:
+    /**
+     * Move the output to the line of the next token
+     */
+    void sync_line();
+
+    std::string &m_out;
+    std::string m_path; // as written in the line markers: quoted and escaped
+    size_t m_line = 1;     // line of the next token in the input
+    size_t m_out_line = 1; // line of the output position
+    bool m_line_start = true;
+    bool m_space = false; // spaces before the next token
+};
+
+/**
+ * Append the source spelling of `t`: prefix, quotes and raw string delimiters included
+ */
+void append_spelling(std::string &out, const Token &t);
+
+#endif // !PREPROCESSED_HPP
@@ -0,0 +1,249 @@
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "tools/error.hpp"
+#include "tools/stats.hpp"
+
+#include "driver.hpp"
+#include "server.hpp"
+
+/**
+ * Length-prefixed messages over a connected socket
+ * Request:  cwd, argument count, arguments
+ * Response: exit status, stdout, stderr
+ */
+class Channel {
+  public:
+    explicit Channel(int fd) noexcept : m_fd(fd) {}
+    ~Channel() { close(m_fd); }
+    Channel(const Channel &) = delete;
+    Channel &operator=(const Channel &) = delete;
+
+    bool put(uint32_t n) { return put_bytes(&n, sizeof(n)); }
+    bool put(const std::string &s) { return put(static_cast<uint32_t>(size(s))) && put_bytes(s.data(), size(s)); }
+
+    bool get(uint32_t &n) { return get_bytes(&n, sizeof(n)); }
+    /**
+     * False if the peer is gone, or sends more than `max` bytes: nothing is allocated for them
+     */
+    bool get(std::string &s, uint32_t max = UINT32_MAX) {
+        uint32_t n;
+        if (!get(n)) {
+            return false;
+        }
+        if (n > max) {
+            m_too_long = true;
+            return false;
+        }
+        s.resize(n);
+        return get_bytes(s.data(), n);
+    }
+
+    /**
+     * True once get() refused a string longer than its `max`
+     */
+    bool too_long() const noexcept { return m_too_long; }
+
+  private:
+    bool put_bytes(const void *p, size_t n) {
+        const char *c = static_cast<const char *>(p);
+        while (n != 0) {
+            ssize_t w = send(m_fd, c, n, MSG_NOSIGNAL);
+            if (w < 0 && errno == EINTR) {
+                continue;
+            }
+            if (w <= 0) {
+                return false;
+            }
+            c += w;
+            n -= static_cast<size_t>(w);
+        }
+        return true;
+    }
+
+    bool get_bytes(void *p, size_t n) {
+        char *c = static_cast<char *>(p);
+        while (n != 0) {
+            ssize_t r = recv(m_fd, c, n, 0);
+            if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            if (r <= 0) {
+                return false;
+            }
+            c += r;
+            n -= static_cast<size_t>(r);
+        }
+        return true;
+    }
+
+    int m_fd;
+    bool m_too_long = false;
+};
+
+// What a request may hold: a malformed one is refused instead of making the daemon allocate gigabytes
+static constexpr uint32_t max_argument = 1 << 16;  // bytes of the directory or of one argument
+static constexpr uint32_t max_arguments = 1 << 16;
+static constexpr size_t max_request = 16 << 20;    // bytes of all the arguments
+
+// Requests run one at a time: a client which stops sending or reading must not hold the daemon
+static constexpr time_t client_timeout_s = 10;
+
+static sockaddr_un address(const std::string &path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (size(path) >= sizeof(addr.sun_path)) {
+        fatal("socket path too long: ", path);
+    }
+    std::memcpy(addr.sun_path, path.c_str(), size(path) + 1);
+    return addr;
+}
+
+/**
+ * True if a daemon accepts connections on `path`
+ */
+static bool listening(const sockaddr_un &addr) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fatal("cannot create socket: ", std::strerror(errno));
+    }
+    bool connected = connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) == 0;
+    close(fd);
+    return connected;
+}
+
+/**
+ * Run one request, return true if it asks the daemon to stop
+ */
+static bool handle(Channel &c, Shared &shared) {
+    auto refuse = [&c]() {
+        c.put(static_cast<uint32_t>(EXIT_FAILURE)) && c.put(std::string()) && c.put(std::string("error: request too large\n"));
+        return false;
+    };
+    std::string cwd;
+    uint32_t argc;
+    if (!c.get(cwd, max_argument) || !c.get(argc)) {
+        return c.too_long() && refuse();
+    }
+    if (argc > max_arguments) {
+        return refuse();
+    }
+    std::vector<std::string> args(argc);
+    size_t bytes = size(cwd);
+    for (std::string &a : args) {
+        if (!c.get(a, max_argument)) {
+            return c.too_long() && refuse();
+        }
+        bytes += size(a);
+        if (bytes > max_request) {
+            return refuse();
+        }
+    }
+
+    std::ostringstream out;
+    std::ostringstream err;
+    int status = EXIT_FAILURE;
+    bool stop = false;
+    {
+        DiagnosticsTo to(err);
+        ThrowOnFatal guard;
+        try {
+            if (chdir(cwd.c_str()) != 0) {
+                fatal("cannot change directory to ", cwd);
+            }
+            Options o = parse_options(args);
+            if (o.shutdown) {
+                stop = true;
+                status = EXIT_SUCCESS;
+            } else {
+                Stats::instance().reset(); // the report is per request
+                status = run(o, shared, out, err);
+            }
+        } catch (const FatalError &e) {
+            error(e.what());
+        }
+    }
+
+    c.put(static_cast<uint32_t>(status)) && c.put(out.str()) && c.put(err.str());
+    return stop;
+}
+
+int serve(const std::string &path, size_t cache_budget) {
+    sockaddr_un addr = address(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fatal("cannot create socket: ", std::strerror(errno));
+    }
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fatal(path, " exists and is not a socket");
+        }
+        if (listening(addr)) {
+            fatal("a daemon is already listening on ", path);
+        }
+        unlink(path.c_str()); // left over by a daemon which did not stop cleanly
+    }
+    // Only the owner may send requests, before any connection is accepted
+    if (bind(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0 || chmod(path.c_str(), 0600) != 0 || listen(fd, 64) != 0) {
+        fatal("cannot listen on ", path, ": ", std::strerror(errno));
+    }
+
+    Shared shared(cache_budget);
+    for (bool stop = false; !stop;) {
+        int client = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            fatal("accept failed: ", std::strerror(errno));
+        }
+        Channel c(client);
+        timeval timeout{client_timeout_s, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        stop = handle(c, shared);
+    }
+
+    close(fd);
+    unlink(path.c_str());
+    return EXIT_SUCCESS;
+}
+
+int forward(const std::string &path, const std::vector<std::string> &args, std::ostream &out, std::ostream &err) {
+    sockaddr_un addr = address(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fatal("cannot create socket: ", std::strerror(errno));
+    }
+    Channel c(fd);
+    if (connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0) {
+        fatal("cannot connect to ", path, ": ", std::strerror(errno));
+    }
+
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == nullptr) {
+        fatal("cannot get the current directory");
+    }
+    bool sent = c.put(std::string(cwd)) && c.put(static_cast<uint32_t>(size(args)));
+    for (size_t i = 0; sent && i < size(args); ++i) {
+        sent = c.put(args[i]);
+    }
+
+    uint32_t status;
+    std::string o;
+    std::string e;
+    if (!sent || !c.get(status) || !c.get(o) || !c.get(e)) {
+        fatal("connection to ", path, " lost");
+    }
+    out << o;
+    err << e;
+    return static_cast<int>(status);
+}
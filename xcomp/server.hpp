@@ -0,0 +1,21 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Serve command lines sent by forward() on the Unix socket `path`, until one of them is --shutdown
+ * The socket is only accessible to its owner. A stale socket at `path` is replaced, anything else at `path` is an error.
+ * Requests run one after the other in the working directory of their client,
+ * the file cache, the identifiers and the per-file results are kept from one request to the next, within `cache_budget`
+ */
+int serve(const std::string &path, size_t cache_budget);
+
+/**
+ * Run `args` in the daemon listening on `path`, print its output and return its exit status
+ */
+int forward(const std::string &path, const std::vector<std::string> &args, std::ostream &out, std::ostream &err);
+
+#endif // !SERVER_HPP
@@ -1,9 +1,19 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <codecvt>
+#include <condition_variable>
+#include <exception>
 #include <limits>
 #include <locale>
+#include <memory>
+#include <mutex>
 
+#include "tools/alloc_stats.hpp"
 #include "tools/lexer.hpp"
+#include "tools/stats.hpp"
+#include "tools/thread_pool.hpp"
+#include "tools/unicode.hpp"
 
 #include "string.hpp"
 
@@ -14,148 +24,119 @@ static bool is_hexa(char c) {
     return hexa.find(c) != std::string::npos;
 }
 
-/**
- * https://timsong-cpp.github.io/cppwp/lex#charset-2
- */
-static bool is_valid_ucs(long n) { return n >= 0 && n <= 0x10FFFF && (n < 0xD800 || n > 0xDFFF); }
+static uint32_t hexa_value(char c) noexcept { return static_cast<uint32_t>(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10); }
 
 /**
+ * Append the UTF-8 sequence of `n` to `out`
  * https://en.wikipedia.org/wiki/UTF-8#Encoding
  */
-static std::string ucs_to_utf8(long n) {
-    if (!is_valid_ucs(n)) {
+static void append_ucs(std::string &out, uint32_t n) {
+    if (n > 0x10FFFF || !is_valid_ucs(n)) {
         fatal("invalid unicode sequence");
     }
-
-    if (n <= 0x7F) {
-        return std::string(1, static_cast<char>(n) & 0x7F);
-    }
-    if (n <= 0x7FF) {
-        unsigned char c[2];
-        c[1] = static_cast<unsigned char>(0x80 | (n & 0x3F));
-        n >>= 6;
-        c[0] = static_cast<unsigned char>(0xC0 | (n & 0x1F));
-        return std::string(reinterpret_cast<const char *>(c), 2);
-    }
-    if (n <= 0xFFFF) {
-        unsigned char c[3];
-        c[2] = static_cast<unsigned char>(0x80 | (n & 0x3F));
-        n >>= 6;
-        c[1] = static_cast<unsigned char>(0x80 | (n & 0x3F));
-        n >>= 6;
-        c[0] = static_cast<unsigned char>(0xE0 | (n & 0xF));
-        return std::string(reinterpret_cast<const char *>(c), 3);
-    }
-
-    unsigned char c[4];
-    c[3] = static_cast<unsigned char>(0x80 | (n & 0x3F));
-    n >>= 6;
-    c[2] = static_cast<unsigned char>(0x80 | (n & 0x3F));
-    n >>= 6;
-    c[1] = static_cast<unsigned char>(0x80 | (n & 0x3F));
-    n >>= 6;
-    c[0] = static_cast<unsigned char>(0xF0 | (n & 0x7));
-    return std::string(reinterpret_cast<const char *>(c), 4);
-}
-
-using StrInt = std::tuple<std::string, size_t>;
-
-static StrInt get_unicode(const std::string &seq, size_t i, size_t l) {
-    std::string s;
-    while (size(s) < l) {
-        assert(is_hexa(seq[i]));
-        s += seq[i];
-        i++;
-    }
-
-    long n = std::stol(s, nullptr, 16);
-    return {ucs_to_utf8(n), i};
+    char c[4];
+    out.append(c, utf8_encode(n, c));
 }
 
 /**
- * Convert and return a 16bits unicode sequence
+ * Append the value `n` of a numeric escape sequence: the byte itself for a narrow or u8 litteral, where only
+ * universal character names are UTF-8 encoded, the code point otherwise
  */
-static StrInt get_unicode_u(const std::string &seq, size_t i) { return get_unicode(seq, i, 4); }
+static void append_numeric(std::string &out, std::string_view prefix, uint32_t n) {
+    if (prefix.empty() || prefix == "u8") {
+        out += static_cast<char>(n);
+        return;
+    }
+    append_ucs(out, n);
+}
 
 /**
- * Convert and return a 32bits unicode sequence
+ * Convert a universal character name of `digits` hexadecimal digits starting at seq[i], return the index after it
  */
-static StrInt get_unicode_U(const std::string &seq, size_t i) { return get_unicode(seq, i, 8); }
-
-static bool is_too_long_for_prefix(const std::string &prefix, size_t n) {
-    return ((prefix == "" || prefix == "u8") && n > 2) || (prefix == "u" && n > 4) || ((prefix == "U" || prefix == "L") && n > 8);
+static size_t append_unicode(std::string &out, std::string_view seq, size_t i, size_t digits) {
+    uint32_t n = 0;
+    for (size_t end = i + digits; i < end; ++i) {
+        if (i == size(seq) || !is_hexa(seq[i])) {
+            fatal("incomplete universal character name");
+        }
+        n = n * 16 + hexa_value(seq[i]);
+    }
+    append_ucs(out, n);
+    return i;
 }
 
 /**
- * Convert and return an hexa sequence
+ * Convert an hexa sequence starting at seq[i], return the index after it
  */
-static StrInt get_hexa(const std::string &seq, const std::string &prefix, size_t i) {
-    std::string s;
-    while (is_hexa(seq[i])) {
-        s += seq[i];
+static size_t append_hexa(std::string &out, std::string_view seq, std::string_view prefix, size_t i) {
+    size_t start = i;
+    uint32_t n = 0;
+    while (i < size(seq) && is_hexa(seq[i])) {
+        n = n * 16 + hexa_value(seq[i]); // wraps only when there are too many digits anyway
         i++;
     }
-
-    if (is_too_long_for_prefix(prefix, size(s))) {
+    if (i == start) {
+        fatal("\\x used with no following hex digits");
+    }
+    if (is_too_long_for_prefix(prefix, i - start) || i - start > 8) {
         fatal("hex escape sequence out of range");
     }
-    long n = std::stol(s, nullptr, 16);
-    return {ucs_to_utf8(n), i};
+    append_numeric(out, prefix, n);
+    return i;
 }
 
 /**
- * Convert and return an octal sequence
+ * Convert an octal sequence starting at seq[i], return the index after it
+ * At most 3 digits, a following digit is an ordinary character: "\1234" is "S4"
  */
-static StrInt get_octal(const std::string &seq, const std::string &prefix, size_t i) {
-    std::string s;
-    while (is_octal(seq[i])) {
-        s += seq[i];
+static size_t append_octal(std::string &out, std::string_view seq, std::string_view prefix, size_t i) {
+    size_t start = i;
+    uint32_t n = 0;
+    while (i < size(seq) && i - start < 3 && is_octal(seq[i])) {
+        n = n * 8 + static_cast<uint32_t>(seq[i] - '0');
         i++;
     }
-    if (size(s) > 3) {
+    if ((prefix.empty() || prefix == "u8") && n > std::numeric_limits<unsigned char>::max()) {
         fatal("octal escape sequence out of range");
     }
-
-    long n = std::stol(s, nullptr, 8);
-    if (prefix == "u8" && n > std::numeric_limits<unsigned char>::max()) {
-        fatal("octal escape sequence out of range");
-    }
-    return {ucs_to_utf8(n), i};
+    append_numeric(out, prefix, n);
+    return i;
 }
 
 /**
- * Convert and return the first character found in `seq` with prefix `prefix`
- * Return the converted character and its original length
+ * Append the conversion of the character or escape sequence at seq[i] with prefix `prefix` to `out`
+ * Return the index after it: the cost is linear in the length of `seq`, whatever it holds
  */
-static StrInt get_one_escape_sequence(const std::string &seq, const std::string &prefix) {
-    size_t i(0);
+static size_t append_one_escape_sequence(std::string &out, std::string_view seq, std::string_view prefix, size_t i) {
     if (seq[i] != '\\') {
-        return {seq.substr(0, 1), 1}; // ordinary character literal
+        out += seq[i]; // ordinary character literal
+        return i + 1;
     }
 
     i++; // '\\'
+    if (i == size(seq)) {
+        fatal("bad escape sequence");
+    }
     char c = seq[i];
     if (c == 'x') {
-        i++;
-        return get_hexa(seq, prefix, i);
+        return append_hexa(out, seq, prefix, i + 1);
     }
     if (c == 'u') {
-        i++;
-        return get_unicode_u(seq, i);
+        return append_unicode(out, seq, i + 1, 4);
     }
     if (c == 'U') {
-        i++;
-        return get_unicode_U(seq, i);
+        return append_unicode(out, seq, i + 1, 8);
     }
     if (is_octal(c)) {
-        return get_octal(seq, prefix, i);
+        return append_octal(out, seq, prefix, i);
     }
 
     constexpr std::string_view simple_escape_sequence_letter("'\"?\\abfnrtv");
     constexpr std::string_view simple_escaped_sequence_letter("\'\"\?\\\a\b\f\n\r\t\v");
     auto id = simple_escape_sequence_letter.find(c);
     if (id != std::string::npos) {
-        return {std::string(1, simple_escaped_sequence_letter[id]), 2};
+        out += simple_escaped_sequence_letter[id];
+        return i + 1;
     }
     fatal("bad escape sequence");
 }
@@ -165,11 +146,14 @@ static StrInt get_one_escape_sequence(const std::string &seq, const std::string
  */
 static std::string char_escape_sequence(const Token &t) {
     assert(t.is(Token::Type::CharLitteral));
-    auto [c, n] = get_one_escape_sequence(t.lex(), t.prefix());
-    if (size(t.lex()) != n) {
+    std::string out;
+    if (t.lex().empty()) {
+        fatal("empty character litteral");
+    }
+    if (append_one_escape_sequence(out, t.lex(), t.prefix(), 0) != size(t.lex())) {
         fatal("multicharacter literal are not supported");
     }
-    return c;
+    return out;
 }
 
 /**
@@ -177,24 +161,240 @@ static std::string char_escape_sequence(const Token &t) {
  */
 static std::string string_escape_sequence(const Token &t) {
     assert(t.is(Token::Type::StringLitteral));
+    std::string_view lex = t.lex();
     std::string out;
-    size_t i(0);
-
-    while (i < size(t.lex())) {
-        auto [c, n] = get_one_escape_sequence(t.lex().substr(i), t.prefix());
-        out += c;
-        i += n;
+    out.reserve(size(lex));
+    for (size_t i = 0; i < size(lex);) {
+        i = append_one_escape_sequence(out, lex, t.prefix(), i);
     }
     return out;
 }
 
 void convert_escape_sequence(Token &t) {
+    ALLOC_SCOPE(AllocCategory::LitteralDecoding);
+    if (t.decoded()) {
+        return; // already converted by the lexer
+    }
     if (t.is(Token::Type::CharLitteral)) {
         t.lex(char_escape_sequence(t));
+        t.decoded(true);
         return;
     }
     if (t.is(Token::Type::StringLitteral)) {
         t.lex(string_escape_sequence(t));
+        t.decoded(true);
         return;
     }
 }
+
+/**
+ * Encoding prefix of the concatenation of litterals with prefixes `a` and `b`
+ * https://timsong-cpp.github.io/cppwp/lex.string#7
+ */
+static std::string_view common_prefix(std::string_view a, std::string_view b) {
+    if (a == b || b.empty()) {
+        return a;
+    }
+    if (a.empty()) {
+        return b;
+    }
+    fatal("concatenation of string litterals with different encoding prefixes ", a, " and ", b);
+}
+
+void concatenate_litterals(std::vector<Token> &tokens) {
+    ALLOC_SCOPE(AllocCategory::LitteralDecoding);
+    std::vector<std::string_view> rope; // contents of the run, they are copied once the final size is known
+    size_t w = 0;
+    for (size_t i = 0; i < size(tokens);) {
+        if (!tokens[i].is(Token::Type::StringLitteral)) {
+            if (w != i) {
+                tokens[w] = std::move(tokens[i]);
+            }
+            ++w;
+            ++i;
+            continue;
+        }
+
+        // A run of string litterals with only spaces and newlines between them
+        rope.clear();
+        std::string_view prefix;
+        size_t total = 0;
+        size_t first = i;
+        size_t last = i; // the last litteral of the run
+        for (size_t j = i; j < size(tokens); ++j) {
+            Token &t = tokens[j];
+            if (t.is(Token::Type::StringLitteral)) {
+                if (!t.raw()) {
+                    convert_escape_sequence(t);
+                }
+                prefix = common_prefix(prefix, t.prefix());
+                rope.push_back(t.lex());
+                total += size(t.lex());
+                last = j;
+            } else if (!t.is_one_of(Token::Type::Space, Token::Type::Newline)) {
+                break;
+            }
+        }
+
+        Token &r = tokens[first];
+        if (last != first) {
+            std::pmr::string s(r.resource());
+            s.reserve(total);
+            for (std::string_view piece : rope) {
+                s.append(piece);
+            }
+            r.take_lex(std::move(s));
+            r.prefix(std::string(prefix)); // `prefix` may be a view of the prefix of r
+            r.raw(false);
+            r.decoded(true);
+        }
+        if (w != first) {
+            tokens[w] = std::move(r);
+        }
+        ++w;
+        i = last + 1;
+    }
+    tokens.erase(tokens.begin() + static_cast<std::ptrdiff_t>(w), tokens.end());
+}
+
+namespace {
+
+/**
+ * Litterals of one chunk, converted by one thread into its own buffer
+ */
+struct Chunk {
+    size_t first; // range in the litteral index list
+    size_t last;
+    std::string out;
+    std::vector<size_t> offsets;
+    std::exception_ptr error; // of the first litteral which could not be converted
+};
+
+/**
+ * Chunks left to convert, claimed one at a time by the calling thread and the pool tasks
+ * Owned by the tasks too: a task may only start once the chunks are all converted and the call returned
+ */
+struct Claims {
+    std::atomic<size_t> next{0};
+    size_t count;
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t done = 0; // guarded by mutex
+};
+
+} // namespace
+
+static void convert_chunk(const std::vector<Token> &tokens, const std::vector<size_t> &litterals, Chunk &c) noexcept {
+    ALLOC_SCOPE(AllocCategory::LitteralDecoding);
+    ThrowOnFatal guard;
+    try {
+        for (size_t i = c.first; i < c.last; ++i) {
+            const Token &t = tokens[litterals[i]];
+            c.offsets.push_back(size(c.out));
+            if (t.decoded() || t.raw()) {
+                c.out += t.lex(); // a raw string has no escape sequences
+            } else {
+                c.out += t.is(Token::Type::CharLitteral) ? char_escape_sequence(t) : string_escape_sequence(t);
+            }
+        }
+    } catch (...) {
+        c.error = std::current_exception(); // later litterals of the chunk cannot come first
+    }
+}
+
+/**
+ * Convert the chunks not claimed yet, return the number converted
+ */
+static size_t convert_claimed(const std::vector<Token> &tokens, const std::vector<size_t> &litterals, std::vector<Chunk> &chunks,
+                              Claims &claims) noexcept {
+    size_t n = 0;
+    for (size_t i = claims.next.fetch_add(1); i < claims.count; i = claims.next.fetch_add(1)) {
+        convert_chunk(tokens, litterals, chunks[i]);
+        ++n;
+    }
+    return n;
+}
+
+ConvertedLitterals convert_escape_sequences(const std::vector<Token> &tokens, unsigned jobs, ThreadPool *pool) {
+    STATS_TIMER(Phase::Escape);
+    std::vector<size_t> litterals;
+    size_t total = 0;
+    for (size_t i = 0; i < size(tokens); ++i) {
+        if (tokens[i].is_one_of(Token::Type::CharLitteral, Token::Type::StringLitteral)) {
+            litterals.push_back(i);
+            total += size(tokens[i].lex());
+        }
+    }
+
+    // Split by source size rather than by count, long litterals cost more
+    std::vector<Chunk> chunks;
+    size_t target = total / std::max(jobs, 1u) + 1;
+    size_t acc = 0;
+    for (size_t i = 0; i < size(litterals); ++i) {
+        if (chunks.empty() || acc >= target) {
+            chunks.push_back(Chunk{i, i, {}, {}, {}});
+            acc = 0;
+        }
+        chunks.back().last = i + 1;
+        acc += size(tokens[litterals[i]].lex());
+    }
+
+    if (size(chunks) <= 1 || !pool) {
+        for (Chunk &c : chunks) {
+            convert_chunk(tokens, litterals, c);
+        }
+    } else {
+        // The calling thread converts chunks too and never waits on a queued task: no deadlock when called from a task
+        // of `pool`, and no wait on the other work of the pool
+        auto claims = std::make_shared<Claims>();
+        claims->count = size(chunks);
+        try {
+            for (size_t i = 1; i < size(chunks); ++i) {
+                pool->submit([claims, &tokens, &litterals, &chunks]() noexcept {
+                    size_t n = convert_claimed(tokens, litterals, chunks, *claims);
+                    if (n != 0) {
+                        std::lock_guard<std::mutex> lock(claims->mutex);
+                        claims->done += n;
+                        claims->finished.notify_one();
+                    }
+                });
+            }
+        } catch (...) {
+            // Not leaving while queued tasks may still claim chunks: the calling thread converts the ones left
+        }
+        size_t n = convert_claimed(tokens, litterals, chunks, *claims);
+        std::unique_lock<std::mutex> lock(claims->mutex);
+        claims->done += n;
+        claims->finished.wait(lock, [&claims] { return claims->done == claims->count; });
+    }
+
+    // Chunks are in token order, the first error is the one of the first invalid litteral
+    for (const Chunk &c : chunks) {
+        if (c.error) {
+            try {
+                std::rethrow_exception(c.error);
+            } catch (const FatalError &e) {
+                fatal(e.what()); // on this thread: exits unless a ThrowOnFatal is alive here
+            }
+        }
+    }
+
+    ConvertedLitterals r;
+    size_t arena_size = 0;
+    for (const Chunk &c : chunks) {
+        arena_size += size(c.out);
+    }
+
+    r.m_arena.reserve(arena_size);
+    r.m_spans.resize(size(tokens));
+    for (const Chunk &c : chunks) {
+        size_t base = size(r.m_arena);
+        r.m_arena += c.out;
+        for (size_t i = c.first; i < c.last; ++i) {
+            size_t k = i - c.first;
+            size_t end = k + 1 < size(c.offsets) ? c.offsets[k + 1] : size(c.out);
+            r.m_spans[litterals[i]] = ConvertedLitterals::Span{base + c.offsets[k], end - c.offsets[k]};
+        }
+    }
+    return r;
+}
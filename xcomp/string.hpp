@@ -1,8 +1,14 @@
 #ifndef STRING_HPP
 #define STRING_HPP
 
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include "tools/lexer.hpp"
 
+class ThreadPool;
+
 /**
  * Convert escape sequence
  * All unicode sequence are stored internally as utf-8
@@ -10,4 +16,47 @@
  */
 void convert_escape_sequence(Token &t);
 
+/**
+ * Converted content of every CharLitteral and StringLitteral of a token array,
+ * stored back to back in one arena
+ */
+class ConvertedLitterals {
+  public:
+    static constexpr size_t npos = std::string_view::npos;
+
+    /**
+     * Converted content of tokens[i], which must be a CharLitteral or a StringLitteral
+     */
+    std::string_view operator[](size_t i) const noexcept { return std::string_view(m_arena).substr(m_spans[i].offset, m_spans[i].size); }
+    bool has(size_t i) const noexcept { return i < size(m_spans) && m_spans[i].offset != npos; }
+
+    const std::string &arena() const noexcept { return m_arena; }
+
+  private:
+    friend ConvertedLitterals convert_escape_sequences(const std::vector<Token> &tokens, unsigned jobs, ThreadPool *pool);
+
+    struct Span {
+        size_t offset = npos;
+        size_t size = 0;
+    };
+
+    std::string m_arena;
+    std::vector<Span> m_spans; // one per token
+};
+
+/**
+ * Convert every litteral of `tokens` in `jobs` chunks balanced by source size
+ * The calling thread converts chunks with the workers of `pool`, alone without one. It may be a worker of `pool`.
+ * If some litterals are invalid, the error of the first one in token order is reported
+ */
+ConvertedLitterals convert_escape_sequences(const std::vector<Token> &tokens, unsigned jobs, ThreadPool *pool = nullptr);
+
+/**
+ * Replace each run of adjacent StringLitteral, spaces and newlines between them, by one litteral (translation phase 6)
+ * The contents are gathered as views and copied once into a string of the final size, so the cost is linear in the size of the run
+ * Litterals not converted yet are converted first, the prefix of the result is the one which is not empty
+ * https://timsong-cpp.github.io/cppwp/lex.phases#1.6
+ */
+void concatenate_litterals(std::vector<Token> &tokens);
+
 #endif